@@ -0,0 +1,153 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <LLUtils/Color.h>
+#include <LLUtils/Warnings.h>
+
+// Glyphs baked into the binary at build time by the FreeTypeGlyphBaker tool, see freetype_wrapper_bake_font in
+// FreeTypeWrapper/CMakeLists.txt. Drawing baked text needs neither FreeType nor the font file, nor the connector.
+namespace FreeType
+{
+    struct BakedGlyph
+    {
+        char32_t codepoint;
+        // Rectangle of the glyph's coverage in the font's pixels.
+        uint16_t atlasX;
+        uint16_t atlasY;
+        uint16_t width;
+        uint16_t height;
+        // Position of the coverage relative to the pen position on the baseline, y up.
+        int16_t left;
+        int16_t top;
+        int16_t advance;
+    };
+
+    // A font baked at one size, laid out the same way the connector lays out text without an outline.
+    struct BakedFont
+    {
+        uint16_t fontSize;
+        uint16_t DPIx;
+        uint16_t DPIy;
+        uint16_t lineHeight;
+        // Distance from the top of a line to its baseline.
+        int16_t baseline;
+        uint16_t atlasWidth;
+        uint16_t atlasHeight;
+        // 8 bit coverage of all glyphs, atlasWidth * atlasHeight.
+        std::span<const uint8_t> pixels;
+        // Sorted by codepoint.
+        std::span<const BakedGlyph> glyphs;
+
+        constexpr const BakedGlyph* FindGlyph(char32_t codepoint) const
+        {
+            const auto it = std::lower_bound(glyphs.begin(), glyphs.end(), codepoint, [](const BakedGlyph& glyph, char32_t value) { return glyph.codepoint < value; });
+            return it != glyphs.end() && it->codepoint == codepoint ? &*it : nullptr;
+        }
+    };
+
+    // Draws baked text into 8 bit straight RGBA pixels. Characters missing from the font are skipped, '\n' starts a
+    // new line. 8 bit strings are taken as Latin-1.
+    class BakedTextRenderer
+    {
+    public:
+        // Size of the line boxes of the text, the pen advance of its longest line by the height of its lines.
+        static void Measure(const BakedFont& font, std::string_view text, uint32_t& out_width, uint32_t& out_height) { MeasureText(font, text, out_width, out_height); }
+        static void Measure(const BakedFont& font, std::u32string_view text, uint32_t& out_width, uint32_t& out_height) { MeasureText(font, text, out_width, out_height); }
+
+        // Blends the text over dest, x / y is the top left corner of its first line box. Pixels outside dest are clipped.
+        static void Draw(const BakedFont& font, std::string_view text, LLUtils::Color color, std::byte* dest, uint32_t width, uint32_t height, size_t rowPitch, int32_t x, int32_t y)
+        {
+            DrawText(font, text, color, dest, width, height, rowPitch, x, y);
+        }
+        static void Draw(const BakedFont& font, std::u32string_view text, LLUtils::Color color, std::byte* dest, uint32_t width, uint32_t height, size_t rowPitch, int32_t x, int32_t y)
+        {
+            DrawText(font, text, color, dest, width, height, rowPitch, x, y);
+        }
+
+    private:
+        template <typename CharType>
+        static void MeasureText(const BakedFont& font, std::basic_string_view<CharType> text, uint32_t& out_width, uint32_t& out_height)
+        {
+            int32_t penX = 0;
+            int32_t maxX = 0;
+            uint32_t lines = 1;
+            for (const CharType character : text)
+            {
+                const char32_t codepoint = static_cast<char32_t>(static_cast<std::make_unsigned_t<CharType>>(character));
+                if (codepoint == U'\n')
+                {
+                    penX = 0;
+                    lines++;
+                    continue;
+                }
+                if (const BakedGlyph* glyph = font.FindGlyph(codepoint); glyph != nullptr)
+                    penX += glyph->advance;
+                maxX = std::max(maxX, penX);
+            }
+            out_width = static_cast<uint32_t>(maxX);
+            out_height = lines * font.lineHeight;
+        }
+
+        template <typename CharType>
+        static void DrawText(const BakedFont& font, std::basic_string_view<CharType> text, LLUtils::Color color, std::byte* dest
+            , uint32_t width, uint32_t height, size_t rowPitch, int32_t x, int32_t y)
+        {
+            int32_t penX = x;
+            int32_t baseline = y + font.baseline;
+            for (const CharType character : text)
+            {
+                const char32_t codepoint = static_cast<char32_t>(static_cast<std::make_unsigned_t<CharType>>(character));
+                if (codepoint == U'\n')
+                {
+                    penX = x;
+                    baseline += font.lineHeight;
+                    continue;
+                }
+
+                const BakedGlyph* glyph = font.FindGlyph(codepoint);
+                if (glyph == nullptr)
+                    continue;
+
+                DrawGlyph(font, *glyph, color, dest, width, height, rowPitch, penX + glyph->left, baseline - glyph->top);
+                penX += glyph->advance;
+            }
+        }
+
+        static void DrawGlyph(const BakedFont& font, const BakedGlyph& glyph, LLUtils::Color color, std::byte* dest
+            , uint32_t width, uint32_t height, size_t rowPitch, int32_t left, int32_t top)
+        {
+            const int32_t firstX = std::max(0, -left);
+            const int32_t firstY = std::max(0, -top);
+            const int32_t lastX = std::min<int32_t>(glyph.width, static_cast<int32_t>(width) - left);
+            const int32_t lastY = std::min<int32_t>(glyph.height, static_cast<int32_t>(height) - top);
+
+            LLUTILS_DISABLE_WARNING_PUSH
+            LLUTILS_DISABLE_WARNING_UNSAFE_BUFFER_USAGE
+            for (int32_t glyphY = firstY; glyphY < lastY; glyphY++)
+            {
+                const uint8_t* coverage = font.pixels.subspan(static_cast<size_t>(glyph.atlasY + glyphY) * font.atlasWidth + glyph.atlasX).data();
+                std::byte* destRow = dest + static_cast<size_t>(top + glyphY) * rowPitch;
+                for (int32_t glyphX = firstX; glyphX < lastX; glyphX++)
+                {
+                    const float alpha = static_cast<float>(coverage[glyphX]) * static_cast<float>(color.A()) / (255.0f * 255.0f);
+                    if (alpha == 0.0f)
+                        continue;
+
+                    // Straight alpha 'over', the color of a transparent pixel doesn't matter.
+                    uint8_t* pixel = reinterpret_cast<uint8_t*>(destRow + static_cast<size_t>(left + glyphX) * 4);
+                    const float destAlpha = static_cast<float>(pixel[3]) / 255.0f * (1.0f - alpha);
+                    const float outAlpha = alpha + destAlpha;
+                    const uint8_t source[3] = { color.R(), color.G(), color.B() };
+                    for (size_t channel = 0; channel < 3; channel++)
+                        pixel[channel] = static_cast<uint8_t>((static_cast<float>(source[channel]) * alpha + static_cast<float>(pixel[channel]) * destAlpha) / outAlpha + 0.5f);
+                    pixel[3] = static_cast<uint8_t>(outAlpha * 255.0f + 0.5f);
+                }
+            }
+            LLUTILS_DISABLE_WARNING_POP
+        }
+    };
+}
@@ -1,8 +1,13 @@
 #pragma once
+#include <algorithm>
 #include <fstream>
 #include <LLUtils/PlatformUtility.h>
 #include <LLUtils/FileHelper.h>
+#include <LLUtils/Buffer.h>
+#include <LLUtils/Color.h>
 #include <LLUtils/Exception.h>
+#include <FreeTypeWrapper/BitmapStreamWriter.h>
+#include <FreeTypeWrapper/QoiCodec.h>
 namespace FreeType
 {
 #pragma pack(push,1)
@@ -53,50 +58,33 @@ namespace FreeType
             fBitmapBuffer = bitmapBuffer;
         }
 
-        void SaveToFile(const std::wstring& fileName)
+        // Saves a 32 bit RGBA buffer as a BGRA bitmap file, by default a bottom-up BMP. The file is opened once and the
+        // rows are swizzled and written a band at a time, StreamFormat::BmpTopDown keeps the rows in buffer order.
+        void SaveToFile(const std::wstring& fileName, StreamFormat format = StreamFormat::Bmp) const
         {
-            BitmapFileHeader fileHeader{};
-            fileHeader.bfType = 0x4D42; // "BM"
-            fileHeader.bfOffBits = sizeof(BitmapFileHeader) + sizeof(BitmapInfoHeader);
+            if (fBitmapBuffer.bitsPerPixel != 32)
+                LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "Only 32 bit bitmaps can be saved");
 
-            BitmapInfoHeader infoHeader{};
-            
-            uint32_t rowPitch = fBitmapBuffer.bitsPerPixel * fBitmapBuffer.width / CHAR_BIT;
+            constexpr size_t BandSize = 256 * 1024;
+            const uint32_t height = fBitmapBuffer.height;
+            const size_t rowSize = static_cast<size_t>(fBitmapBuffer.width) * 4;
+            const uint32_t bandRows = static_cast<uint32_t>(std::clamp<size_t>(BandSize / std::max<size_t>(rowSize, 1), 1, std::max(height, 1u)));
 
-            infoHeader.biBitCount = static_cast<uint16_t>(fBitmapBuffer.bitsPerPixel);
-            infoHeader.biHeight = static_cast<int32_t>(fBitmapBuffer.height);
-            infoHeader.biWidth = static_cast<int32_t>(fBitmapBuffer.width);
-            infoHeader.biPlanes = 1;
-            infoHeader.biSize = 40;
-            infoHeader.biSizeImage = rowPitch * fBitmapBuffer.height;
-
-            fileHeader.bfSize = fileHeader.bfOffBits + infoHeader.biSizeImage;
-
-            LLUtils::Buffer flipped(fBitmapBuffer.height * fBitmapBuffer.rowPitch);
-
-
-            for (size_t y = 0; y < fBitmapBuffer.height; y++)
+            BitmapStreamWriter writer(fileName, fBitmapBuffer.width, height, format);
+            // Bottom-up files start with the last rows, bands are taken from the bottom so the file is written in order.
+            for (uint32_t written = 0; written < height; written += bandRows)
             {
-                auto destRow = (reinterpret_cast<uint8_t*>(flipped.data())) + (fBitmapBuffer.height - y - 1) * fBitmapBuffer.rowPitch;
-                auto sourceRow = (reinterpret_cast<const uint8_t*>(fBitmapBuffer.buffer)) + y * fBitmapBuffer.rowPitch;
-
-                for (uint32_t x = 0; x < fBitmapBuffer.width; x++)
-                {
-                    LLUtils::Color color = reinterpret_cast<const LLUtils::Color*>(sourceRow)[x];
-					
-					// Color class channel order layout is RGBA, Windows bitmap color channel order is BGRA.
-					// swap R and B before writing to disk.
-                    std::swap(color.R(), color.B());
-                    
-                    reinterpret_cast<LLUtils::Color*>(destRow)[x] = color;
-                }
+                const uint32_t rows = std::min(bandRows, height - written);
+                const uint32_t top = format == StreamFormat::Bmp ? height - written - rows : written;
+                writer.WriteBand(fBitmapBuffer.buffer + static_cast<size_t>(top) * fBitmapBuffer.rowPitch, fBitmapBuffer.rowPitch, top, rows);
             }
+            writer.Finish();
+        }
 
-
-            LLUtils::File::WriteAllBytes(fileName, sizeof(BitmapFileHeader), reinterpret_cast<std::byte*>(&fileHeader));
-            LLUtils::File::WriteAllBytes(fileName, sizeof(BitmapInfoHeader), reinterpret_cast<const std::byte*>(&infoHeader), true);
-            LLUtils::File::WriteAllBytes(fileName, infoHeader.biSizeImage, reinterpret_cast<const std::byte*>(flipped.data()), true);
-
+        // Saves a 32 bit RGBA buffer as a QOI image, see QoiCodec.
+        void SaveToQoiFile(const std::wstring& fileName, uint32_t maxThreads = 0) const
+        {
+            QoiCodec::SaveToFile(fileName, fBitmapBuffer, maxThreads);
         }
 
     private:
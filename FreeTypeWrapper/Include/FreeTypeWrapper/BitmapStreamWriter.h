@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+namespace FreeType
+{
+    enum class StreamFormat : uint8_t
+    {
+        // 32 bit BGRA BMP stored bottom-up, bands are written at their offset in the file and may come in any order.
+        // Needs a seekable file.
+          Bmp
+        // 32 bit BGRA BMP with a negative height, stored top-down.
+        , BmpTopDown
+        // Netpbm PAM, RGB_ALPHA tuples stored top-down.
+        , Pam
+    };
+
+    // Writes an image to a file band by band as it is rendered, e.g. from FreeTypeConnector::RenderBands, so the whole
+    // image never has to be in memory. Only one band is converted at a time.
+    // Top-down formats are written sequentially and also work on pipes, their bands must come in order from the top.
+    class BitmapStreamWriter
+    {
+    public:
+        // Writes to a file descriptor opened for writing, left open. Writing starts at the descriptor's current
+        // position for top-down formats and at the start of the file for Bmp.
+        BitmapStreamWriter(int fileDescriptor, uint32_t width, uint32_t height, StreamFormat format
+            , std::pmr::memory_resource* memoryResource = std::pmr::get_default_resource());
+        // Creates or replaces the file.
+        BitmapStreamWriter(const std::wstring& filePath, uint32_t width, uint32_t height, StreamFormat format
+            , std::pmr::memory_resource* memoryResource = std::pmr::get_default_resource());
+        ~BitmapStreamWriter();
+        BitmapStreamWriter(const BitmapStreamWriter&) = delete;
+        BitmapStreamWriter& operator=(const BitmapStreamWriter&) = delete;
+
+        // Writes rows [top, top + rows) of the image from 8 bit straight RGBA pixels. Throws if any of the rows was
+        // already written.
+        void WriteBand(const std::byte* pixels, size_t rowPitch, uint32_t top, uint32_t rows);
+
+        uint32_t GetRowsWritten() const { return fRowsWritten; }
+
+        // Throws unless every row of the image was written, and closes the file opened by the writer.
+        void Finish();
+
+    private:
+        void WriteHeader();
+        void Close();
+
+    private:
+        int fFileDescriptor = -1;
+        bool fOwnsFile = false;
+        uint32_t fWidth;
+        uint32_t fHeight;
+        StreamFormat fFormat;
+        uint64_t fHeaderSize = 0;
+        uint32_t fRowsWritten = 0;
+        std::pmr::vector<std::byte> fBand;
+        std::pmr::vector<bool> fRowsCovered;
+    };
+}
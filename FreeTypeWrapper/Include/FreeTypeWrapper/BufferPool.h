@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <cstddef>
+#include <memory_resource>
+
+#include <FreeTypeWrapper/ByteBuffer.h>
+
+namespace FreeType
+{
+    // A pool of reusable buffers bucketed by power of two size classes.
+    // Buffers handed out by Acquire are at least as big as requested, buffers given back with Release
+    // are kept until the retention limit is reached, after which they are freed.
+    // The pool is thread safe and may be shared between several FreeTypeConnector instances.
+    // New buffers and the pool's own bookkeeping are allocated from the given memory resource.
+    class BufferPool
+    {
+    public:
+        BufferPool(size_t maxRetainedBytes = 64 * 1024 * 1024, std::pmr::memory_resource* memoryResource = std::pmr::get_default_resource());
+
+        ByteBuffer Acquire(size_t size);
+        void Release(ByteBuffer buffer);
+        void Clear();
+
+        size_t GetRetainedBytes() const;
+
+    private:
+        static constexpr size_t MinSizeClass = 6; // 64 bytes
+        static constexpr size_t NumSizeClasses = sizeof(size_t) * 8;
+
+        static size_t GetSizeClassForAcquire(size_t size);
+        static size_t GetSizeClassForRelease(size_t size);
+
+    private:
+        mutable std::mutex fMutex;
+        std::pmr::memory_resource* fMemoryResource;
+        std::pmr::vector<std::pmr::vector<ByteBuffer>> fFreeLists;
+        size_t fMaxRetainedBytes;
+        size_t fRetainedBytes{};
+    };
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <utility>
+
+namespace FreeType
+{
+    // A move only byte buffer whose storage is allocated from a std::pmr::memory_resource.
+    // Storage is aligned to a cache line so pixel kernels can use aligned loads on row starts.
+    class ByteBuffer
+    {
+    public:
+        static constexpr size_t Alignment = 64;
+
+        ByteBuffer() = default;
+
+        explicit ByteBuffer(std::pmr::memory_resource* memoryResource) : fMemoryResource(memoryResource)
+        {
+
+        }
+
+        explicit ByteBuffer(size_t size, std::pmr::memory_resource* memoryResource = std::pmr::get_default_resource())
+            : fMemoryResource(memoryResource)
+        {
+            Allocate(size);
+        }
+
+        ByteBuffer(const ByteBuffer&) = delete;
+        ByteBuffer& operator=(const ByteBuffer&) = delete;
+
+        ByteBuffer(ByteBuffer&& rhs) noexcept
+        {
+            *this = std::move(rhs);
+        }
+
+        ByteBuffer& operator=(ByteBuffer&& rhs) noexcept
+        {
+            if (this != &rhs)
+            {
+                Free();
+                fMemoryResource = rhs.fMemoryResource;
+                fData = std::exchange(rhs.fData, nullptr);
+                fSize = std::exchange(rhs.fSize, 0);
+            }
+            return *this;
+        }
+
+        ~ByteBuffer()
+        {
+            Free();
+        }
+
+        void Allocate(size_t size)
+        {
+            Free();
+            if (size > 0)
+                fData = static_cast<std::byte*>(fMemoryResource->allocate(size, Alignment));
+            fSize = size;
+        }
+
+        void Free()
+        {
+            if (fData != nullptr)
+                fMemoryResource->deallocate(fData, fSize, Alignment);
+            fData = nullptr;
+            fSize = 0;
+        }
+
+        std::byte* data() { return fData; }
+        const std::byte* data() const { return fData; }
+        size_t size() const { return fSize; }
+        std::pmr::memory_resource* get_memory_resource() const { return fMemoryResource; }
+
+    private:
+        std::pmr::memory_resource* fMemoryResource = std::pmr::get_default_resource();
+        std::byte* fData = nullptr;
+        size_t fSize = 0;
+    };
+}
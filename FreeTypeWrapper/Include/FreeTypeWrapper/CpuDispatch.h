@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace FreeType
+{
+    // Instruction set levels the pixel kernels are built for, each level includes the ones below it.
+    enum class CpuLevel : uint8_t
+    {
+          Scalar
+        , SSE41
+        , AVX2
+        , AVX512
+    };
+
+    // Selects the pixel kernels used by the library. The level is picked once on first use from what the processor
+    // and the build support, and may be lowered by setting FREETYPE_WRAPPER_CPU_LEVEL to scalar, sse4.1, avx2 or avx512.
+    class CpuDispatch
+    {
+    public:
+        // Highest level supported by both this build and the running processor.
+        static CpuLevel GetSupportedLevel();
+        // Level the kernels currently run at.
+        static CpuLevel GetActiveLevel();
+        // Forces the kernels to a level, clamped to the supported level, returns the level in effect.
+        // Meant for tests and benchmarks, don't call it while other threads are rendering.
+        static CpuLevel SetActiveLevel(CpuLevel level);
+
+        static const char* GetLevelName(CpuLevel level);
+        // Accepts the names returned by GetLevelName in any case, and the level numbers 0 to 3.
+        static bool ParseLevel(std::string_view name, CpuLevel& out_level);
+
+        // Swaps the R and B channels of 32 bit pixels, source and dest may point to the same buffer.
+        static void SwizzleRGBAToBGRA(const std::byte* source, std::byte* dest, size_t numPixels);
+    };
+}
@@ -7,6 +7,23 @@ namespace FreeType
         , Aliased
         , Antialiased
         , SubpixelAntiAliased
+        // Glyphs are drawn from cached signed distance fields scaled to the text size, changing the size or the outline
+        // width doesn't render glyphs again. Needs FreeTypeModules::SignedDistanceField.
+        , SignedDistanceField
+    };
+
+    // Pixel format of the bitmaps the connector creates.
+    enum class BitmapFormat
+    {
+        // 8 bit straight RGBA.
+          RGBA
+        // 8 bit coverage of the text and its outline together, no color, e.g. for tinting on the GPU.
+        , A8
+        // Two 8 bit channels per pixel, text coverage followed by outline coverage.
+        , A8x2
+        // 1 bit per pixel, 8 pixels per byte with the leftmost in the most significant bit. Set where the text or its
+        // outline is drawn, text is always rendered aliased.
+        , A1
     };
 
 }
\ No newline at end of file
@@ -2,12 +2,16 @@
 
 #include <map>
 #include <cstdint>
+#include <functional>
 #include <string>
+#include <vector>
+#include <memory_resource>
 
 #include <FreeTypeWrapper/FreeTypeCommon.h>
+#include <FreeTypeWrapper/BufferPool.h>
+#include <FreeTypeWrapper/ByteBuffer.h>
 
 #include <LLUtils/Color.h>
-#include <LLUtils/Buffer.h>
 #include <LLUtils/Rect.h>
 #include <LLUtils/EnumClassBitwise.h>
 
@@ -18,6 +22,8 @@ struct  FT_StrokerRec_;
 typedef struct FT_StrokerRec_* FT_Stroker;
 typedef int  FT_Error;
 typedef struct FT_LibraryRec_* FT_Library;
+typedef struct FT_FaceRec_* FT_Face;
+struct FT_Bitmap_;
 
 #pragma endregion FreeType forward declerations
 
@@ -25,6 +31,9 @@ namespace FreeType
 {
     class FreeTypeFont;
     using FreeTypeFontUniquePtr = std::unique_ptr<FreeTypeFont>;
+    class FreeTypeMemory;
+    class SdfGlyphCache;
+    struct GlyphQuad;
 
 
     enum class TextCreateFlags
@@ -38,6 +47,17 @@ namespace FreeType
         , LineEndFixedWidth         = 1 << 2
         // Don't Generate outline bitmaps when measuring text, use an estimation.
         //, OptimizeOutlineMetrics    = 1 << 3
+        // Blend in linear light instead of sRGB space, gives thin text its correct weight.
+        , LinearBlending            = 1 << 4
+        // Anti-aliased glyphs are rasterized as coverage spans blended straight into the canvas instead of through glyph bitmaps.
+        // The pixels are the same, glyphs with overlapping contours keep using glyph bitmaps.
+        , DirectSpanRendering       = 1 << 5
+        // Keep text and outline as 8 bit coverage and composite background, outline and text in a single resolve pass.
+        // Overlapping glyphs of different colors take the color of the last one, LCD outlines are rendered as gray.
+        , FusedCompositing          = 1 << 6
+        // Lay the text out once and render it in bands of TextCreateParams::bandHeight rows, top to bottom, so the canvas
+        // holds a band instead of the whole text. Composited as with FusedCompositing. Ignored by CreateCoverage.
+        , BandedRendering           = 1 << 7
     };
 
     LLUTILS_DEFINE_ENUM_CLASS_FLAG_OPERATIONS(TextCreateFlags)
@@ -57,9 +77,39 @@ namespace FreeType
         uint16_t DPIy{};
         uint16_t padding{};
         TextCreateFlags flags{};
+        // Coverage formats ignore all colors and render LCD text as gray.
+        BitmapFormat bitmapFormat{};
+        // Rows per band of banded rendering, 0 picks bands whose canvas fits in a typical L2 cache.
+        uint32_t bandHeight{};
     };
 
 
+    struct MsdfAtlasParams
+    {
+        std::wstring fontPath;
+        // Characters to put in the atlas, duplicates and characters the font doesn't have are skipped.
+        std::wstring characters;
+        // Pixels per em the fields are generated at.
+        uint16_t emSize = 32;
+        // Width of the distance range in atlas pixels, centered on the outline. Effects such as outlines can reach up to
+        // half of it outside the glyph.
+        uint16_t pixelRange = 4;
+        // Glyphs are generated in parallel, 0 uses one thread per hardware thread. The atlas doesn't depend on it.
+        uint32_t maxThreads{};
+    };
+
+    struct CoverageAtlasParams
+    {
+        std::wstring fontPath;
+        // Characters to put in the atlas, duplicates and characters the font doesn't have are skipped.
+        std::wstring characters;
+        uint16_t fontSize{};
+        uint16_t DPIx{};
+        uint16_t DPIy{};
+        // Aliased glyphs are stored as 0 or 255, every other mode as anti-aliased gray coverage.
+        RenderMode renderMode = RenderMode::Antialiased;
+    };
+
     struct TextMesureParams
     {
         TextCreateParams createParams;
@@ -72,7 +122,9 @@ namespace FreeType
 
     struct TextMetrics
     {
-        std::vector<LineMetrics> lineMetrics;
+        explicit TextMetrics(std::pmr::memory_resource* memoryResource = std::pmr::get_default_resource()) : lineMetrics(memoryResource) {}
+
+        std::pmr::vector<LineMetrics> lineMetrics;
         LLUtils::RectI32 rect;
         uint32_t rowHeight{};
         int32_t minX = std::numeric_limits<int32_t>::max();
@@ -80,10 +132,53 @@ namespace FreeType
     };
 
 
+    // FreeType modules to register when the connector creates its FreeType library.
+    enum class FreeTypeModules
+    {
+          None          = 0
+        // TrueType driver, also registers the sfnt module.
+        , TrueType      = 1 << 0
+        // CFF / OpenType driver, also registers the sfnt and PostScript helper modules.
+        , CFF           = 1 << 1
+        // Anti-aliased and LCD renderer.
+        , Smooth        = 1 << 2
+        // Aliased renderer.
+        , Mono          = 1 << 3
+        // Automatic hinter, used for fonts without hinting instructions.
+        , AutoHinter    = 1 << 4
+        // Signed distance field renderers, used by RenderMode::SignedDistanceField.
+        , SignedDistanceField = 1 << 5
+        // Every module compiled into FreeType, same as FT_Init_FreeType.
+        , All           = 1 << 30
+        , Minimal       = TrueType | CFF | Smooth | Mono
+    };
+
+    LLUTILS_DEFINE_ENUM_CLASS_FLAG_OPERATIONS(FreeTypeModules)
+
+    struct ConnectorCreateParams
+    {
+        // All allocations made by the connector, its caches and the bitmaps it creates come from this resource.
+        std::pmr::memory_resource* memoryResource = std::pmr::get_default_resource();
+        // Registering only the needed modules reduces startup time and memory of the connector. Needs a static FreeType,
+        // every module is registered when FreeType is a shared library.
+        FreeTypeModules modules = FreeTypeModules::All;
+    };
+
+    // Live counters of the memory FreeType itself allocates (faces, sizes, glyph slots, stroker, rasterizer pools).
+    struct FreeTypeMemoryStats
+    {
+        size_t bytesInUse{};
+        size_t peakBytesInUse{};
+        size_t allocationsInUse{};
+        size_t totalAllocations{};
+    };
+
     class FreeTypeConnector
     {
     public:
-        FreeTypeConnector();
+        // All allocations made by the connector, its caches and the bitmaps it creates come from 'memoryResource'.
+        FreeTypeConnector(std::pmr::memory_resource* memoryResource = std::pmr::get_default_resource());
+        FreeTypeConnector(const ConnectorCreateParams& createParams);
         ~FreeTypeConnector();
 
 
@@ -91,35 +186,192 @@ namespace FreeType
         {
             uint32_t width{};
             uint32_t height{};
-            LLUtils::Buffer buffer{};
+            ByteBuffer buffer{};
+            // Bytes per pixel, 0 for BitmapFormat::A1.
             uint32_t PixelSize{};
             uint32_t rowPitch{};
+            BitmapFormat format{};
+        };
+
+
+
+        // Text rendered once as 8 bit coverage masks, colorized any number of times by Colorize.
+        struct TextCoverage
+        {
+            uint32_t width{};
+            uint32_t height{};
+            // Fill coverage, outline coverage and fill color index planes, width * height bytes each.
+            ByteBuffer buffer{};
+            // Color of each meta text run, indexed by the color index plane. {0,0,0,0} means the run uses the text color.
+            std::pmr::vector<LLUtils::Color> runColors{};
+            bool linearBlending{};
+        };
+
+        struct CoverageColors
+        {
+            LLUtils::Color textColor;
+            LLUtils::Color outlineColor;
+            LLUtils::Color backgroundColor;
+        };
+
+        struct MsdfGlyph
+        {
+            char32_t codepoint{};
+            uint32_t glyphIndex{};
+            // Field rectangle in the atlas, empty for glyphs without an outline, e.g. space.
+            uint32_t atlasX{};
+            uint32_t atlasY{};
+            uint32_t width{};
+            uint32_t height{};
+            // Top left corner of the field relative to the pen position, y up, in pixels at the atlas em size.
+            float left{};
+            float top{};
+            float advance{};
+        };
+
+        // Multi-channel signed distance fields of a set of glyphs, packed into one bitmap. Red, green and blue hold the
+        // multi-channel distance, sharp corners are reconstructed from their median. Alpha holds the true distance.
+        // Distances are mapped from [-pixelRange / 2, pixelRange / 2] to [0, 255].
+        struct MsdfAtlas
+        {
+            Bitmap bitmap{};
+            uint16_t emSize{};
+            uint16_t pixelRange{};
+            // Sorted by codepoint.
+            std::pmr::vector<MsdfGlyph> glyphs{};
+        };
+
+        struct CoverageGlyph
+        {
+            char32_t codepoint{};
+            uint32_t glyphIndex{};
+            // Coverage rectangle in the atlas, empty for glyphs that draw nothing, e.g. space.
+            uint32_t atlasX{};
+            uint32_t atlasY{};
+            uint32_t width{};
+            uint32_t height{};
+            // Top left corner of the coverage relative to the pen position on the baseline, y up.
+            int32_t left{};
+            int32_t top{};
+            int32_t advance{};
         };
 
+        // Rendered glyphs of one font size packed into an A8 bitmap, with the metrics CreateBitmap lays them out with.
+        struct CoverageAtlas
+        {
+            Bitmap bitmap{};
+            uint32_t lineHeight{};
+            // Distance from the top of a line to its baseline.
+            int32_t baseline{};
+            // Sorted by codepoint.
+            std::pmr::vector<CoverageGlyph> glyphs{};
+        };
+
+        // Rasterized glyphs LayoutQuads draws text from, implemented by GlyphAtlas.
+        class GlyphQuadCache
+        {
+        public:
+            struct GlyphKey
+            {
+                const FreeTypeFont* font;
+                uint32_t glyphIndex;
+                uint16_t fontSize;
+                uint16_t DPIx;
+                uint16_t DPIy;
+                uint8_t renderMode;
+                // 0 for the glyph itself.
+                uint32_t outlineWidth;
+
+                auto operator<=>(const GlyphKey&) const = default;
+            };
+
+            // LCD coverage is only kept by RGBA caches.
+            virtual BitmapFormat GetFormat() const = 0;
+            // Quad of a cached glyph with its origin at penX / baseline, false when the glyph isn't cached or doesn't fit.
+            virtual bool FindQuad(const GlyphKey& key, int32_t penX, int32_t baseline, LLUtils::Color color, GlyphQuad& out_quad) = 0;
+            // Caches a rasterized glyph and returns its quad as FindQuad does, false when it doesn't fit.
+            virtual bool InsertQuad(const GlyphKey& key, const FT_Bitmap_& bitmap, int32_t left, int32_t top
+                , int32_t penX, int32_t baseline, LLUtils::Color color, GlyphQuad& out_quad) = 0;
 
+        protected:
+            ~GlyphQuadCache() = default;
+        };
 
-        using GlyphMappings = std::vector< LLUtils::RectI32>;
+        using GlyphMappings = std::pmr::vector< LLUtils::RectI32>;
+        // Receives the rows [top, top + band.height) of the text, the band's buffer is reused once it returns.
+        using BandCallback = std::function<void(const Bitmap& band, uint32_t top)>;
 
         void CreateBitmap(const TextCreateParams& textCreateParams, Bitmap& out_bitmap, TextMetrics* metrics, GlyphMappings* out_glyphMapping = nullptr);
+        // Rasterizes the text into coverage masks without resolving any colors, the colors in textCreateParams are ignored
+        // except for meta text runs. Text is composited as with TextCreateFlags::FusedCompositing, LCD text is rendered as gray.
+        void CreateCoverage(const TextCreateParams& textCreateParams, TextCoverage& out_coverage, TextMetrics* metrics = nullptr, GlyphMappings* out_glyphMapping = nullptr);
+        // Composites and resolves coverage created by CreateCoverage with the given colors, without rasterizing the text again.
+        void Colorize(const TextCoverage& coverage, const CoverageColors& colors, Bitmap& out_bitmap);
         void MeasureText(const TextMesureParams& measureParams, TextMetrics& out_metrics);
+        // Renders the text band by band as with TextCreateFlags::BandedRendering, without ever holding the whole bitmap,
+        // e.g. to stream text taller than memory allows to a file. Bands are in textCreateParams.bitmapFormat.
+        void RenderBands(const TextCreateParams& textCreateParams, const BandCallback& onBand, TextMetrics* metrics = nullptr, GlyphMappings* out_glyphMapping = nullptr);
+        // Generates an atlas of multi-channel signed distance fields from the glyph outlines, text of any size can be
+        // drawn from it, e.g. on the GPU. The same parameters always give the same atlas.
+        void CreateMsdfAtlas(const MsdfAtlasParams& params, MsdfAtlas& out_atlas);
+        // Renders a set of glyphs at one size into an atlas, e.g. to bake them into a binary.
+        void CreateCoverageAtlas(const CoverageAtlasParams& params, CoverageAtlas& out_atlas);
+        // Lays the text out the same way CreateBitmap does, as quads of glyphs drawn from the cache, see GlyphAtlas::LayoutQuads.
+        // Glyphs missing from the cache are rasterized and added. Returns false when some of them don't fit.
+        bool LayoutQuads(const TextCreateParams& textCreateParams, GlyphQuadCache& cache, std::pmr::vector<GlyphQuad>& out_quads);
+
+        // Use an external pool for output bitmaps and intermediate canvases, pass nullptr to disable pooling.
+        // The pool is not owned by the connector and must outlive it.
+        void SetBufferPool(BufferPool* bufferPool);
+        // Sizes a bitmap for width x height pixels of the format and returns its pixels, e.g. for an atlas page. The buffer
+        // is kept when it's big enough, otherwise it comes from the buffer pool, if one is set.
+        std::byte* PrepareBitmap(Bitmap& bitmap, uint32_t width, uint32_t height, BitmapFormat format);
+        // Return the buffer of a bitmap created by CreateBitmap to the buffer pool, if one is set.
+        void ReleaseBitmap(Bitmap& bitmap);
+        // Return the buffer of coverage created by CreateCoverage to the buffer pool, if one is set.
+        void ReleaseCoverage(TextCoverage& coverage);
+        // Closes a font opened by earlier calls and drops the distance fields cached for it. Glyph atlases of the
+        // connector must be cleared, they identify fonts by address.
+        void ReleaseFont(const std::wstring& fontPath);
+        std::pmr::memory_resource* GetMemoryResource() const;
+        FreeTypeMemoryStats GetFreeTypeMemoryStats() const;
 
     private:
      //private member methods
 
         
+        void AddModules(FreeTypeModules modules);
         FreeTypeFont* GetOrCreateFont(const std::wstring& fontPath);
         FT_Stroker GetStroker();
+        SdfGlyphCache& GetSdfGlyphCache();
         static std::string GenerateFreeTypeErrorString(std::string userMessage, FT_Error error);
+        // Height of a line of text, lines grow by the outline above and below.
+        static uint32_t GetRowHeight(FT_Face face, uint32_t outlineWidth);
+
+        struct GlyphPlacement;
+        // Lays out text line by line, wrapping at maxWidthPx, the way every text operation places glyphs. Calls onGlyph
+        // for each glyph with the glyph loaded into the face's slot and returns the number of lines.
+        template <typename FormattedText, typename GlyphHandler>
+        static uint32_t LayOutText(FT_Face face, const FormattedText& formattedText, bool bidirectional, uint32_t maxWidthPx, GlyphHandler&& onGlyph);
+
+        void RenderText(const TextCreateParams& textCreateParams, Bitmap* out_bitmap, TextCoverage* out_coverage, TextMetrics* metrics, GlyphMappings* out_glyphMapping);
+        // Renders bands into out_bitmap, or into a band sized bitmap passed to onBand when out_bitmap is nullptr.
+        void RenderTextBanded(const TextCreateParams& textCreateParams, Bitmap* out_bitmap, const BandCallback* onBand, TextMetrics* metrics, GlyphMappings* out_glyphMapping);
+
+        ByteBuffer AcquireBuffer(size_t size);
+        void ReleaseBuffer(ByteBuffer buffer);
 
-        template <typename source_type, typename dest_type>
-        void ResolvePremultipoliedBUffer(LLUtils::Buffer& dest, const LLUtils::Buffer& source, uint32_t width, uint32_t height);
 
 
     private:
+        std::pmr::memory_resource* fMemoryResource;
+        std::unique_ptr<FreeTypeMemory> fFreeTypeMemory;
         FT_Library fLibrary;
         FT_Stroker fStroker = nullptr;
+        BufferPool* fBufferPool = nullptr;
+        std::unique_ptr<SdfGlyphCache> fSdfGlyphCache;
 
-        std::map<std::wstring, FreeTypeFontUniquePtr> fFontNameToFont;
+        std::pmr::map<std::pmr::wstring, FreeTypeFontUniquePtr, std::less<>> fFontNameToFont;
 
     };
 }
\ No newline at end of file
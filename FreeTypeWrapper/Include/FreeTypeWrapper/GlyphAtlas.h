@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#include <FreeTypeWrapper/FreeTypeConnector.h>
+
+struct FT_Bitmap_;
+
+namespace FreeType
+{
+    class ShelfPacker;
+    class GlyphCacheFile;
+
+    struct GlyphAtlasParams
+    {
+        uint32_t width = 1024;
+        uint32_t height = 1024;
+        // A8 pages keep gray coverage. RGBA pages keep LCD coverage per channel with the maximum in alpha, gray coverage
+        // is replicated to all four channels.
+        BitmapFormat format = BitmapFormat::A8;
+        // Empty pixels right of and below every glyph, sampling a glyph bilinearly never reads its neighbour.
+        uint32_t padding = 1;
+    };
+
+    // A glyph or glyph outline placed in the text, drawn by sampling its rectangle in the atlas page.
+    struct GlyphQuad
+    {
+        // Pixel rectangle, relative to the pen position at the start of the text's first line box.
+        int32_t left{};
+        int32_t top{};
+        uint32_t width{};
+        uint32_t height{};
+        // Texture coordinates of the glyph in the atlas page, 0 to 1.
+        float u0{};
+        float v0{};
+        float u1{};
+        float v1{};
+        LLUtils::Color color;
+    };
+
+    struct AtlasRect
+    {
+        uint32_t x{};
+        uint32_t y{};
+        uint32_t width{};
+        uint32_t height{};
+    };
+
+    // Glyphs rasterized by a connector, kept in a single fixed size page shared by all the text drawn with it, e.g. as a
+    // GPU texture. When the page is full the least recently used glyphs are evicted, the rectangles written since the
+    // last upload are tracked so that only they need to be uploaded again.
+    class GlyphAtlas : private FreeTypeConnector::GlyphQuadCache
+    {
+    public:
+        // The connector rasterizes the glyphs and must outlive the atlas.
+        GlyphAtlas(FreeTypeConnector& connector, const GlyphAtlasParams& params = {});
+        ~GlyphAtlas();
+
+        // Lays the text out the same way CreateBitmap does, a quad per drawn glyph, all outline quads before the text
+        // quads. Glyphs missing from the page are rasterized and added. Returns false when the glyphs of the text don't
+        // fit in the page together, the quads of the glyphs that didn't fit are left out.
+        // Aliased and subpixel text is kept as gray coverage in A8 pages, signed distance fields aren't used.
+        bool LayoutQuads(const TextCreateParams& params, std::pmr::vector<GlyphQuad>& out_quads);
+
+        const FreeTypeConnector::Bitmap& GetPage() const { return fPage; }
+
+        // Moves the rectangles of the page written since the last call to out_rects.
+        void TakeDirtyRects(std::pmr::vector<AtlasRect>& out_rects);
+
+        // Removes all glyphs, the page content is kept until new glyphs are written over it.
+        void Clear();
+
+        // Saves the glyphs in the atlas to a versioned, checksummed file, replacing filePath. Fonts are identified by
+        // their content, the file can be used by processes that load the fonts from other paths.
+        void SaveCacheFile(const std::wstring& filePath) const;
+        // Maps a file saved by an atlas of the same page format read-only. Glyphs missing from the atlas are copied from
+        // it instead of rasterized, only the pixels of those glyphs are read. Returns false, and keeps the file opened
+        // before, when the file doesn't exist, is of another version or page format or is damaged.
+        bool OpenCacheFile(const std::wstring& filePath);
+        void CloseCacheFile();
+
+        size_t GetGlyphCount() const { return fGlyphs.size(); }
+        uint64_t GetEvictionCount() const { return fEvictionCount; }
+        // Glyphs copied from the cache file instead of rasterized.
+        uint64_t GetCacheFileHitCount() const { return fCacheFileHitCount; }
+
+    private:
+        BitmapFormat GetFormat() const override { return fPage.format; }
+        bool FindQuad(const GlyphKey& key, int32_t penX, int32_t baseline, LLUtils::Color color, GlyphQuad& out_quad) override;
+        bool InsertQuad(const GlyphKey& key, const FT_Bitmap_& bitmap, int32_t left, int32_t top
+            , int32_t penX, int32_t baseline, LLUtils::Color color, GlyphQuad& out_quad) override;
+
+        struct Entry
+        {
+            // Rectangle in the page, empty for glyphs that draw nothing.
+            uint32_t x;
+            uint32_t y;
+            uint32_t width;
+            uint32_t height;
+            // Position of the bitmap relative to the pen position on the baseline, y up.
+            int32_t left;
+            int32_t top;
+            uint64_t lastUse;
+            std::pmr::list<GlyphKey>::iterator lruPosition;
+        };
+
+        // Marks the glyph as used by the current layout, glyphs missing from the atlas are copied from the cache file.
+        // nullptr when it's in neither or doesn't fit.
+        const Entry* Find(const GlyphKey& key);
+        // Copies a rendered glyph into the page. Returns nullptr when it doesn't fit.
+        const Entry* Insert(const GlyphKey& key, const FT_Bitmap_& bitmap, int32_t left, int32_t top);
+        // Adds a cleared width x height rectangle to the page, evicting glyphs not used by the current layout to make
+        // room. Returns nullptr when it doesn't fit.
+        Entry* Allocate(const GlyphKey& key, uint32_t width, uint32_t height, int32_t left, int32_t top);
+        uint8_t* GetPixels(const Entry& entry);
+        GlyphQuad GetQuad(const Entry& entry, int32_t penX, int32_t baseline, LLUtils::Color color) const;
+        void Evict(std::pmr::map<GlyphKey, Entry>::iterator glyph);
+        void AddDirtyRect(const AtlasRect& rect);
+
+    private:
+        FreeTypeConnector& fConnector;
+        GlyphAtlasParams fParams;
+        FreeTypeConnector::Bitmap fPage;
+        std::unique_ptr<ShelfPacker> fPacker;
+        std::pmr::map<GlyphKey, Entry> fGlyphs;
+        // Least recently used first.
+        std::pmr::list<GlyphKey> fLeastRecentlyUsed;
+        std::pmr::vector<AtlasRect> fDirtyRects;
+        std::unique_ptr<GlyphCacheFile> fCacheFile;
+        // Incremented by every layout, glyphs used by the current one are never evicted.
+        uint64_t fLayoutCount = 0;
+        uint64_t fEvictionCount = 0;
+        uint64_t fCacheFileHitCount = 0;
+    };
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace FreeType
+{
+    struct BitmapBuffer;
+
+    // Lossless "Quite OK Image" format, https://qoiformat.org. Much smaller than bitmap files for text captures, which
+    // are mostly flat background, and a lot faster to encode than PNG.
+    //
+    // Large images are encoded in parallel in chunks of rows. A chunk only refers to the color index entries it added
+    // itself, so the chunks join into a standard QOI stream any decoder reads. The output doesn't depend on the number
+    // of threads, and images of a single chunk are encoded exactly like the reference encoder does.
+    class QoiCodec
+    {
+    public:
+        // Encodes 8 bit straight RGBA pixels, 0 threads uses one thread per hardware thread. The memory resource is only
+        // used by the calling thread, the encoding threads allocate from the heap.
+        static std::pmr::vector<std::byte> Encode(const BitmapBuffer& bitmap, uint32_t maxThreads = 0
+            , std::pmr::memory_resource* memoryResource = std::pmr::get_default_resource());
+
+        // Encodes to a file, the encoded chunks are written one after the other without joining them in memory first.
+        static void SaveToFile(const std::wstring& filePath, const BitmapBuffer& bitmap, uint32_t maxThreads = 0
+            , std::pmr::memory_resource* memoryResource = std::pmr::get_default_resource());
+
+        // Decodes to 8 bit straight RGBA rows of width * 4 bytes, 3 channel images get an opaque alpha.
+        // Throws on malformed data, including a missing end marker.
+        static std::pmr::vector<std::byte> Decode(std::span<const std::byte> data, uint32_t& out_width, uint32_t& out_height
+            , std::pmr::memory_resource* memoryResource = std::pmr::get_default_resource());
+
+    private:
+        static std::pmr::vector<std::vector<std::byte>> EncodeChunks(const BitmapBuffer& bitmap, uint32_t maxThreads, std::pmr::memory_resource* memoryResource);
+    };
+}
@@ -0,0 +1,116 @@
+#include "BitCanvas.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <LLUtils/Exception.h>
+#include <LLUtils/Warnings.h>
+
+namespace FreeType
+{
+    BitCanvas::BitCanvas(std::byte* buffer, uint32_t width, uint32_t height)
+        : fWords(reinterpret_cast<uint64_t*>(buffer))
+        , fWidth(width)
+        , fHeight(height)
+    {
+
+    }
+
+    void BitCanvas::Clear()
+    {
+        std::memset(fWords, 0, GetBufferSize(fWidth, fHeight));
+    }
+
+    LLUTILS_DISABLE_WARNING_PUSH
+    LLUTILS_DISABLE_WARNING_UNSAFE_BUFFER_USAGE
+    void BitCanvas::AccumulateRow(uint32_t y, int32_t x, const uint8_t* bits, uint32_t numBits)
+    {
+        uint64_t* row = GetRow(y);
+        const size_t wordsPerRow = GetWordsPerRow(fWidth);
+
+        for (uint32_t bit = 0; bit < numBits; bit += 64)
+        {
+            int64_t position = static_cast<int64_t>(x) + bit;
+            if (position >= static_cast<int64_t>(fWidth))
+                break;
+
+            // 64 pixels, most significant bit first, bits past the end of the glyph row cleared.
+            const uint32_t chunkBits = std::min<uint32_t>(64, numBits - bit);
+            uint64_t chunk = 0;
+            for (uint32_t i = 0; i < (chunkBits + 7) / 8; i++)
+                chunk |= static_cast<uint64_t>(bits[bit / 8 + i]) << (56 - 8 * i);
+            if (chunkBits < 64)
+                chunk &= ~uint64_t{ 0 } << (64 - chunkBits);
+
+            // Clip pixels left of the canvas.
+            if (position < 0)
+            {
+                if (position <= -64)
+                    continue;
+                chunk <<= -position;
+                position = 0;
+            }
+
+            const size_t word = static_cast<size_t>(position) / 64;
+            const uint32_t shift = static_cast<uint32_t>(position % 64);
+            row[word] |= chunk >> shift;
+            if (shift != 0 && word + 1 < wordsPerRow)
+                row[word + 1] |= chunk << (64 - shift);
+        }
+    }
+
+    void BitCanvas::AccumulateBitmap(const FT_Bitmap& bitmap, int32_t left, int32_t top)
+    {
+        if (bitmap.pixel_mode != FT_PIXEL_MODE_MONO && bitmap.pixel_mode != FT_PIXEL_MODE_GRAY)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::LogicError, "Bit canvas accepts mono and gray glyphs only");
+
+        const int32_t beginY = std::max(top, 0);
+        const int32_t endY = std::min(top + static_cast<int32_t>(bitmap.rows), static_cast<int32_t>(fHeight));
+
+        // Gray rows are thresholded into a packed row first, up to 512 pixels at a time.
+        constexpr uint32_t MaxPackedBits = 512;
+        std::array<uint8_t, MaxPackedBits / 8> packed;
+
+        for (int32_t y = beginY; y < endY; y++)
+        {
+            const uint8_t* sourceRow = bitmap.buffer + static_cast<ptrdiff_t>(y - top) * bitmap.pitch;
+
+            if (bitmap.pixel_mode == FT_PIXEL_MODE_MONO)
+            {
+                AccumulateRow(static_cast<uint32_t>(y), left, sourceRow, bitmap.width);
+                continue;
+            }
+
+            for (uint32_t begin = 0; begin < bitmap.width; begin += MaxPackedBits)
+            {
+                const uint32_t numBits = std::min(MaxPackedBits, bitmap.width - begin);
+                packed.fill(0);
+                for (uint32_t i = 0; i < numBits; i++)
+                    if (sourceRow[begin + i] >= 128)
+                        packed[i / 8] |= static_cast<uint8_t>(0x80 >> (i % 8));
+
+                AccumulateRow(static_cast<uint32_t>(y), left + static_cast<int32_t>(begin), packed.data(), numBits);
+            }
+        }
+    }
+
+    void BitCanvas::Resolve(uint8_t* dest, uint32_t rowPitch) const
+    {
+        const uint32_t packedRowPitch = GetPackedRowPitch(fWidth);
+        // Pixels past the canvas width may have been set by glyphs crossing the right edge.
+        const uint8_t lastByteMask = fWidth % 8 == 0 ? 0xFF : static_cast<uint8_t>(0xFF << (8 - fWidth % 8));
+
+        for (uint32_t y = 0; y < fHeight; y++)
+        {
+            const uint64_t* row = GetRow(y);
+            uint8_t* destRow = dest + static_cast<size_t>(y) * rowPitch;
+
+            for (uint32_t i = 0; i < packedRowPitch; i++)
+                destRow[i] = static_cast<uint8_t>(row[i / 8] >> (56 - 8 * (i % 8)));
+
+            if (packedRowPitch > 0)
+                destRow[packedRowPitch - 1] &= lastByteMask;
+            std::fill(destRow + packedRowPitch, destRow + rowPitch, uint8_t{ 0 });
+        }
+    }
+    LLUTILS_DISABLE_WARNING_POP
+}
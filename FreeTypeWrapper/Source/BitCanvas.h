@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <FreeTypeHeaders.h>
+
+namespace FreeType
+{
+    // A 1 bit per pixel canvas for aliased text. Rows are stored as 64 bit words, leftmost pixel in the most significant
+    // bit, and glyph rows are OR-ed in a word at a time. The canvas doesn't own its pixels.
+    class BitCanvas
+    {
+    public:
+        static size_t GetBufferSize(uint32_t width, uint32_t height) { return GetWordsPerRow(width) * height * sizeof(uint64_t); }
+
+        // buffer must be aligned to 8 bytes and GetBufferSize bytes long.
+        BitCanvas(std::byte* buffer, uint32_t width, uint32_t height);
+
+        // Clears all pixels, must be called once before drawing.
+        void Clear();
+
+        // Sets the pixels of a glyph bitmap whose top left corner is at left / top, clipped to the canvas.
+        // Mono bitmaps are OR-ed in as is, gray bitmaps are thresholded at half coverage.
+        void AccumulateBitmap(const FT_Bitmap& bitmap, int32_t left, int32_t top);
+
+        // Packs the canvas as 1 bit per pixel rows of rowPitch bytes, most significant bit first, the same layout as
+        // FreeType's mono bitmaps. Padding bits at the end of each row are zero.
+        void Resolve(uint8_t* dest, uint32_t rowPitch) const;
+
+        static uint32_t GetPackedRowPitch(uint32_t width) { return (width + 7) / 8; }
+
+    private:
+        static size_t GetWordsPerRow(uint32_t width) { return (static_cast<size_t>(width) + 63) / 64; }
+        uint64_t* GetRow(uint32_t y) const { return fWords + y * GetWordsPerRow(fWidth); }
+
+        // ORs numBits packed pixels, most significant bit first, into row y starting at pixel x.
+        void AccumulateRow(uint32_t y, int32_t x, const uint8_t* bits, uint32_t numBits);
+
+    private:
+        uint64_t* fWords;
+        uint32_t fWidth;
+        uint32_t fHeight;
+    };
+}
@@ -0,0 +1,237 @@
+#include <FreeTypeWrapper/BitmapStreamWriter.h>
+#include <FreeTypeWrapper/BitmapFile.h>
+#include <FreeTypeWrapper/CpuDispatch.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <string>
+#include <LLUtils/Exception.h>
+#include <LLUtils/Warnings.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+    #include <fcntl.h>
+    #include <io.h>
+    #include <sys/stat.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+namespace FreeType
+{
+    namespace
+    {
+        // Larger writes are split, 32 bit Windows calls take a DWORD.
+        constexpr size_t MaxWriteSize = size_t{ 1 } << 30;
+
+        void WriteAt(int fileDescriptor, const std::byte* data, size_t size, uint64_t offset)
+        {
+            LLUTILS_DISABLE_WARNING_PUSH
+            LLUTILS_DISABLE_WARNING_UNSAFE_BUFFER_USAGE
+            while (size > 0)
+            {
+                const size_t chunk = std::min(size, MaxWriteSize);
+#if defined(_WIN32)
+                OVERLAPPED overlapped{};
+                overlapped.Offset = static_cast<DWORD>(offset);
+                overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+                DWORD written = 0;
+                if (WriteFile(reinterpret_cast<HANDLE>(_get_osfhandle(fileDescriptor)), data, static_cast<DWORD>(chunk), &written, &overlapped) == FALSE || written == 0)
+                    LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, "Unable to write bitmap band");
+#else
+                const ssize_t written = pwrite(fileDescriptor, data, chunk, static_cast<off_t>(offset));
+                if (written < 0 && errno == EINTR)
+                    continue;
+                if (written <= 0)
+                    LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, "Unable to write bitmap band: " + std::string(std::strerror(errno)));
+#endif
+                data += written;
+                size -= static_cast<size_t>(written);
+                offset += static_cast<uint64_t>(written);
+            }
+            LLUTILS_DISABLE_WARNING_POP
+        }
+
+        void WriteNext(int fileDescriptor, const std::byte* data, size_t size)
+        {
+            LLUTILS_DISABLE_WARNING_PUSH
+            LLUTILS_DISABLE_WARNING_UNSAFE_BUFFER_USAGE
+            while (size > 0)
+            {
+                const size_t chunk = std::min(size, MaxWriteSize);
+#if defined(_WIN32)
+                const int written = _write(fileDescriptor, data, static_cast<unsigned int>(chunk));
+                if (written <= 0)
+                    LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, "Unable to write bitmap band");
+#else
+                const ssize_t written = write(fileDescriptor, data, chunk);
+                if (written < 0 && errno == EINTR)
+                    continue;
+                if (written <= 0)
+                    LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, "Unable to write bitmap band: " + std::string(std::strerror(errno)));
+#endif
+                data += written;
+                size -= static_cast<size_t>(written);
+            }
+            LLUTILS_DISABLE_WARNING_POP
+        }
+
+        int OpenForWriting(const std::wstring& filePath)
+        {
+            const std::filesystem::path path(filePath);
+#if defined(_WIN32)
+            const int fileDescriptor = _wopen(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+            const int fileDescriptor = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+#endif
+            if (fileDescriptor < 0)
+                LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, "Unable to create bitmap file");
+            return fileDescriptor;
+        }
+    }
+
+    BitmapStreamWriter::BitmapStreamWriter(int fileDescriptor, uint32_t width, uint32_t height, StreamFormat format, std::pmr::memory_resource* memoryResource)
+        : fFileDescriptor(fileDescriptor)
+        , fWidth(width)
+        , fHeight(height)
+        , fFormat(format)
+        , fBand(memoryResource)
+        , fRowsCovered(height, false, memoryResource)
+    {
+        WriteHeader();
+    }
+
+    BitmapStreamWriter::BitmapStreamWriter(const std::wstring& filePath, uint32_t width, uint32_t height, StreamFormat format, std::pmr::memory_resource* memoryResource)
+        : fFileDescriptor(OpenForWriting(filePath))
+        , fOwnsFile(true)
+        , fWidth(width)
+        , fHeight(height)
+        , fFormat(format)
+        , fBand(memoryResource)
+        , fRowsCovered(height, false, memoryResource)
+    {
+        try
+        {
+            WriteHeader();
+        }
+        catch (...)
+        {
+            Close();
+            throw;
+        }
+    }
+
+    BitmapStreamWriter::~BitmapStreamWriter()
+    {
+        Close();
+    }
+
+    void BitmapStreamWriter::Close()
+    {
+        if (fOwnsFile && fFileDescriptor >= 0)
+        {
+#if defined(_WIN32)
+            _close(fFileDescriptor);
+#else
+            close(fFileDescriptor);
+#endif
+        }
+        fFileDescriptor = -1;
+    }
+
+    void BitmapStreamWriter::WriteHeader()
+    {
+        if (fHeight > static_cast<uint32_t>(std::numeric_limits<int32_t>::max()) || fWidth > static_cast<uint32_t>(std::numeric_limits<int32_t>::max()) / 4)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "Bitmap is too large for a bitmap file");
+
+        if (fFormat == StreamFormat::Pam)
+        {
+            const std::string header = "P7\nWIDTH " + std::to_string(fWidth) + "\nHEIGHT " + std::to_string(fHeight)
+                + "\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n";
+            fHeaderSize = header.size();
+            WriteNext(fFileDescriptor, reinterpret_cast<const std::byte*>(header.data()), header.size());
+            return;
+        }
+
+        struct
+        {
+            BitmapFileHeader fileHeader;
+            BitmapInfoHeader infoHeader;
+        } header{};
+        static_assert(sizeof(header) == sizeof(BitmapFileHeader) + sizeof(BitmapInfoHeader));
+
+        // Sizes past 4 GB are left 0, which readers of uncompressed bitmaps accept.
+        const uint64_t imageSize = static_cast<uint64_t>(fWidth) * 4 * fHeight;
+        const uint64_t fileSize = sizeof(header) + imageSize;
+        header.fileHeader.bfType = 0x4D42; // "BM"
+        header.fileHeader.bfOffBits = sizeof(header);
+        header.fileHeader.bfSize = fileSize <= std::numeric_limits<uint32_t>::max() ? static_cast<uint32_t>(fileSize) : 0;
+        header.infoHeader.biSize = sizeof(BitmapInfoHeader);
+        header.infoHeader.biWidth = static_cast<int32_t>(fWidth);
+        header.infoHeader.biHeight = fFormat == StreamFormat::BmpTopDown ? -static_cast<int32_t>(fHeight) : static_cast<int32_t>(fHeight);
+        header.infoHeader.biPlanes = 1;
+        header.infoHeader.biBitCount = 32;
+        header.infoHeader.biSizeImage = fileSize <= std::numeric_limits<uint32_t>::max() ? static_cast<uint32_t>(imageSize) : 0;
+        fHeaderSize = sizeof(header);
+
+        if (fFormat == StreamFormat::Bmp)
+            WriteAt(fFileDescriptor, reinterpret_cast<const std::byte*>(&header), sizeof(header), 0);
+        else
+            WriteNext(fFileDescriptor, reinterpret_cast<const std::byte*>(&header), sizeof(header));
+    }
+
+    void BitmapStreamWriter::WriteBand(const std::byte* pixels, size_t rowPitch, uint32_t top, uint32_t rows)
+    {
+        if (fFileDescriptor < 0)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::InvalidState, "Bitmap stream is finished");
+        if (top > fHeight || rows > fHeight - top)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "Band is outside the bitmap");
+        if (fFormat != StreamFormat::Bmp && top != fRowsWritten)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::LogicError, "Bands of a top-down bitmap must be written in order");
+        if (rows == 0)
+            return;
+        const auto bandRows = fRowsCovered.begin() + top;
+        if (std::find(bandRows, bandRows + rows, true) != bandRows + rows)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::LogicError, "Band overlaps rows that were already written");
+
+        const size_t rowSize = static_cast<size_t>(fWidth) * 4;
+        const bool bottomUp = fFormat == StreamFormat::Bmp;
+        fBand.resize(rowSize * rows);
+
+        // The rows of a band are contiguous in the file in either direction, each band is one write.
+        LLUTILS_DISABLE_WARNING_PUSH
+        LLUTILS_DISABLE_WARNING_UNSAFE_BUFFER_USAGE
+        for (uint32_t y = 0; y < rows; y++)
+        {
+            const std::byte* sourceRow = pixels + y * rowPitch;
+            std::byte* destRow = fBand.data() + (bottomUp ? rows - 1 - y : y) * rowSize;
+            if (fFormat == StreamFormat::Pam)
+                std::memcpy(destRow, sourceRow, rowSize);
+            else
+                CpuDispatch::SwizzleRGBAToBGRA(sourceRow, destRow, fWidth);
+        }
+        LLUTILS_DISABLE_WARNING_POP
+
+        if (bottomUp)
+            WriteAt(fFileDescriptor, fBand.data(), fBand.size(), fHeaderSize + static_cast<uint64_t>(fHeight - top - rows) * rowSize);
+        else
+            WriteNext(fFileDescriptor, fBand.data(), fBand.size());
+
+        std::fill(bandRows, bandRows + rows, true);
+        fRowsWritten += rows;
+    }
+
+    void BitmapStreamWriter::Finish()
+    {
+        const bool complete = std::find(fRowsCovered.begin(), fRowsCovered.end(), false) == fRowsCovered.end();
+        Close();
+        fBand = std::pmr::vector<std::byte>(fBand.get_allocator());
+        fRowsCovered = std::pmr::vector<bool>(fRowsCovered.get_allocator());
+        if (complete == false)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::LogicError, "Bitmap stream finished before every row was written");
+    }
+}
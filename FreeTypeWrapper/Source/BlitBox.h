@@ -1,6 +1,9 @@
 #pragma once
 #include <cstdint>
 #include <LLUtils/Warnings.h>
+#include <LLUtils/Exception.h>
+#include <type_traits>
+#include "PixelKernels.h"
 namespace FreeType
 {
     struct BlitBox
@@ -34,13 +37,21 @@ namespace FreeType
 
             for (uint32_t y = src.top; y < src.height; y++)
             {
-                for (uint32_t x = 0; x < bytesPerLine; x += sizeof(color_type))
+                if constexpr (std::is_same_v<color_type, LLUtils::ColorF32>)
                 {
-                    using namespace LLUtils;
+                    PixelKernels::GetKernels().blendPremultiplied(reinterpret_cast<LLUtils::ColorF32*>(dstPos)
+                        , reinterpret_cast<const LLUtils::ColorF32*>(srcPos), src.width);
+                }
+                else
+                {
+                    for (uint32_t x = 0; x < bytesPerLine; x += sizeof(color_type))
+                    {
+                        using namespace LLUtils;
 
-                    const color_type &srcColor = *reinterpret_cast<const color_type *>(srcPos + x);
-                    color_type &dstColor = *reinterpret_cast<color_type *>(dstPos + x);
-                    dstColor = dstColor.BlendPreMultiplied(srcColor);
+                        const color_type &srcColor = *reinterpret_cast<const color_type *>(srcPos + x);
+                        color_type &dstColor = *reinterpret_cast<color_type *>(dstPos + x);
+                        dstColor = dstColor.BlendPreMultiplied(srcColor);
+                    }
                 }
                 dstPos += dst.rowPitch;
                 srcPos += src.rowPitch;
@@ -0,0 +1,73 @@
+#include <FreeTypeWrapper/BufferPool.h>
+#include <bit>
+#include <algorithm>
+
+namespace FreeType
+{
+    BufferPool::BufferPool(size_t maxRetainedBytes, std::pmr::memory_resource* memoryResource)
+        : fMemoryResource(memoryResource)
+        , fFreeLists(NumSizeClasses, fMemoryResource)
+        , fMaxRetainedBytes(maxRetainedBytes)
+    {
+
+    }
+
+    size_t BufferPool::GetSizeClassForAcquire(size_t size)
+    {
+        // Smallest class whose buffers are guaranteed to hold 'size' bytes.
+        return size <= 1 ? MinSizeClass : std::max<size_t>(MinSizeClass, static_cast<size_t>(std::bit_width(size - 1)));
+    }
+
+    size_t BufferPool::GetSizeClassForRelease(size_t size)
+    {
+        // Largest class whose nominal size fits in the buffer.
+        return static_cast<size_t>(std::bit_width(size)) - 1;
+    }
+
+    ByteBuffer BufferPool::Acquire(size_t size)
+    {
+        const size_t sizeClass = GetSizeClassForAcquire(size);
+        {
+            std::lock_guard lock(fMutex);
+            auto& freeList = fFreeLists.at(sizeClass);
+            if (freeList.empty() == false)
+            {
+                ByteBuffer buffer = std::move(freeList.back());
+                freeList.pop_back();
+                fRetainedBytes -= buffer.size();
+                return buffer;
+            }
+        }
+
+        // Allocate the full size class so the buffer can serve any request of this class when it is released.
+        return ByteBuffer(size_t{ 1 } << sizeClass, fMemoryResource);
+    }
+
+    void BufferPool::Release(ByteBuffer buffer)
+    {
+        const size_t size = buffer.size();
+        if (size < (size_t{ 1 } << MinSizeClass))
+            return;
+
+        std::lock_guard lock(fMutex);
+        if (fRetainedBytes + size > fMaxRetainedBytes)
+            return;
+
+        fRetainedBytes += size;
+        fFreeLists.at(GetSizeClassForRelease(size)).push_back(std::move(buffer));
+    }
+
+    void BufferPool::Clear()
+    {
+        std::lock_guard lock(fMutex);
+        for (auto& freeList : fFreeLists)
+            freeList.clear();
+        fRetainedBytes = 0;
+    }
+
+    size_t BufferPool::GetRetainedBytes() const
+    {
+        std::lock_guard lock(fMutex);
+        return fRetainedBytes;
+    }
+}
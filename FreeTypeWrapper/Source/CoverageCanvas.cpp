@@ -0,0 +1,130 @@
+#include "CoverageCanvas.h"
+#include <algorithm>
+#include <cstring>
+#include <LLUtils/Exception.h>
+
+namespace FreeType
+{
+    struct CoverageCanvas::SpanTarget
+    {
+        CoverageCanvas* canvas;
+        Layer layer;
+        int32_t originX;
+        int32_t baselineY;
+        uint8_t colorIndex;
+    };
+
+    CoverageCanvas::CoverageCanvas(std::byte* buffer, uint32_t width, uint32_t height, Layout layout)
+        : fBuffer(buffer)
+        , fWidth(width)
+        , fHeight(height)
+        , fLayout(layout)
+    {
+
+    }
+
+    void CoverageCanvas::Clear()
+    {
+        std::memset(fBuffer, 0, GetPlaneSize() * GetBytesPerPixel(fLayout));
+    }
+
+    LLUTILS_DISABLE_WARNING_PUSH
+    LLUTILS_DISABLE_WARNING_UNSAFE_BUFFER_USAGE
+    void CoverageCanvas::AccumulateRun(Layer layer, uint32_t x, uint32_t y, uint32_t length, const uint8_t* coverage, uint8_t constantCoverage, uint8_t colorIndex)
+    {
+        const size_t offset = static_cast<size_t>(y) * fWidth + x;
+        uint8_t* plane = GetFillPlane();
+        size_t stride = 1;
+        uint8_t* indices = nullptr;
+
+        switch (fLayout)
+        {
+        case Layout::Planes:
+            plane = (layer == Layer::Fill ? GetFillPlane() : GetOutlinePlane()) + offset;
+            indices = layer == Layer::Fill ? GetIndexPlane() + offset : nullptr;
+            break;
+        case Layout::Alpha:
+            plane += offset;
+            break;
+        case Layout::AlphaChannels:
+            plane += offset * 2 + (layer == Layer::Fill ? 0 : 1);
+            stride = 2;
+            break;
+        }
+
+        for (uint32_t i = 0; i < length; i++)
+        {
+            const uint8_t value = coverage != nullptr ? coverage[i] : constantCoverage;
+            if (value == 0)
+                continue;
+
+            uint8_t& current = plane[i * stride];
+            current = AddCoverage(current, value);
+            if (indices != nullptr)
+                indices[i] = colorIndex;
+        }
+    }
+
+    void CoverageCanvas::AccumulateBitmap(Layer layer, const FT_Bitmap& bitmap, int32_t left, int32_t top, uint8_t colorIndex)
+    {
+        if (bitmap.pixel_mode != FT_PIXEL_MODE_GRAY && bitmap.pixel_mode != FT_PIXEL_MODE_MONO)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::LogicError, "Coverage canvas accepts gray and mono glyphs only");
+
+        const int32_t beginX = std::max(left, 0);
+        const int32_t endX = std::min(left + static_cast<int32_t>(bitmap.width), static_cast<int32_t>(fWidth));
+        const int32_t beginY = std::max(top, 0);
+        const int32_t endY = std::min(top + static_cast<int32_t>(bitmap.rows), static_cast<int32_t>(fHeight));
+
+        if (beginX >= endX || beginY >= endY)
+            return;
+
+        const uint32_t length = static_cast<uint32_t>(endX - beginX);
+        const uint32_t skipX = static_cast<uint32_t>(beginX - left);
+
+        for (int32_t y = beginY; y < endY; y++)
+        {
+            const uint8_t* sourceRow = bitmap.buffer + static_cast<ptrdiff_t>(y - top) * bitmap.pitch;
+
+            if (bitmap.pixel_mode == FT_PIXEL_MODE_GRAY)
+            {
+                AccumulateRun(layer, static_cast<uint32_t>(beginX), static_cast<uint32_t>(y), length, sourceRow + skipX, 0, colorIndex);
+            }
+            else
+            {
+                for (uint32_t x = 0; x < length; x++)
+                {
+                    const uint32_t bit = skipX + x;
+                    if ((sourceRow[bit >> 3] & (0x80 >> (bit & 7))) != 0)
+                        AccumulateRun(layer, static_cast<uint32_t>(beginX) + x, static_cast<uint32_t>(y), 1, nullptr, 255, colorIndex);
+                }
+            }
+        }
+    }
+
+    void CoverageCanvas::AccumulateSpans(int y, int count, const FT_Span* spans, void* user)
+    {
+        const SpanTarget& target = *static_cast<const SpanTarget*>(user);
+        CoverageCanvas& canvas = *target.canvas;
+
+        // Outline coordinates go up from the baseline, canvas rows go down.
+        const int32_t row = target.baselineY - 1 - y;
+        if (row < 0 || row >= static_cast<int32_t>(canvas.fHeight))
+            return;
+
+        for (int i = 0; i < count; i++)
+        {
+            const FT_Span& span = spans[i];
+            const int32_t begin = std::max<int32_t>(target.originX + span.x, 0);
+            const int32_t end = std::min<int32_t>(target.originX + span.x + span.len, static_cast<int32_t>(canvas.fWidth));
+            if (begin < end)
+                canvas.AccumulateRun(target.layer, static_cast<uint32_t>(begin), static_cast<uint32_t>(row), static_cast<uint32_t>(end - begin), nullptr, span.coverage, target.colorIndex);
+        }
+    }
+    LLUTILS_DISABLE_WARNING_POP
+
+    void CoverageCanvas::AccumulateOutline(FT_Library library, Layer layer, FT_Outline& outline, int32_t originX, int32_t baselineY, uint8_t colorIndex)
+    {
+        SpanTarget target{ this, layer, originX, baselineY, colorIndex };
+        FreeTypeRenderer::RenderOutlineSpans(library, outline, fWidth, fHeight, &AccumulateSpans, &target, target.originX, target.baselineY);
+    }
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <array>
+#include <span>
+#include <LLUtils/Color.h>
+#include <LLUtils/Warnings.h>
+#include <FreeTypeHeaders.h>
+#include <FreeTypeRenderer.h>
+#include "PixelKernels.h"
+
+namespace FreeType
+{
+    // Keeps the coverage of the text fill and of the outline as two 8 bit planes, plus a plane with the palette index of
+    // the fill color, instead of two premultiplied ColorF32 canvases. The background, outline and fill are composited and
+    // resolved to 8 bit in a single pass, 3 bytes per pixel are written while drawing instead of 32.
+    // Coverage masks are accumulated straight in their output format instead, without the index plane.
+    // The canvas doesn't own its pixels.
+    class CoverageCanvas
+    {
+    public:
+        enum class Layer
+        {
+              Fill
+            , Outline
+        };
+
+        enum class Layout
+        {
+            // Fill, outline and fill palette index planes.
+              Planes
+            // Fill and outline accumulated together, one byte per pixel as in BitmapFormat::A8.
+            , Alpha
+            // Fill and outline interleaved, two bytes per pixel as in BitmapFormat::A8x2.
+            , AlphaChannels
+        };
+
+        // Of the Planes layout.
+        static constexpr size_t BytesPerPixel = 3;
+
+        CoverageCanvas(std::byte* buffer, uint32_t width, uint32_t height, Layout layout = Layout::Planes);
+
+        // Zeroes all planes, must be called once before accumulating coverage.
+        void Clear();
+
+        // Accumulates a gray or mono glyph bitmap whose top left corner is at left / top, clipped to the canvas.
+        void AccumulateBitmap(Layer layer, const FT_Bitmap& bitmap, int32_t left, int32_t top, uint8_t colorIndex = 0);
+
+        // Rasterizes an outline as coverage spans straight into the layer, originX and baselineY are the canvas
+        // position of the outline's origin.
+        void AccumulateOutline(FT_Library library, Layer layer, FT_Outline& outline, int32_t originX, int32_t baselineY, uint8_t colorIndex = 0);
+
+        // Composites background, outline and fill for every pixel of the Planes layout and resolves the result with
+        // resolveRow, called as resolveRow(Color* dest, const ColorF32* source, size_t count) for consecutive runs of pixels.
+        template <typename resolve_row_func>
+        void Resolve(LLUtils::Color* dest, const LLUtils::ColorF32& backgroundPremultiplied
+            , const FreeTypeRenderer::CoverageColorTable& outlineColors
+            , std::span<const FreeTypeRenderer::CoverageColorTable> fillColors
+            , resolve_row_func resolveRow) const;
+
+    private:
+        struct SpanTarget;
+        static void AccumulateSpans(int y, int count, const FT_Span* spans, void* user);
+
+        static size_t GetBytesPerPixel(Layout layout) { return layout == Layout::Planes ? BytesPerPixel : layout == Layout::Alpha ? 1 : 2; }
+        size_t GetPlaneSize() const { return static_cast<size_t>(fWidth) * fHeight; }
+        uint8_t* GetFillPlane() const { return reinterpret_cast<uint8_t*>(fBuffer); }
+        uint8_t* GetOutlinePlane() const { return GetFillPlane() + GetPlaneSize(); }
+        uint8_t* GetIndexPlane() const { return GetFillPlane() + 2 * GetPlaneSize(); }
+        void AccumulateRun(Layer layer, uint32_t x, uint32_t y, uint32_t length, const uint8_t* coverage, uint8_t constantCoverage, uint8_t colorIndex);
+
+        // Coverage of two shapes laid over each other, the same 'over' operator alpha blending uses.
+        static uint8_t AddCoverage(uint8_t current, uint8_t coverage)
+        {
+            return static_cast<uint8_t>(current + ((255 - current) * coverage + 127) / 255);
+        }
+
+    private:
+        std::byte* fBuffer;
+        uint32_t fWidth;
+        uint32_t fHeight;
+        Layout fLayout;
+    };
+
+    LLUTILS_DISABLE_WARNING_PUSH
+    LLUTILS_DISABLE_WARNING_UNSAFE_BUFFER_USAGE
+    template <typename resolve_row_func>
+    void CoverageCanvas::Resolve(LLUtils::Color* dest, const LLUtils::ColorF32& backgroundPremultiplied
+        , const FreeTypeRenderer::CoverageColorTable& outlineColors
+        , std::span<const FreeTypeRenderer::CoverageColorTable> fillColors
+        , resolve_row_func resolveRow) const
+    {
+        // Fill tables by palette index. Unused indices are only ever read at zero coverage, through pixels no fill was drawn to.
+        std::array<const LLUtils::ColorF32*, 256> fillTables;
+        fillTables.fill(outlineColors.grayColors.data());
+        for (size_t i = 0; i < std::min(fillColors.size(), fillTables.size()); i++)
+            fillTables[i] = fillColors[i].grayColors.data();
+
+        // The planes have no row padding, composite them in chunks that stay in the L1 cache until resolved.
+        constexpr size_t ChunkSize = 256;
+        std::array<LLUtils::ColorF32, ChunkSize> composited;
+        const PixelKernels::KernelTable& kernels = PixelKernels::GetKernels();
+        const size_t numPixels = GetPlaneSize();
+
+        for (size_t i = 0; i < numPixels; i += ChunkSize)
+        {
+            const size_t count = std::min(ChunkSize, numPixels - i);
+            kernels.compositeCoverage(composited.data(), GetFillPlane() + i, GetOutlinePlane() + i, GetIndexPlane() + i, count
+                , backgroundPremultiplied, outlineColors.grayColors.data(), fillTables.data());
+            resolveRow(dest + i, composited.data(), count);
+        }
+    }
+    LLUTILS_DISABLE_WARNING_POP
+}
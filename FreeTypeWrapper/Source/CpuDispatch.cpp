@@ -0,0 +1,236 @@
+#include <FreeTypeWrapper/CpuDispatch.h>
+#include "PixelKernels.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <optional>
+#include <string>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #define FREETYPE_WRAPPER_X86 1
+    #include <intrin.h>
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    #define FREETYPE_WRAPPER_X86 1
+    #include <cpuid.h>
+#else
+    #define FREETYPE_WRAPPER_X86 0
+#endif
+
+namespace FreeType
+{
+    namespace
+    {
+        constexpr const char* CpuLevelEnvironmentVariable = "FREETYPE_WRAPPER_CPU_LEVEL";
+
+#if FREETYPE_WRAPPER_X86
+        struct CpuIdRegisters
+        {
+            uint32_t eax = 0;
+            uint32_t ebx = 0;
+            uint32_t ecx = 0;
+            uint32_t edx = 0;
+        };
+
+        CpuIdRegisters CpuId(uint32_t leaf, uint32_t subLeaf)
+        {
+            CpuIdRegisters registers;
+#if defined(_MSC_VER)
+            int values[4];
+            __cpuidex(values, static_cast<int>(leaf), static_cast<int>(subLeaf));
+            registers = { static_cast<uint32_t>(values[0]), static_cast<uint32_t>(values[1]), static_cast<uint32_t>(values[2]), static_cast<uint32_t>(values[3]) };
+#else
+            __cpuid_count(leaf, subLeaf, registers.eax, registers.ebx, registers.ecx, registers.edx);
+#endif
+            return registers;
+        }
+
+        // Register state the operating system saves on context switches.
+        uint64_t GetEnabledXSaveFeatures()
+        {
+#if defined(_MSC_VER)
+            return _xgetbv(0);
+#else
+            uint32_t low;
+            uint32_t high;
+            __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+            return (static_cast<uint64_t>(high) << 32) | low;
+#endif
+        }
+
+        CpuLevel DetectProcessorLevel()
+        {
+            const uint32_t maxLeaf = CpuId(0, 0).eax;
+            if (maxLeaf < 1)
+                return CpuLevel::Scalar;
+
+            const CpuIdRegisters leaf1 = CpuId(1, 0);
+            const bool sse41 = (leaf1.ecx & (1u << 19)) != 0;
+            if (!sse41)
+                return CpuLevel::Scalar;
+
+            const bool osxsave = (leaf1.ecx & (1u << 27)) != 0;
+            const bool avx = (leaf1.ecx & (1u << 28)) != 0;
+            if (!osxsave || !avx || maxLeaf < 7)
+                return CpuLevel::SSE41;
+
+            // XMM and YMM state, then opmask and both halves of the ZMM state.
+            const uint64_t xsaveFeatures = GetEnabledXSaveFeatures();
+            const bool osSavesYmm = (xsaveFeatures & 0x6) == 0x6;
+            const bool osSavesZmm = (xsaveFeatures & 0xE6) == 0xE6;
+
+            const CpuIdRegisters leaf7 = CpuId(7, 0);
+            const bool avx2 = (leaf7.ebx & (1u << 5)) != 0;
+            const bool avx512 = (leaf7.ebx & (1u << 16)) != 0 // F
+                && (leaf7.ebx & (1u << 30)) != 0  // BW
+                && (leaf7.ebx & (1u << 31)) != 0; // VL
+
+            if (!avx2 || !osSavesYmm)
+                return CpuLevel::SSE41;
+
+            return avx512 && osSavesZmm ? CpuLevel::AVX512 : CpuLevel::AVX2;
+        }
+#else
+        CpuLevel DetectProcessorLevel()
+        {
+            return CpuLevel::Scalar;
+        }
+#endif
+
+        const PixelKernels::KernelTable* GetCompiledKernels(CpuLevel level)
+        {
+            switch (level)
+            {
+            case CpuLevel::Scalar:
+                return PixelKernels::GetKernelsScalar();
+            case CpuLevel::SSE41:
+                return PixelKernels::GetKernelsSSE41();
+            case CpuLevel::AVX2:
+                return PixelKernels::GetKernelsAVX2();
+            case CpuLevel::AVX512:
+                return PixelKernels::GetKernelsAVX512();
+            }
+            return nullptr;
+        }
+
+        CpuLevel DetectSupportedLevel()
+        {
+            CpuLevel level = DetectProcessorLevel();
+            while (level != CpuLevel::Scalar && GetCompiledKernels(level) == nullptr)
+                level = static_cast<CpuLevel>(static_cast<uint8_t>(level) - 1);
+            return level;
+        }
+
+        std::optional<std::string> ReadEnvironmentVariable(const char* name)
+        {
+#if defined(_MSC_VER)
+            char* value = nullptr;
+            size_t length = 0;
+            if (_dupenv_s(&value, &length, name) != 0 || value == nullptr)
+                return std::nullopt;
+            std::string result(value);
+            std::free(value);
+            return result;
+#else
+            const char* value = std::getenv(name);
+            if (value == nullptr)
+                return std::nullopt;
+            return std::string(value);
+#endif
+        }
+
+        CpuLevel Clamp(CpuLevel level)
+        {
+            const CpuLevel supported = CpuDispatch::GetSupportedLevel();
+            return static_cast<uint8_t>(level) > static_cast<uint8_t>(supported) ? supported : level;
+        }
+
+        std::atomic<const PixelKernels::KernelTable*>& GetActiveKernels()
+        {
+            static std::atomic<const PixelKernels::KernelTable*> activeKernels = []
+            {
+                CpuLevel level = CpuDispatch::GetSupportedLevel();
+                CpuLevel requestedLevel;
+                if (const auto environmentLevel = ReadEnvironmentVariable(CpuLevelEnvironmentVariable)
+                    ; environmentLevel.has_value() && CpuDispatch::ParseLevel(*environmentLevel, requestedLevel))
+                {
+                    level = Clamp(requestedLevel);
+                }
+
+                return GetCompiledKernels(level);
+            }();
+
+            return activeKernels;
+        }
+    }
+
+    CpuLevel CpuDispatch::GetSupportedLevel()
+    {
+        static const CpuLevel supportedLevel = DetectSupportedLevel();
+        return supportedLevel;
+    }
+
+    CpuLevel CpuDispatch::GetActiveLevel()
+    {
+        return GetActiveKernels().load(std::memory_order_acquire)->level;
+    }
+
+    CpuLevel CpuDispatch::SetActiveLevel(CpuLevel level)
+    {
+        const CpuLevel activeLevel = Clamp(level);
+        GetActiveKernels().store(GetCompiledKernels(activeLevel), std::memory_order_release);
+        return activeLevel;
+    }
+
+    const char* CpuDispatch::GetLevelName(CpuLevel level)
+    {
+        switch (level)
+        {
+        case CpuLevel::Scalar:
+            return "scalar";
+        case CpuLevel::SSE41:
+            return "sse4.1";
+        case CpuLevel::AVX2:
+            return "avx2";
+        case CpuLevel::AVX512:
+            return "avx512";
+        }
+        return "unknown";
+    }
+
+    bool CpuDispatch::ParseLevel(std::string_view name, CpuLevel& out_level)
+    {
+        for (uint8_t i = 0; i <= static_cast<uint8_t>(CpuLevel::AVX512); i++)
+        {
+            const CpuLevel level = static_cast<CpuLevel>(i);
+            const std::string_view levelName = GetLevelName(level);
+            const bool sameName = name.size() == levelName.size() && std::equal(name.begin(), name.end(), levelName.begin()
+                , [](char a, char b) { return (a >= 'A' && a <= 'Z' ? static_cast<char>(a - 'A' + 'a') : a) == b; });
+
+            if (sameName || (name.size() == 1 && name[0] == static_cast<char>('0' + i)))
+            {
+                out_level = level;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void CpuDispatch::SwizzleRGBAToBGRA(const std::byte* source, std::byte* dest, size_t numPixels)
+    {
+        PixelKernels::GetKernels().swizzleRGBAToBGRA(source, dest, numPixels);
+    }
+
+    namespace PixelKernels
+    {
+        const KernelTable& GetKernels()
+        {
+            return *GetActiveKernels().load(std::memory_order_acquire);
+        }
+
+        const KernelTable* GetKernels(CpuLevel level)
+        {
+            return static_cast<uint8_t>(level) > static_cast<uint8_t>(CpuDispatch::GetSupportedLevel()) ? nullptr : GetCompiledKernels(level);
+        }
+    }
+}
@@ -3,20 +3,37 @@
 #include <string>
 #include <iostream>
 #include <span>
+#include <atomic>
+#include <thread>
+#include <bit>
+#include <numeric>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <exception>
 
 #include <FreeTypeWrapper/FreeTypeConnector.h>
+#include <FreeTypeWrapper/GlyphAtlas.h>
 #include <FreeTypeRenderer.h>
 #include <FreeTypeFont.h>
+#include <FreeTypeMemory.h>
 
 #include <LLUtils/Exception.h>
 #include <LLUtils/StringUtility.h>
 #include <LLUtils/Utility.h>
 #include <LLUtils/Color.h>
-#include <LLUtils/Buffer.h>
 #include <LLUtils/BitFlags.h>
 
 #include "BlitBox.h"
 #include "MetaTextParser.h"
+#include "GammaTables.h"
+#include "SparseCanvas.h"
+#include "CoverageCanvas.h"
+#include "BitCanvas.h"
+#include "SdfGlyphCache.h"
+#include "MsdfGenerator.h"
+#include "ShelfPacker.h"
+#include "PixelKernels.h"
 #if FREETYPE_WRAPPER_BUILD_FRIBIDI == 1
 LLUTILS_DISABLE_WARNING_PUSH
 LLUTILS_DISABLE_WARNING_UNDEF
@@ -31,24 +48,110 @@ LLUTILS_DISABLE_WARNING_UNSAFE_BUFFER_USAGE
 LLUTILS_DISABLE_WARNING_POP
 
 
+// Module classes of the individual FreeType drivers and renderers, used when registering a subset of the modules.
+// Declared from the module list of the FreeType build, the way ftinit.c does, each with its own class type.
+// They aren't exported by a shared FreeType, see CMakeLists.txt.
+#if FREETYPE_WRAPPER_MODULE_SUBSETS
+LLUTILS_DISABLE_WARNING_PUSH
+LLUTILS_DISABLE_WARNING_RESEREVED_IDENTIFIER
+    #include <freetype/internal/ftobjs.h>
+LLUTILS_DISABLE_WARNING_POP
+#define FREETYPE_WRAPPER_DECLARE_FT_Module_Class(moduleClass) FT_DECLARE_MODULE(moduleClass)
+#define FREETYPE_WRAPPER_DECLARE_FT_Renderer_Class(moduleClass) FT_DECLARE_RENDERER(moduleClass)
+#define FREETYPE_WRAPPER_DECLARE_FT_Driver_ClassRec(moduleClass) FT_DECLARE_DRIVER(moduleClass)
+#undef FT_USE_MODULE
+#define FT_USE_MODULE(type, moduleClass) FREETYPE_WRAPPER_DECLARE_##type(moduleClass)
+#include FT_CONFIG_MODULES_H
+#undef FT_USE_MODULE
+#endif
+
 namespace FreeType
 {
 
 
 
-    FreeTypeConnector::FreeTypeConnector()
+    FreeTypeConnector::FreeTypeConnector(std::pmr::memory_resource* memoryResource)
+        : FreeTypeConnector(ConnectorCreateParams{ memoryResource, FreeTypeModules::All })
     {
 
-        if (FT_Error error = FT_Init_FreeType(&fLibrary); error != FT_Err_Ok)
-            LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, GenerateFreeTypeErrorString("can not load glyph", error));
+    }
+
+    FreeTypeConnector::FreeTypeConnector(const ConnectorCreateParams& createParams)
+        : fMemoryResource(createParams.memoryResource)
+        , fFreeTypeMemory(std::make_unique<FreeTypeMemory>(createParams.memoryResource))
+        , fFontNameToFont(createParams.memoryResource)
+    {
+        // Equivalent of FT_Init_FreeType, but with FreeType's allocations routed through our own FT_Memory.
+        if (FT_Error error = FT_New_Library(fFreeTypeMemory->GetFTMemory(), &fLibrary); error != FT_Err_Ok)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, GenerateFreeTypeErrorString("can not create library", error));
 
+        AddModules(createParams.modules);
+        FT_Set_Default_Properties(fLibrary);
+    }
+
+    void FreeTypeConnector::AddModules(FreeTypeModules modules)
+    {
+        const LLUtils::BitFlags<FreeTypeModules> moduleFlags{ modules };
+
+        if (moduleFlags.test(FreeTypeModules::All))
+        {
+            FT_Add_Default_Modules(fLibrary);
+            return;
+        }
+
+#if FREETYPE_WRAPPER_MODULE_SUBSETS
+        std::vector<const FT_Module_Class*> moduleClasses;
+
+        // Font format helpers must be registered before the drivers that use them.
+        if (moduleFlags.test(FreeTypeModules::TrueType) || moduleFlags.test(FreeTypeModules::CFF))
+            moduleClasses.push_back(&sfnt_module_class);
+
+        if (moduleFlags.test(FreeTypeModules::CFF))
+        {
+            moduleClasses.push_back(&psnames_module_class);
+            moduleClasses.push_back(&psaux_module_class);
+            moduleClasses.push_back(&pshinter_module_class);
+        }
+
+        if (moduleFlags.test(FreeTypeModules::AutoHinter))
+            moduleClasses.push_back(&autofit_module_class);
+
+        if (moduleFlags.test(FreeTypeModules::TrueType))
+            moduleClasses.push_back(&tt_driver_class.root);
+
+        if (moduleFlags.test(FreeTypeModules::CFF))
+            moduleClasses.push_back(&cff_driver_class.root);
+
+        if (moduleFlags.test(FreeTypeModules::Smooth))
+            moduleClasses.push_back(&ft_smooth_renderer_class.root);
+
+        if (moduleFlags.test(FreeTypeModules::Mono))
+            moduleClasses.push_back(&ft_raster1_renderer_class.root);
+
+        if (moduleFlags.test(FreeTypeModules::SignedDistanceField))
+        {
+            moduleClasses.push_back(&ft_sdf_renderer_class.root);
+            moduleClasses.push_back(&ft_bitmap_sdf_renderer_class.root);
+        }
+
+        for (const FT_Module_Class* moduleClass : moduleClasses)
+        {
+            if (FT_Error error = FT_Add_Module(fLibrary, moduleClass); error != FT_Err_Ok)
+                LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, GenerateFreeTypeErrorString("can not add module", error));
+        }
+#else
+        // Only every module can be registered with a shared FreeType.
+        FT_Add_Default_Modules(fLibrary);
+#endif
     }
 
     FreeTypeConnector::~FreeTypeConnector()
     {
+        fSdfGlyphCache.reset();
         fFontNameToFont.clear();
         FT_Stroker_Done(fStroker);
-        FT_Error error = FT_Done_FreeType(fLibrary);
+        // The memory object is owned by the connector, so only the library is released here, unlike FT_Done_FreeType.
+        FT_Error error = FT_Done_Library(fLibrary);
         if (error)
         {
             //TODO: destory freetype library eariler before object destruction.
@@ -64,6 +167,91 @@ namespace FreeType
     }
 
 
+    namespace
+    {
+        void BlendGlyph(const FreeTypeRenderer::GlyphRGBAParams& glyphParams, BlitBox& dest, std::pmr::memory_resource* memoryResource)
+        {
+            using namespace LLUtils;
+
+            // Monochrome glyphs are blended bit by bit straight into the canvas.
+            if (glyphParams.bitmapGlyph->bitmap.pixel_mode == FT_PIXEL_MODE_MONO)
+            {
+                FreeTypeRenderer::BlendMonoGlyph(glyphParams, dest);
+                return;
+            }
+
+            ByteBuffer rasterizedGlyph = FreeTypeRenderer::RenderGlyphToBuffer(glyphParams, memoryResource);
+
+            BlitBox source = {};
+            source.buffer = rasterizedGlyph.data();
+            source.width = glyphParams.bitmapProperties.width;
+            source.height = glyphParams.bitmapProperties.height;
+            source.pixelSizeInbytes = sizeof(ColorF32);
+            source.rowPitch = static_cast<uint32_t>(sizeof(ColorF32)) * glyphParams.bitmapProperties.width;
+
+            BlitBox::BlitPremultiplied<ColorF32>(dest, source);
+        }
+
+        // Marks the pixels covered by an outline whose origin is at originX / baselineY as drawn.
+        void TouchOutline(SparseCanvas& canvas, const FT_Outline& outline, int32_t originX, int32_t baselineY)
+        {
+            FT_BBox box;
+            FT_Outline_Get_CBox(&outline, &box);
+            const int32_t left = static_cast<int32_t>(box.xMin >> 6);
+            const int32_t right = static_cast<int32_t>((box.xMax + 63) >> 6);
+            const int32_t bottom = static_cast<int32_t>(box.yMin >> 6);
+            const int32_t top = static_cast<int32_t>((box.yMax + 63) >> 6);
+            canvas.Touch(originX + left, baselineY - top, right - left, top - bottom);
+        }
+
+        void ResolveLinearRow(LLUtils::Color* dest, const LLUtils::ColorF32* source, size_t count)
+        {
+            for (size_t i = 0; i < count; i++)
+                dest[i] = GammaTables::FromLinear(source[i].DivideAlpha());
+        }
+
+        void ResolveCoverage(const CoverageCanvas& canvas, LLUtils::Color* dest, const LLUtils::ColorF32& backgroundPremultiplied
+            , const FreeTypeRenderer::CoverageColorTable& outlineColors, std::span<const FreeTypeRenderer::CoverageColorTable> fillColors, bool linearBlending)
+        {
+            if (linearBlending)
+                canvas.Resolve(dest, backgroundPremultiplied, outlineColors, fillColors, &ResolveLinearRow);
+            else
+                canvas.Resolve(dest, backgroundPremultiplied, outlineColors, fillColors, PixelKernels::GetKernels().resolve);
+        }
+
+        // Packs atlas glyphs tallest first into a power of two width close to the square root of their total area, one
+        // pixel apart so that sampling bilinearly never reads a neighbour. The order only depends on the glyphs, so the
+        // layout is the same on every run. Empty glyphs aren't packed. Returns the atlas width.
+        template <typename Glyphs>
+        uint32_t PackAtlas(Glyphs& glyphs, uint32_t& out_height, std::pmr::memory_resource* memoryResource)
+        {
+            std::pmr::vector<size_t> packOrder(glyphs.size(), memoryResource);
+            std::iota(packOrder.begin(), packOrder.end(), size_t{ 0 });
+            std::stable_sort(packOrder.begin(), packOrder.end(), [&](size_t a, size_t b) { return glyphs[a].height > glyphs[b].height; });
+
+            constexpr uint32_t spacing = 1;
+            uint64_t area = 0;
+            uint32_t atlasWidth = 1;
+            for (const auto& glyph : glyphs)
+            {
+                area += static_cast<uint64_t>(glyph.width + spacing) * (glyph.height + spacing);
+                atlasWidth = std::max(atlasWidth, glyph.width);
+            }
+            atlasWidth = std::max(atlasWidth, std::bit_ceil(static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(area))))));
+
+            ShelfPacker packer(atlasWidth, std::numeric_limits<uint32_t>::max(), spacing, memoryResource);
+            for (const size_t index : packOrder)
+            {
+                auto& glyph = glyphs[index];
+                if (glyph.width > 0 && glyph.height > 0 && packer.Pack(glyph.width, glyph.height, glyph.atlasX, glyph.atlasY) == false)
+                    LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, "Glyph doesn't fit the atlas");
+            }
+
+            out_height = std::max(packer.GetUsedHeight(), 1u);
+            return atlasWidth;
+        }
+    }
+
     template <typename string_type>
     std::u32string bidi_string(const string_type& logical)
     {
@@ -93,6 +281,54 @@ namespace FreeType
 #endif
     }
 
+    struct FreeTypeConnector::GlyphPlacement
+    {
+        size_t entryIndex;
+        FT_UInt glyphIndex;
+        // Pen position from 0 at the start of every line.
+        int32_t penX;
+        uint32_t line;
+        int32_t advance;
+    };
+
+    template <typename FormattedText, typename GlyphHandler>
+    uint32_t FreeTypeConnector::LayOutText(FT_Face face, const FormattedText& formattedText, bool bidirectional, uint32_t maxWidthPx, GlyphHandler&& onGlyph)
+    {
+        int32_t penX = 0;
+        uint32_t line = 0;
+        for (size_t entryIndex = 0; entryIndex < formattedText.size(); entryIndex++)
+        {
+            const auto& el = formattedText[entryIndex];
+            const std::u32string visualText = bidirectional ? bidi_string(el.text.c_str()) : ww898::utf::conv<char32_t>(el.text);
+
+            for (const char32_t codepoint : visualText)
+            {
+                if (codepoint == U'\n')
+                {
+                    penX = 0;
+                    line++;
+                    continue;
+                }
+
+                const FT_UInt glyphIndex = FT_Get_Char_Index(face, codepoint);
+                if (FT_Error error = FT_Load_Glyph(face, glyphIndex, FT_LOAD_DEFAULT); error != FT_Err_Ok)
+                    LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, GenerateFreeTypeErrorString("can not Load glyph", error));
+
+                const int32_t advance = static_cast<int32_t>(face->glyph->advance.x >> 6);
+                if (maxWidthPx > 0 && penX + advance > static_cast<int32_t>(maxWidthPx))
+                {
+                    penX = 0;
+                    line++;
+                }
+
+                onGlyph(GlyphPlacement{ entryIndex, glyphIndex, penX, line, advance });
+                penX += advance;
+            }
+        }
+
+        return line + 1;
+    }
+
 
     
     void FreeTypeConnector::MeasureText(const TextMesureParams& measureParams, TextMetrics& mesureResult)
@@ -113,7 +349,8 @@ namespace FreeType
         FT_Render_Mode textRenderMOde = FreeTypeRenderer::GetRenderMode(textCreateParams.renderMode);
         FT_Render_Mode outlineRenderMode = FreeTypeRenderer::GetRenderMode(textCreateParams.renderMode);
         const bool renderOutline = OutlineWidth > 0;
-        mesureResult = {};
+        const bool distanceFields = textCreateParams.renderMode == RenderMode::SignedDistanceField && textCreateParams.bitmapFormat != BitmapFormat::A1;
+        mesureResult = TextMetrics(mesureResult.lineMetrics.get_allocator().resource());
         if (measureParams.createParams.text.empty() == false)
         {
 
@@ -123,15 +360,12 @@ namespace FreeType
             FreeTypeFont* font = GetOrCreateFont(fontPath);
             font->SetSize(fontSize, textCreateParams.DPIx, textCreateParams.DPIy);
 
-            int32_t penX{};
-            //int32_t penY{};
             mesureResult.lineMetrics.push_back({});
             LineMetrics* currentLine = &mesureResult.lineMetrics.back();
 
-
             FT_Face face = font->GetFace();
             const int32_t descender = face->size->metrics.descender >> 6;
-            const uint32_t rowHeight = (static_cast<uint32_t>(face->size->metrics.height) >> 6) + textCreateParams.outlineWidth * 2;
+            const uint32_t rowHeight = GetRowHeight(face, textCreateParams.outlineWidth);
 
             vector<FormattedTextEntry> formattedText;
 
@@ -140,92 +374,81 @@ namespace FreeType
             else
                 formattedText.push_back({ textCreateParams.textColor, textCreateParams.text });
 
-            for (const FormattedTextEntry& el : formattedText)
+            const uint32_t lineCount = LayOutText(face, formattedText, usebidiText, textCreateParams.maxWidthPx, [&](const GlyphPlacement& placement)
             {
-                const std::u32string visualText = usebidiText ? bidi_string(el.text.c_str()) : ww898::utf::conv<char32_t>(el.text);
-
-                for (const decltype(visualText)::value_type& codepoint : visualText)
+                if (placement.line >= mesureResult.lineMetrics.size())
                 {
-                    if (codepoint == L'\n')
-                    {
-                        penX = 0;
-                        //penY += rowHeight;
-                        mesureResult.lineMetrics.push_back({});
-                        currentLine = &mesureResult.lineMetrics.back();
-                        continue;
-                    }
-
-
-                    const FT_UInt glyph_index = FT_Get_Char_Index(face, codepoint);
-                    if (FT_Error error = FT_Load_Glyph(
-                        face,          /* handle to face object */
-                        glyph_index,   /* glyph index           */
-                        FT_LOAD_DEFAULT); error != FT_Err_Ok)/* load flags, see below */
-                    {
-                        LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, GenerateFreeTypeErrorString("can not Load glyph", error));
-                    }
-
-
-                    //measure outline
-                    const auto advance = face->glyph->advance.x >> 6;
-
-                    if (textCreateParams.maxWidthPx > 0 && penX + advance > static_cast<int>(textCreateParams.maxWidthPx))
-                    {
-                        //penY += rowHeight;
-                        penX = 0;
-                        mesureResult.lineMetrics.push_back({});
-                        currentLine = &mesureResult.lineMetrics.back();
-                    }
-
-                    // measure outline
-                    if (renderOutline)
-                    {
-                        FT_BitmapGlyph bitmapGlyph = FreeTypeRenderer::GetStrokerGlyph(GetStroker(), face->glyph, OutlineWidth, outlineRenderMode);
-                        FreeTypeRenderer::BitmapProperties bitmapProperties = FreeTypeRenderer::GetBitmapGlyphProperties(bitmapGlyph->bitmap);
-                        auto width = bitmapProperties.width;
-                        auto height = bitmapProperties.height;
-                        auto left = bitmapGlyph->left;
-                        auto top = bitmapGlyph->top;
-
-                        currentLine->maxGlyphHeight = std::max<int32_t>(currentLine->maxGlyphHeight, static_cast<int32_t>(height) - top);
-
-                        mesureResult.minX = std::min<int32_t>(mesureResult.minX, left + penX);
-                        mesureResult.maxX = std::max<int32_t>(mesureResult.maxX, left + static_cast<int32_t>(width) + penX);
-                        FT_Done_Glyph(reinterpret_cast<FT_Glyph>(bitmapGlyph));
-                    }
-
-                    // Measure Text
+                    mesureResult.lineMetrics.resize(placement.line + 1);
+                    currentLine = &mesureResult.lineMetrics.back();
+                }
 
-                    FT_Glyph glyph;
-                    if (FT_Error error = FT_Get_Glyph(face->glyph, &glyph))
-                        LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, "FreeType error, unable to render glyph");
+                const int32_t penX = placement.penX;
+                if (lineEndFixedWidth)
+                    mesureResult.maxX = std::max(penX + placement.advance, mesureResult.maxX);
 
-                    if (glyph->format != FT_GLYPH_FORMAT_BITMAP)
-                    {
-                        if (FT_Error error = FT_Glyph_To_Bitmap(&glyph, textRenderMOde, nullptr, true); error != FT_Err_Ok)
-                            LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, "FreeType error, unable to render glyph");
-                    }
+                if (distanceFields && face->glyph->format == FT_GLYPH_FORMAT_OUTLINE)
+                {
+                    // Distance fields are resampled rather than rasterized, measure the control box instead, padded
+                    // by a pixel for the resampled edge and by the outline width for the dilated outline.
+                    FT_BBox box;
+                    FT_Outline_Get_CBox(&face->glyph->outline, &box);
+                    const int32_t padding = 1 + static_cast<int32_t>(OutlineWidth);
+                    const int32_t left = static_cast<int32_t>(box.xMin >> 6) - padding;
+                    const int32_t right = static_cast<int32_t>((box.xMax + 63) >> 6) + padding;
+                    const int32_t bottom = static_cast<int32_t>(box.yMin >> 6) - padding;
+
+                    currentLine->maxGlyphHeight = std::max<int32_t>(currentLine->maxGlyphHeight, -bottom);
+                    mesureResult.minX = std::min<int32_t>(mesureResult.minX, left + penX);
+                    mesureResult.maxX = std::max<int32_t>(mesureResult.maxX, right + penX);
+                    return;
+                }
 
-                    FT_BitmapGlyph bitmapGlyph = reinterpret_cast<FT_BitmapGlyph>(glyph);
+                // measure outline
+                if (renderOutline)
+                {
+                    FT_BitmapGlyph bitmapGlyph = FreeTypeRenderer::GetStrokerGlyph(GetStroker(), face->glyph, OutlineWidth, outlineRenderMode);
                     FreeTypeRenderer::BitmapProperties bitmapProperties = FreeTypeRenderer::GetBitmapGlyphProperties(bitmapGlyph->bitmap);
-
-
                     auto width = bitmapProperties.width;
                     auto height = bitmapProperties.height;
                     auto left = bitmapGlyph->left;
                     auto top = bitmapGlyph->top;
 
                     currentLine->maxGlyphHeight = std::max<int32_t>(currentLine->maxGlyphHeight, static_cast<int32_t>(height) - top);
+
                     mesureResult.minX = std::min<int32_t>(mesureResult.minX, left + penX);
                     mesureResult.maxX = std::max<int32_t>(mesureResult.maxX, left + static_cast<int32_t>(width) + penX);
+                    FT_Done_Glyph(reinterpret_cast<FT_Glyph>(bitmapGlyph));
+                }
 
-                    penX += advance;
+                // Measure Text
 
-                    if (lineEndFixedWidth)
-                        mesureResult.maxX = std::max(penX, mesureResult.maxX);
+                FT_Glyph glyph;
+                if (FT_Error error = FT_Get_Glyph(face->glyph, &glyph))
+                    LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, "FreeType error, unable to render glyph");
 
+                if (glyph->format != FT_GLYPH_FORMAT_BITMAP)
+                {
+                    if (FT_Error error = FT_Glyph_To_Bitmap(&glyph, textRenderMOde, nullptr, true); error != FT_Err_Ok)
+                        LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, "FreeType error, unable to render glyph");
                 }
-            }
+
+                FT_BitmapGlyph bitmapGlyph = reinterpret_cast<FT_BitmapGlyph>(glyph);
+                FreeTypeRenderer::BitmapProperties bitmapProperties = FreeTypeRenderer::GetBitmapGlyphProperties(bitmapGlyph->bitmap);
+
+
+                auto width = bitmapProperties.width;
+                auto height = bitmapProperties.height;
+                auto left = bitmapGlyph->left;
+                auto top = bitmapGlyph->top;
+
+                currentLine->maxGlyphHeight = std::max<int32_t>(currentLine->maxGlyphHeight, static_cast<int32_t>(height) - top);
+                mesureResult.minX = std::min<int32_t>(mesureResult.minX, left + penX);
+                mesureResult.maxX = std::max<int32_t>(mesureResult.maxX, left + static_cast<int32_t>(width) + penX);
+                FT_Done_Glyph(glyph);
+            });
+
+            // Lines without glyphs, e.g. after a trailing line break.
+            mesureResult.lineMetrics.resize(lineCount);
 
             mesureResult.rect = { {mesureResult.minX , 0}, {mesureResult.maxX , static_cast<int32_t>(mesureResult.lineMetrics.size() * rowHeight) } };
 
@@ -240,24 +463,40 @@ namespace FreeType
         }
     }
 
+    uint32_t FreeTypeConnector::GetRowHeight(FT_Face face, uint32_t outlineWidth)
+    {
+        return static_cast<uint32_t>(face->size->metrics.height >> 6) + outlineWidth * 2;
+    }
+
     FreeTypeFont* FreeTypeConnector::GetOrCreateFont(const std::wstring& fontPath)
     {
         FreeTypeFont* font = nullptr;
 
-        auto it = fFontNameToFont.find(fontPath);
+        auto it = fFontNameToFont.find(std::wstring_view(fontPath));
         if (it != fFontNameToFont.end())
         {
             font = it->second.get();
         }
         else
         {
-            auto itFontName = fFontNameToFont.emplace(fontPath, std::make_unique<FreeTypeFont>(fLibrary, fontPath));
+            auto itFontName = fFontNameToFont.emplace(std::wstring_view(fontPath), std::make_unique<FreeTypeFont>(fLibrary, fontPath));
             font = itFontName.first->second.get();
         }
 
         return font;
     }
 
+    void FreeTypeConnector::ReleaseFont(const std::wstring& fontPath)
+    {
+        auto it = fFontNameToFont.find(std::wstring_view(fontPath));
+        if (it == fFontNameToFont.end())
+            return;
+
+        if (fSdfGlyphCache != nullptr)
+            fSdfGlyphCache->ReleaseFace(it->second->GetFace());
+        fFontNameToFont.erase(it);
+    }
+
 
     FT_Stroker FreeTypeConnector::GetStroker()
     {
@@ -268,23 +507,414 @@ namespace FreeType
         return fStroker;
     }
 
-    template <typename source_type, typename dest_type>
-    void FreeTypeConnector::ResolvePremultipoliedBUffer(LLUtils::Buffer& dest, const LLUtils::Buffer& source, uint32_t width, uint32_t height)
-	{
-        std::span destPtr(reinterpret_cast<dest_type*>(dest.data()), width * height);
-        const std::span sourcePtr(reinterpret_cast<const source_type*>(source.data()), width * height);
+    void FreeTypeConnector::CreateMsdfAtlas(const MsdfAtlasParams& params, MsdfAtlas& out_atlas)
+    {
+        FreeTypeFont* font = GetOrCreateFont(params.fontPath);
+        FT_Face face = font->GetFace();
+        if (params.emSize == 0 || params.pixelRange == 0 || face->units_per_EM == 0)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "Atlas em size and pixel range must be positive, font must be scalable");
+
+        // Outlines are loaded unscaled and unhinted, the atlas doesn't depend on the size the font was last used at.
+        const double scale = static_cast<double>(params.emSize) / face->units_per_EM;
+        const double range = params.pixelRange;
+
+        std::u32string codepoints = ww898::utf::conv<char32_t>(params.characters);
+        std::sort(codepoints.begin(), codepoints.end());
+        codepoints.erase(std::unique(codepoints.begin(), codepoints.end()), codepoints.end());
+
+        out_atlas.emSize = params.emSize;
+        out_atlas.pixelRange = params.pixelRange;
+        out_atlas.glyphs.clear();
+        std::pmr::vector<MsdfGenerator::Shape> shapes(fMemoryResource);
+
+        for (const char32_t codepoint : codepoints)
+        {
+            const FT_UInt glyphIndex = FT_Get_Char_Index(face, codepoint);
+            if (glyphIndex == 0)
+                continue;
+
+            if (FT_Error error = FT_Load_Glyph(face, glyphIndex, FT_LOAD_NO_SCALE | FT_LOAD_NO_HINTING | FT_LOAD_NO_BITMAP); error != FT_Err_Ok)
+                LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, GenerateFreeTypeErrorString("can not Load glyph", error));
+
+            MsdfGlyph glyph{ codepoint, glyphIndex };
+            glyph.advance = static_cast<float>(face->glyph->advance.x * scale);
+
+            MsdfGenerator::Shape shape = face->glyph->format == FT_GLYPH_FORMAT_OUTLINE
+                ? MsdfGenerator::LoadShape(face->glyph->outline, scale, fMemoryResource) : MsdfGenerator::Shape(fMemoryResource);
+
+            if (shape.empty() == false)
+            {
+                MsdfGenerator::ColorEdges(shape);
+
+                // The glyph's box grown by half the range, past that every pixel is at the far end of the range.
+                FT_BBox box;
+                FT_Outline_Get_CBox(&face->glyph->outline, &box);
+                const double left = std::floor(static_cast<double>(box.xMin) * scale - range / 2);
+                const double right = std::ceil(static_cast<double>(box.xMax) * scale + range / 2);
+                const double top = std::ceil(static_cast<double>(box.yMax) * scale + range / 2);
+                const double bottom = std::floor(static_cast<double>(box.yMin) * scale - range / 2);
+                glyph.left = static_cast<float>(left);
+                glyph.top = static_cast<float>(top);
+                glyph.width = static_cast<uint32_t>(right - left);
+                glyph.height = static_cast<uint32_t>(top - bottom);
+            }
+
+            out_atlas.glyphs.push_back(glyph);
+            shapes.push_back(std::move(shape));
+        }
+
+        uint32_t atlasHeight = 0;
+        const uint32_t atlasWidth = PackAtlas(out_atlas.glyphs, atlasHeight, fMemoryResource);
+        std::byte* atlasBuffer = PrepareBitmap(out_atlas.bitmap, atlasWidth, atlasHeight, BitmapFormat::RGBA);
+        const size_t rowPitch = out_atlas.bitmap.rowPitch;
+        std::fill_n(atlasBuffer, rowPitch * atlasHeight, std::byte{ 0 });
+
+        const uint32_t threadCount = static_cast<uint32_t>(std::min<size_t>(
+            params.maxThreads != 0 ? params.maxThreads : std::max(std::thread::hardware_concurrency(), 1u), out_atlas.glyphs.size()));
+
+        // Every glyph writes its own rectangle only, and generating doesn't allocate, scratch space is made up front.
+        size_t maxContours = 0;
+        for (const MsdfGenerator::Shape& shape : shapes)
+            maxContours = std::max(maxContours, shape.size());
+        std::pmr::vector<MsdfGenerator::ContourDistance> scratch(maxContours * std::max(threadCount, 1u), fMemoryResource);
+
+        // An exception stops the remaining glyphs and is rethrown once every thread is done.
+        std::atomic<size_t> nextGlyph{ 0 };
+        std::pmr::vector<std::exception_ptr> threadErrors(std::max(threadCount, 1u), fMemoryResource);
+        const auto generate = [&](uint32_t thread)
+        {
+            try
+            {
+                const std::span<MsdfGenerator::ContourDistance> threadScratch(scratch.data() + thread * maxContours, maxContours);
+                for (size_t index = nextGlyph++; index < out_atlas.glyphs.size(); index = nextGlyph++)
+                {
+                    const MsdfGlyph& glyph = out_atlas.glyphs[index];
+                    if (glyph.width == 0)
+                        continue;
+                    LLUTILS_DISABLE_WARNING_PUSH
+                    LLUTILS_DISABLE_WARNING_UNSAFE_BUFFER_USAGE
+                    uint8_t* dest = reinterpret_cast<uint8_t*>(atlasBuffer) + glyph.atlasY * rowPitch + glyph.atlasX * 4;
+                    LLUTILS_DISABLE_WARNING_POP
+                    MsdfGenerator::GenerateField(shapes[index], glyph.left, glyph.top, glyph.width, glyph.height, range, dest, rowPitch, threadScratch);
+                }
+            }
+            catch (...)
+            {
+                threadErrors[thread] = std::current_exception();
+                nextGlyph = out_atlas.glyphs.size();
+            }
+        };
+
+        {
+            std::vector<std::jthread> workers;
+            for (uint32_t i = 1; i < threadCount; i++)
+                workers.emplace_back(generate, i);
+            generate(0);
+        }
+
+        for (const std::exception_ptr& error : threadErrors)
+        {
+            if (error != nullptr)
+                std::rethrow_exception(error);
+        }
+    }
+
+    void FreeTypeConnector::CreateCoverageAtlas(const CoverageAtlasParams& params, CoverageAtlas& out_atlas)
+    {
+        FreeTypeFont* font = GetOrCreateFont(params.fontPath);
+        font->SetSize(params.fontSize, params.DPIx, params.DPIy);
+        FT_Face face = font->GetFace();
+
+        const FT_Render_Mode renderMode = params.renderMode == RenderMode::Aliased ? FT_RENDER_MODE_MONO : FT_RENDER_MODE_NORMAL;
+
+        std::u32string codepoints = ww898::utf::conv<char32_t>(params.characters);
+        std::sort(codepoints.begin(), codepoints.end());
+        codepoints.erase(std::unique(codepoints.begin(), codepoints.end()), codepoints.end());
+
+        // The same line box RenderText lays text out in, without an outline.
+        out_atlas.lineHeight = GetRowHeight(face, 0);
+        out_atlas.baseline = static_cast<int32_t>(out_atlas.lineHeight) + static_cast<int32_t>(face->size->metrics.descender >> 6);
+        out_atlas.glyphs.clear();
+
+        // Coverage of every glyph, tightly packed, until the atlas size is known.
+        std::pmr::vector<uint8_t> coverage(fMemoryResource);
+        std::pmr::vector<size_t> coverageOffsets(fMemoryResource);
+
+        for (const char32_t codepoint : codepoints)
+        {
+            const FT_UInt glyphIndex = FT_Get_Char_Index(face, codepoint);
+            if (glyphIndex == 0)
+                continue;
+
+            FT_Error error = FT_Load_Glyph(face, glyphIndex, FT_LOAD_DEFAULT);
+            if (error == FT_Err_Ok)
+                error = FT_Render_Glyph(face->glyph, renderMode);
+            if (error != FT_Err_Ok)
+                LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, GenerateFreeTypeErrorString("can not render glyph", error));
+
+            const FT_Bitmap& bitmap = face->glyph->bitmap;
+            CoverageGlyph glyph{ codepoint, glyphIndex };
+            glyph.width = bitmap.width;
+            glyph.height = bitmap.rows;
+            glyph.left = face->glyph->bitmap_left;
+            glyph.top = face->glyph->bitmap_top;
+            glyph.advance = static_cast<int32_t>(face->glyph->advance.x >> 6);
+
+            coverageOffsets.push_back(coverage.size());
+            coverage.resize(coverage.size() + static_cast<size_t>(bitmap.width) * bitmap.rows);
+            LLUTILS_DISABLE_WARNING_PUSH
+            LLUTILS_DISABLE_WARNING_UNSAFE_BUFFER_USAGE
+            uint8_t* dest = coverage.data() + coverageOffsets.back();
+            for (uint32_t y = 0; y < bitmap.rows; y++)
+            {
+                const uint8_t* source = bitmap.buffer + static_cast<ptrdiff_t>(y) * bitmap.pitch;
+                for (uint32_t x = 0; x < bitmap.width; x++)
+                    *dest++ = renderMode == FT_RENDER_MODE_MONO ? ((source[x / 8] & (0x80 >> (x % 8))) != 0 ? uint8_t{ 255 } : uint8_t{ 0 }) : source[x];
+            }
+            LLUTILS_DISABLE_WARNING_POP
+
+            out_atlas.glyphs.push_back(glyph);
+        }
+
+        uint32_t atlasHeight = 0;
+        const uint32_t atlasWidth = PackAtlas(out_atlas.glyphs, atlasHeight, fMemoryResource);
+        std::byte* atlasBuffer = PrepareBitmap(out_atlas.bitmap, atlasWidth, atlasHeight, BitmapFormat::A8);
+        const size_t rowPitch = out_atlas.bitmap.rowPitch;
+        std::fill_n(atlasBuffer, rowPitch * atlasHeight, std::byte{ 0 });
+
+        LLUTILS_DISABLE_WARNING_PUSH
+        LLUTILS_DISABLE_WARNING_UNSAFE_BUFFER_USAGE
+        for (size_t index = 0; index < out_atlas.glyphs.size(); index++)
+        {
+            const CoverageGlyph& glyph = out_atlas.glyphs[index];
+            for (uint32_t y = 0; y < glyph.height; y++)
+                std::memcpy(atlasBuffer + (glyph.atlasY + y) * rowPitch + glyph.atlasX, coverage.data() + coverageOffsets[index] + static_cast<size_t>(y) * glyph.width, glyph.width);
+        }
+        LLUTILS_DISABLE_WARNING_POP
+    }
+
+    bool FreeTypeConnector::LayoutQuads(const TextCreateParams& textCreateParams, GlyphQuadCache& cache, std::pmr::vector<GlyphQuad>& out_quads)
+    {
+        using namespace LLUtils;
+        out_quads.clear();
+        if (textCreateParams.text.empty())
+            return true;
 
-        for (auto y = 0u ; y < height;y++)
-            for (auto x = 0u; x < width; x++)
-                destPtr[y * width + x] = static_cast<dest_type>(sourcePtr[y * width + x].DivideAlpha());
-	}
+        const uint32_t OutlineWidth = textCreateParams.outlineWidth;
+        const bool renderOutline = OutlineWidth > 0;
+        const bool rgbaPage = cache.GetFormat() == BitmapFormat::RGBA;
 
+        // The same render modes RenderText uses, LCD coverage only survives in RGBA pages.
+        FT_Render_Mode textRenderMode = FreeTypeRenderer::GetRenderMode(textCreateParams.renderMode);
+        if (textRenderMode == FT_Render_Mode::FT_RENDER_MODE_LCD && (renderOutline || rgbaPage == false))
+            textRenderMode = FT_Render_Mode::FT_RENDER_MODE_NORMAL;
+        const FT_Render_Mode outlineRenderMode = textRenderMode == FT_Render_Mode::FT_RENDER_MODE_MONO ? FT_Render_Mode::FT_RENDER_MODE_MONO : FT_Render_Mode::FT_RENDER_MODE_NORMAL;
+
+        const BitFlags<TextCreateFlags> createFlags{ textCreateParams.flags };
+        const bool useMetaText = createFlags.test(TextCreateFlags::UseMetaText);
+        const bool usebidiText = createFlags.test(TextCreateFlags::Bidirectional);
+
+        std::vector<FormattedTextEntry> formattedText;
+        if (useMetaText)
+            formattedText = MetaText::GetFormattedText(textCreateParams.text);
+        else
+            formattedText.push_back({ textCreateParams.textColor, textCreateParams.text });
+
+        FreeTypeFont* font = GetOrCreateFont(textCreateParams.fontPath);
+        font->SetSize(textCreateParams.fontSize, textCreateParams.DPIx, textCreateParams.DPIy);
+        FT_Face face = font->GetFace();
+        const int32_t descender = static_cast<int32_t>(face->size->metrics.descender >> 6);
+        const int32_t rowHeight = static_cast<int32_t>(GetRowHeight(face, OutlineWidth));
+
+        GlyphQuadCache::GlyphKey key{ font, 0, textCreateParams.fontSize, textCreateParams.DPIx, textCreateParams.DPIy, static_cast<uint8_t>(textRenderMode), 0 };
+
+        // Outline quads go first, text quads are collected separately and appended.
+        std::pmr::vector<GlyphQuad> textQuads(fMemoryResource);
+        bool complete = true;
+
+        LayOutText(face, formattedText, usebidiText, textCreateParams.maxWidthPx, [&](const GlyphPlacement& placement)
+        {
+            const FormattedTextEntry& el = formattedText[placement.entryIndex];
+            const Color textColor = el.textColor != Color{ 0, 0, 0, 0 } ? el.textColor : textCreateParams.textColor;
+            const int32_t penX = placement.penX;
+            const int32_t penY = static_cast<int32_t>(placement.line) * rowHeight;
+            const int32_t baseline = rowHeight + penY + descender - static_cast<int32_t>(OutlineWidth);
+            key.glyphIndex = placement.glyphIndex;
+
+            if (renderOutline)
+            {
+                key.outlineWidth = OutlineWidth;
+                GlyphQuad quad;
+                bool cached = cache.FindQuad(key, penX, baseline, textCreateParams.outlineColor, quad);
+                if (cached == false)
+                {
+                    FT_BitmapGlyph bitmapGlyph = FreeTypeRenderer::GetStrokerGlyph(GetStroker(), face->glyph, OutlineWidth, outlineRenderMode);
+                    cached = cache.InsertQuad(key, bitmapGlyph->bitmap, bitmapGlyph->left, bitmapGlyph->top, penX, baseline, textCreateParams.outlineColor, quad);
+                    FT_Done_Glyph(reinterpret_cast<FT_Glyph>(bitmapGlyph));
+                }
+
+                complete &= cached;
+                if (cached && quad.width > 0)
+                    out_quads.push_back(quad);
+                key.outlineWidth = 0;
+            }
+
+            GlyphQuad quad;
+            bool cached = cache.FindQuad(key, penX, baseline, textColor, quad);
+            if (cached == false)
+            {
+                FT_Glyph glyph;
+                if (FT_Error error = FT_Get_Glyph(face->glyph, &glyph); error != FT_Err_Ok)
+                    LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, "FreeType error, unable to render glyph");
+
+                if (glyph->format != FT_GLYPH_FORMAT_BITMAP)
+                {
+                    if (FT_Error error = FT_Glyph_To_Bitmap(&glyph, textRenderMode, nullptr, true); error != FT_Err_Ok)
+                    {
+                        FT_Done_Glyph(glyph);
+                        LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, "FreeType error, unable to render glyph");
+                    }
+                }
+
+                FT_BitmapGlyph bitmapGlyph = reinterpret_cast<FT_BitmapGlyph>(glyph);
+                cached = cache.InsertQuad(key, bitmapGlyph->bitmap, bitmapGlyph->left, bitmapGlyph->top, penX, baseline, textColor, quad);
+                FT_Done_Glyph(glyph);
+            }
+
+            complete &= cached;
+            if (cached && quad.width > 0)
+                textQuads.push_back(quad);
+        });
+
+        out_quads.insert(out_quads.end(), textQuads.begin(), textQuads.end());
+        return complete;
+    }
+
+    SdfGlyphCache& FreeTypeConnector::GetSdfGlyphCache()
+    {
+        if (fSdfGlyphCache == nullptr)
+            fSdfGlyphCache = std::make_unique<SdfGlyphCache>(fLibrary, fMemoryResource);
+        return *fSdfGlyphCache;
+    }
+
+    void FreeTypeConnector::SetBufferPool(BufferPool* bufferPool)
+    {
+        fBufferPool = bufferPool;
+    }
+
+    void FreeTypeConnector::ReleaseBitmap(Bitmap& bitmap)
+    {
+        ReleaseBuffer(std::move(bitmap.buffer));
+        bitmap = {};
+    }
+
+    std::pmr::memory_resource* FreeTypeConnector::GetMemoryResource() const
+    {
+        return fMemoryResource;
+    }
+
+    FreeTypeMemoryStats FreeTypeConnector::GetFreeTypeMemoryStats() const
+    {
+        return fFreeTypeMemory->GetStats();
+    }
+
+    ByteBuffer FreeTypeConnector::AcquireBuffer(size_t size)
+    {
+        return fBufferPool != nullptr ? fBufferPool->Acquire(size) : ByteBuffer(size, fMemoryResource);
+    }
+
+    void FreeTypeConnector::ReleaseBuffer(ByteBuffer buffer)
+    {
+        if (fBufferPool != nullptr)
+            fBufferPool->Release(std::move(buffer));
+    }
+
+    void FreeTypeConnector::ReleaseCoverage(TextCoverage& coverage)
+    {
+        ReleaseBuffer(std::move(coverage.buffer));
+        coverage = {};
+    }
+
+    std::byte* FreeTypeConnector::PrepareBitmap(Bitmap& bitmap, uint32_t width, uint32_t height, BitmapFormat format)
+    {
+        using namespace LLUtils;
+        uint32_t pixelSize = static_cast<uint32_t>(sizeof(Color));
+        if (format == BitmapFormat::A8 || format == BitmapFormat::A8x2)
+            pixelSize = format == BitmapFormat::A8 ? 1 : 2;
+        else if (format == BitmapFormat::A1)
+            pixelSize = 0;
+
+        const uint32_t rowPitch = format == BitmapFormat::A1 ? BitCanvas::GetPackedRowPitch(width) : pixelSize * width;
+        const size_t sizeOfResolvedBuffer = static_cast<size_t>(rowPitch) * height;
+
+        // Reuse the caller's buffer when it is big enough, otherwise exchange it for a bigger one.
+        if (bitmap.buffer.size() < sizeOfResolvedBuffer)
+        {
+            ReleaseBuffer(std::move(bitmap.buffer));
+            bitmap.buffer = AcquireBuffer(sizeOfResolvedBuffer);
+        }
+
+        bitmap.width = width;
+        bitmap.height = height;
+        bitmap.PixelSize = pixelSize;
+        bitmap.rowPitch = rowPitch;
+        bitmap.format = format;
+        return bitmap.buffer.data();
+    }
 
     void FreeTypeConnector::CreateBitmap(const TextCreateParams& textCreateParams
         , Bitmap& out_bitmap
         , TextMetrics* in_metrics//optional
         , GlyphMappings* out_glyphMapping /*= nullptr*/
             )
+    {
+        if (LLUtils::BitFlags<TextCreateFlags>{ textCreateParams.flags }.test(TextCreateFlags::BandedRendering))
+        {
+            RenderTextBanded(textCreateParams, &out_bitmap, nullptr, in_metrics, out_glyphMapping);
+            return;
+        }
+
+        RenderText(textCreateParams, &out_bitmap, nullptr, in_metrics, out_glyphMapping);
+    }
+
+    void FreeTypeConnector::CreateCoverage(const TextCreateParams& textCreateParams, TextCoverage& out_coverage, TextMetrics* metrics, GlyphMappings* out_glyphMapping)
+    {
+        RenderText(textCreateParams, nullptr, &out_coverage, metrics, out_glyphMapping);
+    }
+
+    void FreeTypeConnector::RenderBands(const TextCreateParams& textCreateParams, const BandCallback& onBand, TextMetrics* metrics, GlyphMappings* out_glyphMapping)
+    {
+        RenderTextBanded(textCreateParams, nullptr, &onBand, metrics, out_glyphMapping);
+    }
+
+    void FreeTypeConnector::Colorize(const TextCoverage& coverage, const CoverageColors& colors, Bitmap& out_bitmap)
+    {
+        using namespace LLUtils;
+        const bool linearBlending = coverage.linearBlending;
+        const ColorF32 backgroundColorPremultiplied = (linearBlending ? GammaTables::ToLinear(colors.backgroundColor) : static_cast<ColorF32>(colors.backgroundColor)).MultiplyAlpha();
+
+        FreeTypeRenderer::CoverageColorTable outlineColorTable;
+        FreeTypeRenderer::BuildCoverageColorTable(colors.outlineColor, outlineColorTable, linearBlending);
+
+        std::pmr::vector<FreeTypeRenderer::CoverageColorTable> textColorTables(coverage.runColors.size(), fMemoryResource);
+        for (size_t i = 0; i < coverage.runColors.size(); i++)
+        {
+            const Color runColor = coverage.runColors[i];
+            FreeTypeRenderer::BuildCoverageColorTable(runColor != Color{ 0, 0, 0, 0 } ? runColor : colors.textColor, textColorTables[i], linearBlending);
+        }
+
+        // Resolving only reads the planes.
+        const CoverageCanvas coverageCanvas(const_cast<std::byte*>(coverage.buffer.data()), coverage.width, coverage.height);
+        Color* resolvedPixels = reinterpret_cast<Color*>(PrepareBitmap(out_bitmap, coverage.width, coverage.height, BitmapFormat::RGBA));
+        ResolveCoverage(coverageCanvas, resolvedPixels, backgroundColorPremultiplied, outlineColorTable, textColorTables, linearBlending);
+    }
+
+    void FreeTypeConnector::RenderText(const TextCreateParams& textCreateParams
+        , Bitmap* out_bitmap
+        , TextCoverage* out_coverage
+        , TextMetrics* in_metrics//optional
+        , GlyphMappings* out_glyphMapping
+            )
     {
         using namespace std;
         const std::wstring text = textCreateParams.text;
@@ -298,12 +928,54 @@ namespace FreeType
         FT_Render_Mode outlineRenderMode = FreeTypeRenderer::GetRenderMode(textCreateParams.renderMode);
         const bool renderOutline = OutlineWidth > 0;
 
-        if (textRenderMOde == FT_Render_Mode::FT_RENDER_MODE_LCD && renderOutline == true)
+        // Coverage is kept for recoloring instead of being resolved to out_bitmap.
+        const bool coverageOnly = out_coverage != nullptr;
+        // Coverage masks are accumulated straight into out_bitmap, no colors are involved.
+        const BitmapFormat format = coverageOnly ? BitmapFormat::RGBA : textCreateParams.bitmapFormat;
+        const bool coverageMask = format == BitmapFormat::A8 || format == BitmapFormat::A8x2;
+
+        if (textRenderMOde == FT_Render_Mode::FT_RENDER_MODE_LCD && (renderOutline == true || coverageOnly || coverageMask))
             textRenderMOde = FT_Render_Mode::FT_RENDER_MODE_NORMAL;
 
+        // 1 bit output is drawn straight into a packed bit canvas from aliased glyphs.
+        const bool packedBits = format == BitmapFormat::A1;
+        const bool colorOutput = format == BitmapFormat::RGBA && coverageOnly == false;
+        if (packedBits)
+        {
+            textRenderMOde = FT_Render_Mode::FT_RENDER_MODE_MONO;
+            outlineRenderMode = FT_Render_Mode::FT_RENDER_MODE_MONO;
+        }
+
         const LLUtils::BitFlags<TextCreateFlags> createFlags{ textCreateParams.flags };
         const bool useMetaText = createFlags.test(TextCreateFlags::UseMetaText);
         const bool usebidiText = createFlags.test(TextCreateFlags::Bidirectional);
+        const bool linearBlending = createFlags.test(TextCreateFlags::LinearBlending);
+
+        vector<FormattedTextEntry> formattedText;
+
+        if (useMetaText)
+            formattedText = MetaText::GetFormattedText(text);
+        else
+            formattedText.push_back({ textCreateParams.textColor, textCreateParams.text });
+
+        // The fused compositor keeps a single gray coverage value per layer and an 8 bit fill palette index.
+        // LCD outlines are demoted to gray coverage, LCD text without an outline keeps using the color canvases.
+        // Distance fields are resampled to coverage, which the fused compositor takes directly.
+        const bool distanceFields = packedBits == false && textCreateParams.renderMode == RenderMode::SignedDistanceField;
+
+        const bool fusedCompositing = coverageOnly || coverageMask || distanceFields || (createFlags.test(TextCreateFlags::FusedCompositing) && packedBits == false
+            && textRenderMOde != FT_Render_Mode::FT_RENDER_MODE_LCD && formattedText.size() <= 256);
+
+        if (coverageOnly && formattedText.size() > 256)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::LogicError, "Text coverage supports up to 256 meta text color runs");
+
+        if (fusedCompositing && outlineRenderMode == FT_Render_Mode::FT_RENDER_MODE_LCD)
+            outlineRenderMode = FT_Render_Mode::FT_RENDER_MODE_NORMAL;
+
+        // Spans carry gray coverage only, LCD and mono glyphs keep going through glyph bitmaps.
+        const bool directSpans = createFlags.test(TextCreateFlags::DirectSpanRendering);
+        const bool directTextSpans = directSpans && textRenderMOde == FT_Render_Mode::FT_RENDER_MODE_NORMAL;
+        const bool directOutlineSpans = directSpans && outlineRenderMode == FT_Render_Mode::FT_RENDER_MODE_NORMAL;
 
 
         FreeTypeFont* font = GetOrCreateFont(fontPath);
@@ -313,7 +985,7 @@ namespace FreeType
         TextMesureParams params;
         params.createParams = textCreateParams;
         
-        TextMetrics metrics;
+        TextMetrics metrics(fMemoryResource);
         if (in_metrics == nullptr)
             MeasureText(params, metrics);
         else
@@ -323,124 +995,185 @@ namespace FreeType
         auto& mesaureResult = metrics;
 
         using namespace LLUtils;
-        const uint32_t destPixelSize = sizeof(ColorF32);
-        const uint32_t destRowPitch = static_cast<uint32_t>(mesaureResult.rect.GetWidth()) * destPixelSize;
-        const uint32_t sizeOfDestBuffer = static_cast<uint32_t>(mesaureResult.rect.GetHeight()) * destRowPitch;
-        const size_t totalTexels = static_cast<size_t>(mesaureResult.rect.GetWidth() * mesaureResult.rect.GetHeight());
-        LLUtils::Buffer textBuffer(sizeOfDestBuffer);
-
-        //// when rendering with outline, the outline buffer is the final buffer, otherwise the text buffer is the final buffer.
-        //Reset final text buffer to background color.
-
-        ColorF32 textBackgroundBuffer = renderOutline ? ColorF32(0.0f,0.0f,0.0f,0.0f) : static_cast<ColorF32>(backgroundColor).MultiplyAlpha();
-
-        std::span textBufferColor(reinterpret_cast<ColorF32*>(textBuffer.data()), totalTexels);
-        
-
-        for (size_t i = 0; i < totalTexels; i++)
-            textBufferColor[i] = textBackgroundBuffer;
-
-        LLUtils::Buffer outlineBuffer;
-        BlitBox  destOutline = {};
-        if (renderOutline)
+        const size_t destPixelSize = sizeof(ColorF32);
+        const size_t destRowPitch = static_cast<size_t>(mesaureResult.rect.GetWidth()) * destPixelSize;
+        const size_t sizeOfDestBuffer = static_cast<size_t>(mesaureResult.rect.GetHeight()) * destRowPitch;
+        const size_t totalTexels = static_cast<size_t>(mesaureResult.rect.GetWidth()) * static_cast<size_t>(mesaureResult.rect.GetHeight());
+        const uint32_t canvasWidth = static_cast<uint32_t>(mesaureResult.rect.GetWidth());
+        const uint32_t canvasHeight = static_cast<uint32_t>(mesaureResult.rect.GetHeight());
+        ByteBuffer textBuffer(fMemoryResource);
+        ByteBuffer outlineBuffer(fMemoryResource);
+        ByteBuffer coverageBuffer(fMemoryResource);
+        ByteBuffer bitBuffer(fMemoryResource);
+        std::byte* coveragePixels = nullptr;
+
+        if (coverageOnly)
         {
-            outlineBuffer.Allocate(sizeOfDestBuffer);
-            std::span outlineBufferColor(reinterpret_cast<ColorF32*>(outlineBuffer.data()), totalTexels);
+            // Reuse the caller's buffer when it is big enough, the same as for output bitmaps.
+            if (out_coverage->buffer.size() < totalTexels * CoverageCanvas::BytesPerPixel)
+            {
+                ReleaseBuffer(std::move(out_coverage->buffer));
+                out_coverage->buffer = AcquireBuffer(totalTexels * CoverageCanvas::BytesPerPixel);
+            }
+            coverageBuffer = std::move(out_coverage->buffer);
+            coveragePixels = coverageBuffer.data();
+        }
+        else if (coverageMask)
+        {
+            coveragePixels = PrepareBitmap(*out_bitmap, canvasWidth, canvasHeight, format);
+        }
+        else if (fusedCompositing)
+        {
+            coverageBuffer = AcquireBuffer(totalTexels * CoverageCanvas::BytesPerPixel);
+            coveragePixels = coverageBuffer.data();
+        }
+        else if (packedBits)
+        {
+            bitBuffer = AcquireBuffer(BitCanvas::GetBufferSize(canvasWidth, canvasHeight));
+        }
+        else
+        {
+            textBuffer = AcquireBuffer(sizeOfDestBuffer);
+            if (renderOutline)
+                outlineBuffer = AcquireBuffer(sizeOfDestBuffer);
+        }
 
-            //Reset outline buffer to background color.
-            for (size_t i = 0; i < totalTexels; i++)
-                outlineBufferColor[i] = static_cast<ColorF32>(backgroundColor).MultiplyAlpha();
+        const CoverageCanvas::Layout coverageLayout = coverageMask == false ? CoverageCanvas::Layout::Planes
+            : format == BitmapFormat::A8 ? CoverageCanvas::Layout::Alpha : CoverageCanvas::Layout::AlphaChannels;
+        CoverageCanvas coverageCanvas(coveragePixels, canvasWidth, canvasHeight, coverageLayout);
+        if (fusedCompositing)
+            coverageCanvas.Clear();
 
-            destOutline.buffer = outlineBuffer.data();
-            destOutline.width = static_cast<uint32_t>(mesaureResult.rect.GetWidth());
-            destOutline.height = static_cast<uint32_t>(mesaureResult.rect.GetHeight());
-            destOutline.pixelSizeInbytes = destPixelSize;
-            destOutline.rowPitch = destRowPitch;
-        }
+        BitCanvas bitCanvas(bitBuffer.data(), canvasWidth, canvasHeight);
+        if (packedBits)
+            bitCanvas.Clear();
 
+        // when rendering with outline, the outline buffer is the final buffer, otherwise the text buffer is the final buffer.
+        // Canvases are filled with their background lazily, one tile at a time, as glyphs are drawn into them.
 
-        BlitBox  dest {};
-        dest.buffer = textBuffer.data();
-        dest.width = static_cast<uint32_t>(mesaureResult.rect.GetWidth());
-        dest.height = static_cast<uint32_t>(mesaureResult.rect.GetHeight());
-        dest.pixelSizeInbytes = destPixelSize;
-        dest.rowPitch = destRowPitch;
+        const ColorF32 backgroundColorPremultiplied = (linearBlending ? GammaTables::ToLinear(backgroundColor) : static_cast<ColorF32>(backgroundColor)).MultiplyAlpha();
+        ColorF32 textBackgroundBuffer = renderOutline ? ColorF32(0.0f,0.0f,0.0f,0.0f) : backgroundColorPremultiplied;
 
-        
-        int32_t penX = -mesaureResult.rect.LeftTop().x;
-        int32_t penY = -mesaureResult.rect.LeftTop().y;
+        SparseCanvas textCanvas(textBuffer.data(), canvasWidth, canvasHeight, textBackgroundBuffer, fMemoryResource);
+        SparseCanvas outlineCanvas(outlineBuffer.data(), canvasWidth, canvasHeight, backgroundColorPremultiplied, fMemoryResource);
+
+        BlitBox destOutline = outlineCanvas.GetBlitBox();
+        BlitBox dest = textCanvas.GetBlitBox();
 
-        
         FT_Face face = font->GetFace();
         const auto descender = face->size->metrics.descender >> 6;
         const uint32_t rowHeight = mesaureResult.rowHeight;
 
-        vector<FormattedTextEntry> formattedText;
+        // Display pixels per pixel of the distance field size bucket.
+        const float pixelSizeX = static_cast<float>(fontSize) * static_cast<float>(textCreateParams.DPIx) / 72.0f;
+        const float pixelSizeY = static_cast<float>(fontSize) * static_cast<float>(textCreateParams.DPIy) / 72.0f;
+        const uint32_t distanceFieldBucket = distanceFields ? SdfGlyphCache::GetBucketSize(pixelSizeY) : 0;
+        const float distanceFieldScaleX = distanceFields ? pixelSizeX / static_cast<float>(distanceFieldBucket) : 0.0f;
+        const float distanceFieldScaleY = distanceFields ? pixelSizeY / static_cast<float>(distanceFieldBucket) : 0.0f;
 
-        if (useMetaText)
-            formattedText = MetaText::GetFormattedText(text);
-        else
-            formattedText.push_back({ textCreateParams.textColor, textCreateParams.text });
+        // Colors are only needed when resolving to RGBA.
+        FreeTypeRenderer::CoverageColorTable outlineColorTable;
+        if (renderOutline && colorOutput)
+            FreeTypeRenderer::BuildCoverageColorTable(outlineColor, outlineColorTable, linearBlending);
 
+        // One color table per formatted text entry, the fused compositor refers to them by index when resolving.
+        std::pmr::vector<FreeTypeRenderer::CoverageColorTable> textColorTables(colorOutput ? formattedText.size() : 0, fMemoryResource);
 
+        if (colorOutput)
+        {
+            for (size_t entryIndex = 0; entryIndex < formattedText.size(); entryIndex++)
+            {
+                const FormattedTextEntry& el = formattedText[entryIndex];
+                const auto textcolor = el.textColor != Color{ 0, 0, 0, 0 } ? el.textColor : params.createParams.textColor;
+                FreeTypeRenderer::BuildCoverageColorTable(textcolor, textColorTables[entryIndex], linearBlending);
+            }
+        }
 
-        for (const FormattedTextEntry& el : formattedText)
+        LayOutText(face, formattedText, usebidiText, textCreateParams.maxWidthPx, [&](const GlyphPlacement& placement)
         {
-            const std::u32string visualText = usebidiText ? bidi_string(el.text.c_str()) : ww898::utf::conv<char32_t>(el.text);
+            const FormattedTextEntry& el = formattedText[placement.entryIndex];
+            const auto textcolor = el.textColor != Color{ 0, 0, 0, 0 } ? el.textColor : params.createParams.textColor;
+            FreeTypeRenderer::CoverageColorTable* textColorTable = colorOutput ? &textColorTables[placement.entryIndex] : nullptr;
+            const uint8_t textColorIndex = static_cast<uint8_t>(placement.entryIndex);
+            const FT_UInt glyph_index = placement.glyphIndex;
+            const int32_t advance = placement.advance;
+            const int32_t penX = placement.penX - mesaureResult.rect.LeftTop().x;
+            const int32_t penY = static_cast<int32_t>(placement.line * rowHeight) - mesaureResult.rect.LeftTop().y;
+
+            const auto baseVerticalPos = static_cast<int32_t>(rowHeight) + penY + descender - static_cast<int32_t>(OutlineWidth);
+
+            // FreeType oversamples outlines flagged as overlapping when rendering them to a bitmap, spans don't, keep those on the bitmap path.
+            const bool isOutlineGlyph = face->glyph->format == FT_GLYPH_FORMAT_OUTLINE && (face->glyph->outline.flags & FT_OUTLINE_OVERLAP) == 0;
+
+            // Looking up a field may render it at the bucket size, which replaces the loaded glyph.
+            const SdfGlyphCache::Glyph* distanceField = distanceFields ? &GetSdfGlyphCache().GetGlyph(face, glyph_index, distanceFieldBucket) : nullptr;
 
-            for (const decltype(visualText)::value_type& codepoint : visualText)
+            if (renderOutline) // render outline
             {
-                if (codepoint == L'\n')
+                if (distanceFields)
                 {
-                    penX = static_cast<int>(-mesaureResult.rect.LeftTop().x);
-                    penY += rowHeight;
-                    continue;
+                    GetSdfGlyphCache().Rasterize(*distanceField, coverageCanvas, CoverageCanvas::Layer::Outline, distanceFieldScaleX, distanceFieldScaleY
+                        , static_cast<float>(OutlineWidth), penX, baseVerticalPos, 0);
                 }
-
-                const FT_UInt glyph_index = FT_Get_Char_Index(face, codepoint);
-                if (FT_Error error = FT_Load_Glyph(
-                    face,          /* handle to face object */
-                    glyph_index,   /* glyph index           */
-                    FT_LOAD_DEFAULT); error != FT_Err_Ok)/* load flags, see below */
+                else if (packedBits)
                 {
-                    LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, GenerateFreeTypeErrorString("can not Load glyph", error));
+                    FT_BitmapGlyph bitmapGlyph = FreeTypeRenderer::GetStrokerGlyph(GetStroker(), face->glyph, OutlineWidth, outlineRenderMode);
+                    bitCanvas.AccumulateBitmap(bitmapGlyph->bitmap, penX + bitmapGlyph->left, baseVerticalPos - bitmapGlyph->top);
+                    FT_Done_Glyph(reinterpret_cast<FT_Glyph>(bitmapGlyph));
                 }
-
-
-                //Render outline
-                const auto advance = face->glyph->advance.x >> 6;
-
-                if (textCreateParams.maxWidthPx > 0 && penX + advance + mesaureResult.rect.LeftTop().x > static_cast<int>(textCreateParams.maxWidthPx))
+                else if (fusedCompositing && directOutlineSpans && isOutlineGlyph)
                 {
-                    penY += rowHeight;
-                    penX = static_cast<int>(-mesaureResult.rect.LeftTop().x);
-
+                    FT_Glyph strokedGlyph = FreeTypeRenderer::GetStrokerOutlineGlyph(GetStroker(), face->glyph, OutlineWidth);
+                    coverageCanvas.AccumulateOutline(fLibrary, CoverageCanvas::Layer::Outline, reinterpret_cast<FT_OutlineGlyph>(strokedGlyph)->outline
+                        , penX, baseVerticalPos);
+                    FT_Done_Glyph(strokedGlyph);
                 }
-
-                const auto baseVerticalPos = static_cast<int32_t>(rowHeight) + penY + descender - static_cast<int32_t>(OutlineWidth);
-
-                if (renderOutline) // render outline
+                else if (fusedCompositing)
+                {
+                    FT_BitmapGlyph bitmapGlyph = FreeTypeRenderer::GetStrokerGlyph(GetStroker(), face->glyph, OutlineWidth, outlineRenderMode);
+                    coverageCanvas.AccumulateBitmap(CoverageCanvas::Layer::Outline, bitmapGlyph->bitmap
+                        , penX + bitmapGlyph->left, baseVerticalPos - bitmapGlyph->top);
+                    FT_Done_Glyph(reinterpret_cast<FT_Glyph>(bitmapGlyph));
+                }
+                else if (directOutlineSpans && isOutlineGlyph)
+                {
+                    FT_Glyph strokedGlyph = FreeTypeRenderer::GetStrokerOutlineGlyph(GetStroker(), face->glyph, OutlineWidth);
+                    TouchOutline(outlineCanvas, reinterpret_cast<FT_OutlineGlyph>(strokedGlyph)->outline, penX, baseVerticalPos);
+                    FreeTypeRenderer::BlendOutlineSpans(fLibrary, reinterpret_cast<FT_OutlineGlyph>(strokedGlyph)->outline
+                        , penX, baseVerticalPos, outlineColorTable, destOutline);
+                    FT_Done_Glyph(strokedGlyph);
+                }
+                else
                 {
-
                     FT_BitmapGlyph bitmapGlyph = FreeTypeRenderer::GetStrokerGlyph(GetStroker(), face->glyph, OutlineWidth, outlineRenderMode);
                     FreeTypeRenderer::BitmapProperties bitmapProperties = FreeTypeRenderer::GetBitmapGlyphProperties(bitmapGlyph->bitmap);
-                    LLUtils::Buffer rasterizedGlyph = FreeTypeRenderer::RenderGlyphToBuffer({ bitmapGlyph , {0,0,0,0} ,outlineColor, bitmapProperties });
-
-                    BlitBox source = {};
-                    source.buffer = rasterizedGlyph.data();
-                    source.width = bitmapProperties.width;
-                    source.height = bitmapProperties.height;
-                    source.pixelSizeInbytes = destPixelSize;
-                    source.rowPitch = destPixelSize * bitmapProperties.width;
 
                     destOutline.left = static_cast<uint32_t>(penX + bitmapGlyph->left);
                     destOutline.top = static_cast<uint32_t>(baseVerticalPos - bitmapGlyph->top);
-                    BlitBox::BlitPremultiplied<ColorF32>(destOutline, source);
+                    outlineCanvas.Touch(penX + bitmapGlyph->left, baseVerticalPos - bitmapGlyph->top
+                        , static_cast<int32_t>(bitmapProperties.width), static_cast<int32_t>(bitmapProperties.height));
+                    BlendGlyph({ bitmapGlyph , {0,0,0,0} ,outlineColor, bitmapProperties, &outlineColorTable }, destOutline, fMemoryResource);
                     FT_Done_Glyph(reinterpret_cast<FT_Glyph>(bitmapGlyph));
-
                 }
-                // Render text
+            }
+            // Render text
 
+            if (distanceFields)
+            {
+                GetSdfGlyphCache().Rasterize(*distanceField, coverageCanvas, CoverageCanvas::Layer::Fill, distanceFieldScaleX, distanceFieldScaleY
+                    , 0.0f, penX, baseVerticalPos, textColorIndex);
+            }
+            else if (fusedCompositing && directTextSpans && isOutlineGlyph)
+            {
+                coverageCanvas.AccumulateOutline(fLibrary, CoverageCanvas::Layer::Fill, face->glyph->outline, penX, baseVerticalPos, textColorIndex);
+            }
+            else if (directTextSpans && isOutlineGlyph)
+            {
+                TouchOutline(textCanvas, face->glyph->outline, penX, baseVerticalPos);
+                FreeTypeRenderer::BlendOutlineSpans(fLibrary, face->glyph->outline, penX, baseVerticalPos, *textColorTable, dest);
+            }
+            else
+            {
                 FT_Glyph glyph;
                 if (FT_Error error = FT_Get_Glyph(face->glyph, &glyph))
                     LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, "FreeType error, unable to render glyph");
@@ -453,54 +1186,320 @@ namespace FreeType
 
                 FT_BitmapGlyph bitmapGlyph = reinterpret_cast<FT_BitmapGlyph>(glyph);
                 FreeTypeRenderer::BitmapProperties bitmapProperties = FreeTypeRenderer::GetBitmapGlyphProperties(bitmapGlyph->bitmap);
-                const auto textcolor = el.textColor != Color{ 0, 0, 0, 0 } ? el.textColor : params.createParams.textColor;
 
-                LLUtils::Buffer rasterizedGlyph = FreeTypeRenderer::RenderGlyphToBuffer({ bitmapGlyph , backgroundColor, textcolor , bitmapProperties });
+                if (fusedCompositing)
+                {
+                    coverageCanvas.AccumulateBitmap(CoverageCanvas::Layer::Fill, bitmapGlyph->bitmap
+                        , penX + bitmapGlyph->left, baseVerticalPos - bitmapGlyph->top, textColorIndex);
+                }
+                else if (packedBits)
+                {
+                    bitCanvas.AccumulateBitmap(bitmapGlyph->bitmap, penX + bitmapGlyph->left, baseVerticalPos - bitmapGlyph->top);
+                }
+                else
+                {
+                    dest.left = static_cast<uint32_t>(penX + bitmapGlyph->left);
+                    dest.top = static_cast<uint32_t>(baseVerticalPos - bitmapGlyph->top);
+                    textCanvas.Touch(penX + bitmapGlyph->left, baseVerticalPos - bitmapGlyph->top
+                        , static_cast<int32_t>(bitmapProperties.width), static_cast<int32_t>(bitmapProperties.height));
+                    BlendGlyph({ bitmapGlyph , backgroundColor, textcolor , bitmapProperties, textColorTable }, dest, fMemoryResource);
+                }
+                FT_Done_Glyph(glyph);
+            }
 
-                BlitBox source = {};
-                source.buffer = rasterizedGlyph.data();
-                source.width = bitmapProperties.width;
-                source.height = bitmapProperties.height;
-                source.pixelSizeInbytes = destPixelSize;
-                source.rowPitch = destPixelSize * bitmapProperties.width;
+            if (out_glyphMapping != nullptr)
+            {
+                out_glyphMapping->push_back(LLUtils::RectI32{ { penX, penY } ,
+                    {penX + advance, penY + static_cast<int32_t>(rowHeight)} });
+            }
+        });
 
-                dest.left = static_cast<uint32_t>(penX + bitmapGlyph->left);
-                dest.top = static_cast<uint32_t>(baseVerticalPos - bitmapGlyph->top);
+        if (renderOutline && fusedCompositing == false)
+        {
+            //Blend text buffer onto outline buffer, only where text was drawn.
+            textCanvas.BlendOnto(outlineCanvas);
+        }
 
-                if (out_glyphMapping != nullptr)
-                {
-                    out_glyphMapping->push_back(LLUtils::RectI32{ { penX, penY } ,
-                        {penX + static_cast<int32_t>(advance), penY + static_cast<int32_t>(rowHeight)} });
-                }
+        if (coverageOnly)
+        {
+            out_coverage->width = canvasWidth;
+            out_coverage->height = canvasHeight;
+            out_coverage->buffer = std::move(coverageBuffer);
+            out_coverage->linearBlending = linearBlending;
+            out_coverage->runColors.clear();
+            for (const FormattedTextEntry& el : formattedText)
+                out_coverage->runColors.push_back(useMetaText ? el.textColor : Color{ 0, 0, 0, 0 });
+            return;
+        }
 
-                penX += advance;
+        if (coverageMask)
+            return;
 
-                FT_Done_Glyph(glyph);
-                BlitBox::BlitPremultiplied<ColorF32>(dest, source);
-            }
+        if (packedBits)
+        {
+            uint8_t* packedPixels = reinterpret_cast<uint8_t*>(PrepareBitmap(*out_bitmap, canvasWidth, canvasHeight, BitmapFormat::A1));
+            bitCanvas.Resolve(packedPixels, out_bitmap->rowPitch);
+            ReleaseBuffer(std::move(bitBuffer));
+            return;
         }
 
-        if (renderOutline)
+        const SparseCanvas& canvasToResolve = renderOutline ? outlineCanvas : textCanvas;
+        Color* resolvedPixels = reinterpret_cast<Color*>(PrepareBitmap(*out_bitmap, canvasWidth, canvasHeight, BitmapFormat::RGBA));
+
+        if (fusedCompositing)
         {
-            //Blend text buffer onto outline buffer.
-            dest.left = 0;
-            dest.top = 0;
-            destOutline.left = 0;
-            destOutline.top = 0;
-            BlitBox::BlitPremultiplied<ColorF32>(destOutline, dest);
+            // Background, outline and fill are composited and resolved in a single pass.
+            ResolveCoverage(coverageCanvas, resolvedPixels, backgroundColorPremultiplied, outlineColorTable, textColorTables, linearBlending);
         }
+        else if (linearBlending)
+        {
+            canvasToResolve.Resolve(resolvedPixels, &ResolveLinearRow);
+        }
+        else
+        {
+            canvasToResolve.Resolve(resolvedPixels, PixelKernels::GetKernels().resolve);
+        }
+
+        ReleaseBuffer(std::move(textBuffer));
+        ReleaseBuffer(std::move(outlineBuffer));
+        ReleaseBuffer(std::move(coverageBuffer));
+    }
+
+    void FreeTypeConnector::RenderTextBanded(const TextCreateParams& textCreateParams
+        , Bitmap* out_bitmap
+        , const BandCallback* onBand
+        , TextMetrics* in_metrics
+        , GlyphMappings* out_glyphMapping)
+    {
+        using namespace LLUtils;
+        const uint32_t OutlineWidth = textCreateParams.outlineWidth;
+        const bool renderOutline = OutlineWidth > 0;
+        const BitmapFormat format = textCreateParams.bitmapFormat;
+        const bool packedBits = format == BitmapFormat::A1;
+        const bool coverageMask = format == BitmapFormat::A8 || format == BitmapFormat::A8x2;
+        const bool distanceFields = packedBits == false && textCreateParams.renderMode == RenderMode::SignedDistanceField;
 
-        const auto buferToResolve = renderOutline ? std::move(outlineBuffer) : std::move(textBuffer);
-        Buffer resolved(static_cast<size_t>(mesaureResult.rect.GetWidth() * mesaureResult.rect.GetHeight()) * sizeof(Color));
-        ResolvePremultipoliedBUffer<ColorF32, Color>(resolved, buferToResolve, static_cast<uint32_t>(mesaureResult.rect.GetWidth()), static_cast<uint32_t>(mesaureResult.rect.GetHeight()));
+        // Bands are composited like FusedCompositing, LCD text is rendered as gray. 1 bit output uses aliased glyphs.
+        FT_Render_Mode textRenderMode = packedBits ? FT_Render_Mode::FT_RENDER_MODE_MONO : FreeTypeRenderer::GetRenderMode(textCreateParams.renderMode);
+        if (textRenderMode == FT_Render_Mode::FT_RENDER_MODE_LCD)
+            textRenderMode = FT_Render_Mode::FT_RENDER_MODE_NORMAL;
+        const FT_Render_Mode outlineRenderMode = textRenderMode == FT_Render_Mode::FT_RENDER_MODE_MONO ? FT_Render_Mode::FT_RENDER_MODE_MONO : FT_Render_Mode::FT_RENDER_MODE_NORMAL;
 
-        out_bitmap.width = static_cast<uint32_t>(mesaureResult.rect.GetWidth());
-        out_bitmap.height = static_cast<uint32_t>(mesaureResult.rect.GetHeight());
-		
-        out_bitmap.buffer =  std::move(resolved);
-		
-        out_bitmap.PixelSize = sizeof(Color);
-        out_bitmap.rowPitch = static_cast<uint32_t>(sizeof(Color)) * static_cast<uint32_t>(mesaureResult.rect.GetWidth());
+        const BitFlags<TextCreateFlags> createFlags{ textCreateParams.flags };
+        const bool useMetaText = createFlags.test(TextCreateFlags::UseMetaText);
+        const bool usebidiText = createFlags.test(TextCreateFlags::Bidirectional);
+        const bool linearBlending = createFlags.test(TextCreateFlags::LinearBlending);
+        const bool directSpans = createFlags.test(TextCreateFlags::DirectSpanRendering) && packedBits == false;
+        const bool directTextSpans = directSpans && textRenderMode == FT_Render_Mode::FT_RENDER_MODE_NORMAL;
+        const bool directOutlineSpans = directSpans && outlineRenderMode == FT_Render_Mode::FT_RENDER_MODE_NORMAL;
+
+        std::vector<FormattedTextEntry> formattedText;
+        if (useMetaText)
+            formattedText = MetaText::GetFormattedText(textCreateParams.text);
+        else
+            formattedText.push_back({ textCreateParams.textColor, textCreateParams.text });
+
+        if (formattedText.size() > 256)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::LogicError, "Banded rendering supports up to 256 meta text color runs");
+
+        FreeTypeFont* font = GetOrCreateFont(textCreateParams.fontPath);
+        font->SetSize(textCreateParams.fontSize, textCreateParams.DPIx, textCreateParams.DPIy);
+        FT_Face face = font->GetFace();
+
+        TextMetrics metrics(fMemoryResource);
+        if (in_metrics == nullptr)
+            MeasureText({ textCreateParams }, metrics);
+        else
+            metrics = *in_metrics;
+
+        const uint32_t canvasWidth = static_cast<uint32_t>(metrics.rect.GetWidth());
+        const uint32_t canvasHeight = static_cast<uint32_t>(metrics.rect.GetHeight());
+        const int32_t descender = static_cast<int32_t>(face->size->metrics.descender >> 6);
+        const int32_t rowHeight = static_cast<int32_t>(metrics.rowHeight);
+
+        // Glyph position and the rows it may cover, a glyph is loaded again for every band it crosses.
+        struct PlacedGlyph
+        {
+            FT_UInt glyphIndex;
+            int32_t penX;
+            int32_t baseline;
+            int32_t top;
+            int32_t bottom;
+            uint8_t colorIndex;
+        };
+
+        std::pmr::vector<PlacedGlyph> placedGlyphs(fMemoryResource);
+        // Colors are only needed when resolving to RGBA.
+        const bool colorOutput = format == BitmapFormat::RGBA;
+        std::pmr::vector<FreeTypeRenderer::CoverageColorTable> textColorTables(colorOutput ? formattedText.size() : 0, fMemoryResource);
+        FreeTypeRenderer::CoverageColorTable outlineColorTable;
+        if (renderOutline && colorOutput)
+            FreeTypeRenderer::BuildCoverageColorTable(textCreateParams.outlineColor, outlineColorTable, linearBlending);
+
+        if (colorOutput)
+        {
+            for (size_t entryIndex = 0; entryIndex < formattedText.size(); entryIndex++)
+            {
+                const FormattedTextEntry& el = formattedText[entryIndex];
+                const Color textColor = el.textColor != Color{ 0, 0, 0, 0 } ? el.textColor : textCreateParams.textColor;
+                FreeTypeRenderer::BuildCoverageColorTable(textColor, textColorTables[entryIndex], linearBlending);
+            }
+        }
+
+        LayOutText(face, formattedText, usebidiText, textCreateParams.maxWidthPx, [&](const GlyphPlacement& placement)
+        {
+            const int32_t penX = placement.penX - metrics.rect.LeftTop().x;
+            const int32_t penY = static_cast<int32_t>(placement.line) * rowHeight - metrics.rect.LeftTop().y;
+            const int32_t baseline = rowHeight + penY + descender - static_cast<int32_t>(OutlineWidth);
+
+            // The glyph's box from its metrics, grown by the outline and a pixel of rounding on each side.
+            const FT_Glyph_Metrics& glyphMetrics = face->glyph->metrics;
+            const int32_t margin = static_cast<int32_t>(OutlineWidth) + 2;
+            const int32_t top = baseline - static_cast<int32_t>((glyphMetrics.horiBearingY + 63) >> 6) - margin;
+            const int32_t bottom = baseline - static_cast<int32_t>((glyphMetrics.horiBearingY - glyphMetrics.height) >> 6) + margin;
+            placedGlyphs.push_back({ placement.glyphIndex, penX, baseline, top, bottom, static_cast<uint8_t>(placement.entryIndex) });
+
+            if (out_glyphMapping != nullptr)
+                out_glyphMapping->push_back(RectI32{ { penX, penY }, { penX + placement.advance, penY + rowHeight } });
+        });
+
+        // Glyphs by their top row, each band takes the glyphs starting above its end and drops those ending above it.
+        std::pmr::vector<uint32_t> glyphsByTop(placedGlyphs.size(), fMemoryResource);
+        std::iota(glyphsByTop.begin(), glyphsByTop.end(), 0u);
+        std::stable_sort(glyphsByTop.begin(), glyphsByTop.end(), [&](uint32_t a, uint32_t b) { return placedGlyphs[a].top < placedGlyphs[b].top; });
+        std::pmr::vector<uint32_t> bandGlyphs(fMemoryResource);
+        size_t nextGlyph = 0;
+
+        // Bands of at least a line, so a glyph is rasterized for two bands at most.
+        constexpr size_t BandCacheBudget = 256 * 1024;
+        const size_t bytesPerRow = static_cast<size_t>(canvasWidth) * (coverageMask ? 2 : CoverageCanvas::BytesPerPixel + sizeof(Color));
+        uint32_t bandHeight = textCreateParams.bandHeight;
+        if (bandHeight == 0)
+            bandHeight = std::max(static_cast<uint32_t>(std::min<size_t>(BandCacheBudget / std::max<size_t>(bytesPerRow, 1), canvasHeight)), static_cast<uint32_t>(rowHeight));
+        bandHeight = std::clamp(bandHeight, 1u, std::max(canvasHeight, 1u));
+
+        // Coverage masks are accumulated straight into the output rows.
+        ByteBuffer canvasBuffer = AcquireBuffer(packedBits ? BitCanvas::GetBufferSize(canvasWidth, bandHeight)
+            : coverageMask ? 0 : static_cast<size_t>(canvasWidth) * bandHeight * CoverageCanvas::BytesPerPixel);
+
+        Bitmap band;
+        std::byte* output = out_bitmap != nullptr ? PrepareBitmap(*out_bitmap, canvasWidth, canvasHeight, format) : PrepareBitmap(band, canvasWidth, bandHeight, format);
+        const size_t rowPitch = out_bitmap != nullptr ? out_bitmap->rowPitch : band.rowPitch;
+        const CoverageCanvas::Layout coverageLayout = coverageMask == false ? CoverageCanvas::Layout::Planes
+            : format == BitmapFormat::A8 ? CoverageCanvas::Layout::Alpha : CoverageCanvas::Layout::AlphaChannels;
+
+        const ColorF32 backgroundColorPremultiplied = (linearBlending ? GammaTables::ToLinear(textCreateParams.backgroundColor)
+            : static_cast<ColorF32>(textCreateParams.backgroundColor)).MultiplyAlpha();
+
+        // Display pixels per pixel of the distance field size bucket.
+        const float pixelSizeX = static_cast<float>(textCreateParams.fontSize) * static_cast<float>(textCreateParams.DPIx) / 72.0f;
+        const float pixelSizeY = static_cast<float>(textCreateParams.fontSize) * static_cast<float>(textCreateParams.DPIy) / 72.0f;
+        const uint32_t distanceFieldBucket = distanceFields ? SdfGlyphCache::GetBucketSize(pixelSizeY) : 0;
+        const float distanceFieldScaleX = distanceFields ? pixelSizeX / static_cast<float>(distanceFieldBucket) : 0.0f;
+        const float distanceFieldScaleY = distanceFields ? pixelSizeY / static_cast<float>(distanceFieldBucket) : 0.0f;
+
+        for (uint32_t bandTop = 0; bandTop < canvasHeight; bandTop += bandHeight)
+        {
+            const uint32_t bandRows = std::min(bandHeight, canvasHeight - bandTop);
+            LLUTILS_DISABLE_WARNING_PUSH
+            LLUTILS_DISABLE_WARNING_UNSAFE_BUFFER_USAGE
+            std::byte* bandPixels = out_bitmap != nullptr ? output + bandTop * rowPitch : output;
+            LLUTILS_DISABLE_WARNING_POP
+
+            CoverageCanvas coverageCanvas(coverageMask ? bandPixels : canvasBuffer.data(), canvasWidth, bandRows, coverageLayout);
+            BitCanvas bitCanvas(canvasBuffer.data(), canvasWidth, bandRows);
+            if (packedBits)
+                bitCanvas.Clear();
+            else
+                coverageCanvas.Clear();
+
+            while (nextGlyph < glyphsByTop.size() && placedGlyphs[glyphsByTop[nextGlyph]].top < static_cast<int32_t>(bandTop + bandRows))
+                bandGlyphs.push_back(glyphsByTop[nextGlyph++]);
+            std::erase_if(bandGlyphs, [&](uint32_t index) { return placedGlyphs[index].bottom <= static_cast<int32_t>(bandTop); });
+            // In text order, later glyphs take the color index of the pixels they share.
+            std::sort(bandGlyphs.begin(), bandGlyphs.end());
+
+            for (const uint32_t placedIndex : bandGlyphs)
+            {
+                const PlacedGlyph& placedGlyph = placedGlyphs[placedIndex];
+                if (FT_Error error = FT_Load_Glyph(face, placedGlyph.glyphIndex, FT_LOAD_DEFAULT); error != FT_Err_Ok)
+                    LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, GenerateFreeTypeErrorString("can not Load glyph", error));
+
+                const int32_t originX = placedGlyph.penX;
+                const int32_t baseline = placedGlyph.baseline - static_cast<int32_t>(bandTop);
+                const bool isOutlineGlyph = face->glyph->format == FT_GLYPH_FORMAT_OUTLINE && (face->glyph->outline.flags & FT_OUTLINE_OVERLAP) == 0;
+
+                // Looking up a field may render it at the bucket size, which replaces the loaded glyph.
+                const SdfGlyphCache::Glyph* distanceField = distanceFields ? &GetSdfGlyphCache().GetGlyph(face, placedGlyph.glyphIndex, distanceFieldBucket) : nullptr;
+
+                if (renderOutline)
+                {
+                    if (distanceFields)
+                    {
+                        GetSdfGlyphCache().Rasterize(*distanceField, coverageCanvas, CoverageCanvas::Layer::Outline, distanceFieldScaleX, distanceFieldScaleY
+                            , static_cast<float>(OutlineWidth), originX, baseline, 0);
+                    }
+                    else if (directOutlineSpans && isOutlineGlyph)
+                    {
+                        FT_Glyph strokedGlyph = FreeTypeRenderer::GetStrokerOutlineGlyph(GetStroker(), face->glyph, OutlineWidth);
+                        coverageCanvas.AccumulateOutline(fLibrary, CoverageCanvas::Layer::Outline, reinterpret_cast<FT_OutlineGlyph>(strokedGlyph)->outline
+                            , originX, baseline);
+                        FT_Done_Glyph(strokedGlyph);
+                    }
+                    else
+                    {
+                        FT_BitmapGlyph bitmapGlyph = FreeTypeRenderer::GetStrokerGlyph(GetStroker(), face->glyph, OutlineWidth, outlineRenderMode);
+                        if (packedBits)
+                            bitCanvas.AccumulateBitmap(bitmapGlyph->bitmap, originX + bitmapGlyph->left, baseline - bitmapGlyph->top);
+                        else
+                            coverageCanvas.AccumulateBitmap(CoverageCanvas::Layer::Outline, bitmapGlyph->bitmap, originX + bitmapGlyph->left, baseline - bitmapGlyph->top);
+                        FT_Done_Glyph(reinterpret_cast<FT_Glyph>(bitmapGlyph));
+                    }
+                }
+
+                if (distanceFields)
+                {
+                    GetSdfGlyphCache().Rasterize(*distanceField, coverageCanvas, CoverageCanvas::Layer::Fill, distanceFieldScaleX, distanceFieldScaleY
+                        , 0.0f, originX, baseline, placedGlyph.colorIndex);
+                }
+                else if (directTextSpans && isOutlineGlyph)
+                {
+                    coverageCanvas.AccumulateOutline(fLibrary, CoverageCanvas::Layer::Fill, face->glyph->outline, originX, baseline, placedGlyph.colorIndex);
+                }
+                else
+                {
+                    FT_Glyph glyph;
+                    if (FT_Get_Glyph(face->glyph, &glyph) != FT_Err_Ok)
+                        LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, "FreeType error, unable to render glyph");
+
+                    if (glyph->format != FT_GLYPH_FORMAT_BITMAP && FT_Glyph_To_Bitmap(&glyph, textRenderMode, nullptr, true) != FT_Err_Ok)
+                    {
+                        FT_Done_Glyph(glyph);
+                        LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, "FreeType error, unable to render glyph");
+                    }
+
+                    FT_BitmapGlyph bitmapGlyph = reinterpret_cast<FT_BitmapGlyph>(glyph);
+                    if (packedBits)
+                        bitCanvas.AccumulateBitmap(bitmapGlyph->bitmap, originX + bitmapGlyph->left, baseline - bitmapGlyph->top);
+                    else
+                        coverageCanvas.AccumulateBitmap(CoverageCanvas::Layer::Fill, bitmapGlyph->bitmap, originX + bitmapGlyph->left, baseline - bitmapGlyph->top, placedGlyph.colorIndex);
+                    FT_Done_Glyph(glyph);
+                }
+            }
+
+            if (packedBits)
+                bitCanvas.Resolve(reinterpret_cast<uint8_t*>(bandPixels), static_cast<uint32_t>(rowPitch));
+            else if (coverageMask == false)
+                ResolveCoverage(coverageCanvas, reinterpret_cast<Color*>(bandPixels), backgroundColorPremultiplied, outlineColorTable, textColorTables, linearBlending);
+
+            if (onBand != nullptr)
+            {
+                band.height = bandRows;
+                (*onBand)(band, bandTop);
+            }
+        }
 
+        ReleaseBuffer(std::move(canvasBuffer));
+        ReleaseBitmap(band);
     }
-}
\ No newline at end of file
+}
@@ -1,7 +1,16 @@
 #pragma once
 #include "FreeTypeHeaders.h"
+#include <array>
+#include <filesystem>
+#include <fstream>
 #include <string>
 #include <LLUtils/Exception.h>
+#include <LLUtils/Warnings.h>
+LLUTILS_DISABLE_WARNING_PUSH
+LLUTILS_DISABLE_WARNING_UNSAFE_BUFFER_USAGE
+    #define XXH_INLINE_ALL
+    #include <xxhash.h>
+LLUTILS_DISABLE_WARNING_POP
 namespace FreeType
 {
     class FreeTypeFont
@@ -18,6 +27,16 @@ namespace FreeType
             FT_Error error = FT_New_Face(fLibrary, LLUtils::StringUtility::ToAString(fName).c_str(), 0, &fFace);
             if (error)
                 LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, FT_Error_String(error));
+
+            try
+            {
+                fContentHash = HashFile(fName);
+            }
+            catch (...)
+            {
+                FT_Done_Face(fFace);
+                throw;
+            }
         }
         ~FreeTypeFont()
         {
@@ -50,13 +69,34 @@ namespace FreeType
             return fFace;
         }
 
+        // XXH3 hash of the font file's content, identifies the font across processes and file paths.
+        uint64_t GetContentHash() const
+        {
+            return fContentHash;
+        }
+
+    private:
+        static uint64_t HashFile(const std::wstring& fileName)
+        {
+            std::ifstream file(std::filesystem::path(fileName), std::ios::binary);
+            XXH3_state_t state;
+            XXH3_64bits_reset(&state);
+
+            std::array<char, 64 * 1024> chunk;
+            while (file.read(chunk.data(), static_cast<std::streamsize>(chunk.size())) || file.gcount() > 0)
+                XXH3_64bits_update(&state, chunk.data(), static_cast<size_t>(file.gcount()));
 
+            if (file.bad() || file.eof() == false)
+                LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, "Unable to read font file");
+            return XXH3_64bits_digest(&state);
+        }
 
     private:
         std::wstring fName;
         FT_Face fFace = nullptr;
         FT_Library fLibrary = nullptr;
         uint16_t fFontSize = 0;
+        uint64_t fContentHash = 0;
     };
 
     using FreeTypeFontUniquePtr = std::unique_ptr<FreeTypeFont>;
@@ -16,6 +16,9 @@
 #include <ft2build.h>
 #include <freetype/ftstroke.h>
 #include <freetype/ftlcdfil.h>
+#include <freetype/ftmodapi.h>
+#include <freetype/ftoutln.h>
+#include <freetype/ftsizes.h>
 #include <string>
 
 #ifdef __clang__
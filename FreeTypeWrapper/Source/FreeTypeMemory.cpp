@@ -0,0 +1,97 @@
+#include "FreeTypeMemory.h"
+#include <cstring>
+#include <algorithm>
+#include <FreeTypeWrapper/FreeTypeConnector.h>
+
+namespace FreeType
+{
+    FreeTypeMemory::FreeTypeMemory(std::pmr::memory_resource* upstream)
+        : fUpstream(upstream)
+        , fPool(std::pmr::pool_options{ 0, MaxPooledBlockSize }, upstream)
+    {
+        fMemoryRec.user = this;
+        fMemoryRec.alloc = &FreeTypeMemory::Alloc;
+        fMemoryRec.free = &FreeTypeMemory::Free;
+        fMemoryRec.realloc = &FreeTypeMemory::Realloc;
+    }
+
+    FT_Memory FreeTypeMemory::GetFTMemory()
+    {
+        return &fMemoryRec;
+    }
+
+    FreeTypeMemoryStats FreeTypeMemory::GetStats() const
+    {
+        FreeTypeMemoryStats stats;
+        stats.bytesInUse = fBytesInUse.load(std::memory_order_relaxed);
+        stats.peakBytesInUse = fPeakBytesInUse.load(std::memory_order_relaxed);
+        stats.allocationsInUse = fAllocationsInUse.load(std::memory_order_relaxed);
+        stats.totalAllocations = fTotalAllocations.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    std::pmr::memory_resource* FreeTypeMemory::GetResourceForSize(size_t size)
+    {
+        return size <= MaxPooledBlockSize ? static_cast<std::pmr::memory_resource*>(&fPool) : fUpstream;
+    }
+
+    void* FreeTypeMemory::Allocate(size_t size)
+    {
+        const size_t blockSize = size + HeaderSize;
+        std::byte* block = static_cast<std::byte*>(GetResourceForSize(blockSize)->allocate(blockSize, alignof(std::max_align_t)));
+        std::memcpy(block, &size, sizeof(size));
+
+        const size_t bytesInUse = fBytesInUse.fetch_add(size, std::memory_order_relaxed) + size;
+        size_t peak = fPeakBytesInUse.load(std::memory_order_relaxed);
+        while (bytesInUse > peak && fPeakBytesInUse.compare_exchange_weak(peak, bytesInUse, std::memory_order_relaxed) == false);
+        fAllocationsInUse.fetch_add(1, std::memory_order_relaxed);
+        fTotalAllocations.fetch_add(1, std::memory_order_relaxed);
+
+        return block + HeaderSize;
+    }
+
+    void FreeTypeMemory::Deallocate(void* userBlock)
+    {
+        if (userBlock == nullptr)
+            return;
+
+        std::byte* block = static_cast<std::byte*>(userBlock) - HeaderSize;
+        size_t size;
+        std::memcpy(&size, block, sizeof(size));
+
+        fBytesInUse.fetch_sub(size, std::memory_order_relaxed);
+        fAllocationsInUse.fetch_sub(1, std::memory_order_relaxed);
+
+        const size_t blockSize = size + HeaderSize;
+        GetResourceForSize(blockSize)->deallocate(block, blockSize, alignof(std::max_align_t));
+    }
+
+    void* FreeTypeMemory::Alloc(FT_Memory memory, long size)
+    {
+        try
+        {
+            return static_cast<FreeTypeMemory*>(memory->user)->Allocate(static_cast<size_t>(size));
+        }
+        catch (const std::bad_alloc&)
+        {
+            // FreeType reports FT_Err_Out_Of_Memory when the allocator returns null.
+            return nullptr;
+        }
+    }
+
+    void FreeTypeMemory::Free(FT_Memory memory, void* block)
+    {
+        static_cast<FreeTypeMemory*>(memory->user)->Deallocate(block);
+    }
+
+    void* FreeTypeMemory::Realloc(FT_Memory memory, long currentSize, long newSize, void* block)
+    {
+        void* newBlock = Alloc(memory, newSize);
+        if (newBlock != nullptr && block != nullptr)
+        {
+            std::memcpy(newBlock, block, static_cast<size_t>(std::min(currentSize, newSize)));
+            Free(memory, block);
+        }
+        return newBlock;
+    }
+}
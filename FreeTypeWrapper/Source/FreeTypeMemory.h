@@ -0,0 +1,46 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+#include "FreeTypeHeaders.h"
+
+namespace FreeType
+{
+    struct FreeTypeMemoryStats;
+
+    // FT_Memory implementation used for the FreeType library of a connector.
+    // Small blocks are served from a pool resource, larger blocks go straight to the upstream resource.
+    // Every block carries a small header with its size so frees and reallocs can be accounted for.
+    class FreeTypeMemory
+    {
+    public:
+        FreeTypeMemory(std::pmr::memory_resource* upstream);
+        FreeTypeMemory(const FreeTypeMemory&) = delete;
+        FreeTypeMemory& operator=(const FreeTypeMemory&) = delete;
+
+        FT_Memory GetFTMemory();
+        FreeTypeMemoryStats GetStats() const;
+
+    private:
+        static void* Alloc(FT_Memory memory, long size);
+        static void Free(FT_Memory memory, void* block);
+        static void* Realloc(FT_Memory memory, long currentSize, long newSize, void* block);
+
+        void* Allocate(size_t size);
+        void Deallocate(void* block);
+        std::pmr::memory_resource* GetResourceForSize(size_t size);
+
+    private:
+        static constexpr size_t HeaderSize = alignof(std::max_align_t);
+        static constexpr size_t MaxPooledBlockSize = 4096;
+
+        std::pmr::memory_resource* fUpstream;
+        std::pmr::unsynchronized_pool_resource fPool;
+        FT_MemoryRec_ fMemoryRec{};
+
+        std::atomic<size_t> fBytesInUse{};
+        std::atomic<size_t> fPeakBytesInUse{};
+        std::atomic<size_t> fAllocationsInUse{};
+        std::atomic<size_t> fTotalAllocations{};
+    };
+}
@@ -4,20 +4,29 @@
 #include <freetype/freetype.h>
 #include "freetype/ftimage.h"
 #include <LLUtils/Exception.h>
-#include <LLUtils/Buffer.h>
 #include <FreeTypeRenderer.h>
+#include "PixelKernels.h"
+#include "GammaTables.h"
 #include <span>
+#include <algorithm>
+#include <cstring>
 
 namespace FreeType
 {
 
-    FT_BitmapGlyph FreeTypeRenderer::GetStrokerGlyph(FT_Stroker stroker,FT_GlyphSlot glyphSlot, uint32_t outlineWidth, FT_Render_Mode renderMode)
+    FT_Glyph FreeTypeRenderer::GetStrokerOutlineGlyph(FT_Stroker stroker, FT_GlyphSlot glyphSlot, uint32_t outlineWidth)
     {
         //  2 * 64 result in 2px outline
         FT_Stroker_Set(stroker, static_cast<FT_Fixed>(outlineWidth * 64), FT_STROKER_LINECAP_ROUND, FT_STROKER_LINEJOIN_BEVEL, 0);
         FT_Glyph glyph;
         FT_Get_Glyph(glyphSlot, &glyph);
         FT_Glyph_StrokeBorder(&glyph, stroker, false, true);
+        return glyph;
+    }
+
+    FT_BitmapGlyph FreeTypeRenderer::GetStrokerGlyph(FT_Stroker stroker,FT_GlyphSlot glyphSlot, uint32_t outlineWidth, FT_Render_Mode renderMode)
+    {
+        FT_Glyph glyph = GetStrokerOutlineGlyph(stroker, glyphSlot, outlineWidth);
         FT_Glyph_To_Bitmap(&glyph, renderMode, nullptr, true);
         FT_BitmapGlyph bitmapGlyph = reinterpret_cast<FT_BitmapGlyph>(glyph);
         return bitmapGlyph;
@@ -32,6 +41,7 @@ namespace FreeType
             return FT_Render_Mode::FT_RENDER_MODE_MONO;
         case RenderMode::Default:
         case RenderMode::Antialiased:
+        case RenderMode::SignedDistanceField:
             return FT_Render_Mode::FT_RENDER_MODE_NORMAL;
         case RenderMode::SubpixelAntiAliased:
             return FT_Render_Mode::FT_RENDER_MODE_LCD;
@@ -70,7 +80,274 @@ namespace FreeType
         return bitmapProperties;
     }
 
-    LLUtils::Buffer FreeTypeRenderer::RenderGlyphToBuffer(const FreeTypeRenderer::GlyphRGBAParams& params)
+    namespace
+    {
+        using namespace LLUtils;
+
+        enum class GlyphPixelMode
+        {
+              Mono
+            , Gray
+            , Lcd
+        };
+
+        // Bit values of the 8 pixels packed in a MONO bitmap byte, most significant bit first.
+        constexpr auto MonoExpansionTable = []
+        {
+            std::array<std::array<uint8_t, 8>, 256> table{};
+            for (size_t byteValue = 0; byteValue < table.size(); byteValue++)
+                for (size_t bit = 0; bit < 8; bit++)
+                    table[byteValue][bit] = static_cast<uint8_t>((byteValue >> (7 - bit)) & 1);
+            return table;
+        }();
+
+        template <GlyphPixelMode pixelMode>
+        struct GlyphKernel;
+
+        // One bit per pixel, most significant bit first, expanded a whole byte at a time.
+        template <>
+        struct GlyphKernel<GlyphPixelMode::Mono>
+        {
+            static void RenderRow(const uint8_t* source, ColorF32* dest, uint32_t width, const FreeTypeRenderer::GlyphRGBAParams& params)
+            {
+                const std::array<ColorF32, 2>& colors = params.colorTable->monoColors;
+                const uint32_t fullBytes = width / 8;
+
+                for (uint32_t byteIndex = 0; byteIndex < fullBytes; byteIndex++)
+                {
+                    const std::array<uint8_t, 8>& bits = MonoExpansionTable[source[byteIndex]];
+                    ColorF32* destPixels = dest + byteIndex * 8;
+                    for (size_t bit = 0; bit < 8; bit++)
+                        destPixels[bit] = colors[bits[bit]];
+                }
+
+                const uint32_t remainingPixels = width % 8;
+                if (remainingPixels > 0)
+                {
+                    const std::array<uint8_t, 8>& bits = MonoExpansionTable[source[fullBytes]];
+                    ColorF32* destPixels = dest + fullBytes * 8;
+                    for (size_t bit = 0; bit < remainingPixels; bit++)
+                        destPixels[bit] = colors[bits[bit]];
+                }
+            }
+        };
+
+        // One coverage byte per pixel.
+        template <>
+        struct GlyphKernel<GlyphPixelMode::Gray>
+        {
+            static void RenderRow(const uint8_t* source, ColorF32* dest, uint32_t width, const FreeTypeRenderer::GlyphRGBAParams& params)
+            {
+                PixelKernels::GetKernels().expandGray(dest, source, width, params.colorTable->grayColors.data());
+            }
+        };
+
+        // Three subpixel coverage bytes per pixel.
+        template <>
+        struct GlyphKernel<GlyphPixelMode::Lcd>
+        {
+            static void RenderRow(const uint8_t* source, ColorF32* dest, uint32_t width, const FreeTypeRenderer::GlyphRGBAParams& params)
+            {
+                PixelKernels::ExpandLcd(dest, source, width, params.textColor, params.colorTable != nullptr && params.colorTable->linearBlending);
+            }
+        };
+
+        template <GlyphPixelMode pixelMode>
+        void RenderGlyph(const FreeTypeRenderer::GlyphRGBAParams& params, ColorF32* dest)
+        {
+            const FT_Bitmap& bitmap = params.bitmapGlyph->bitmap;
+            const uint32_t width = params.bitmapProperties.width;
+            const uint8_t* sourceRow = bitmap.buffer;
+
+            for (uint32_t y = 0; y < bitmap.rows; y++)
+            {
+                GlyphKernel<pixelMode>::RenderRow(sourceRow, dest, width, params);
+                sourceRow += params.bitmapProperties.rowpitchInBytes;
+                dest += width;
+            }
+        }
+    }
+
+    void FreeTypeRenderer::BuildCoverageColorTable(LLUtils::Color textColor, CoverageColorTable& out_table, bool linearBlending)
+    {
+        using namespace LLUtils;
+        // Same arithmetic as the reference implementation, so table lookups are bit exact.
+        const ColorF32 textColorFloat = linearBlending ? GammaTables::ToLinear(textColor) : static_cast<ColorF32>(textColor);
+        using channel_type = decltype(textColorFloat)::color_channel_type;
+
+        out_table.textColor = textColor;
+        out_table.linearBlending = linearBlending;
+
+        for (size_t coverage = 0; coverage < out_table.grayColors.size(); coverage++)
+        {
+            const ColorF32 color =
+            {
+                  textColorFloat.R()
+                , textColorFloat.G()
+                , textColorFloat.B()
+                , textColorFloat.A() * static_cast<channel_type>(static_cast<uint8_t>(coverage) / 255.0)
+            };
+            out_table.grayColors[coverage] = color.MultiplyAlpha();
+        }
+
+        for (size_t bitValue = 0; bitValue < out_table.monoColors.size(); bitValue++)
+        {
+            const ColorF32 color = { textColorFloat.R(), textColorFloat.G(), textColorFloat.B(), static_cast<channel_type>(bitValue) };
+            out_table.monoColors[bitValue] = color.MultiplyAlpha();
+        }
+    }
+
+    void FreeTypeRenderer::BlendMonoGlyph(const GlyphRGBAParams& params, BlitBox& dest)
+    {
+        using namespace LLUtils;
+
+        const FT_Bitmap& bitmap = params.bitmapGlyph->bitmap;
+        const uint32_t width = params.bitmapProperties.width;
+        const uint32_t height = params.bitmapProperties.height;
+
+        if (bitmap.pixel_mode != FT_PIXEL_MODE_MONO)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::LogicError, "Glyph is not a monochrome bitmap");
+
+        // Perform range check on target.
+        if (dest.left + width > dest.width || dest.top + height > dest.height)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::LogicError, "Buffer out of bounds");
+
+        CoverageColorTable colorTable;
+        if (params.colorTable == nullptr)
+            BuildCoverageColorTable(params.textColor, colorTable);
+        const ColorF32 color = (params.colorTable != nullptr ? params.colorTable : &colorTable)->monoColors[1];
+
+        const uint8_t* sourceRow = bitmap.buffer;
+        std::byte* destRow = dest.buffer + dest.GetStartOffset();
+        const uint32_t bytesPerRow = (width + 7) / 8;
+
+        for (uint32_t y = 0; y < height; y++)
+        {
+            ColorF32* destPixels = reinterpret_cast<ColorF32*>(destRow);
+            for (uint32_t byteIndex = 0; byteIndex < bytesPerRow; byteIndex++)
+            {
+                // Blending a transparent pixel leaves the destination as is, so empty bytes are skipped entirely.
+                const uint8_t byteValue = sourceRow[byteIndex];
+                if (byteValue == 0)
+                    continue;
+
+                const std::array<uint8_t, 8>& bits = MonoExpansionTable[byteValue];
+                const uint32_t pixelsInByte = std::min<uint32_t>(8, width - byteIndex * 8);
+                ColorF32* bytePixels = destPixels + byteIndex * 8;
+                for (uint32_t bit = 0; bit < pixelsInByte; bit++)
+                    if (bits[bit] != 0)
+                        bytePixels[bit] = bytePixels[bit].BlendPreMultiplied(color);
+            }
+
+            sourceRow += params.bitmapProperties.rowpitchInBytes;
+            destRow += dest.rowPitch;
+        }
+    }
+
+    namespace
+    {
+        struct SpanTarget
+        {
+            const FreeTypeRenderer::CoverageColorTable* colorTable;
+            BlitBox* dest;
+            int32_t originX;
+            int32_t baselineY;
+        };
+
+        void BlendSpans(int y, int count, const FT_Span* spans, void* user)
+        {
+            const SpanTarget& target = *static_cast<const SpanTarget*>(user);
+            const BlitBox& dest = *target.dest;
+
+            // Outline coordinates go up from the baseline, canvas rows go down.
+            const int32_t row = target.baselineY - 1 - y;
+            if (row < 0 || row >= static_cast<int32_t>(dest.height))
+                return;
+
+            ColorF32* destRow = reinterpret_cast<ColorF32*>(dest.buffer + static_cast<size_t>(row) * dest.rowPitch);
+
+            for (int i = 0; i < count; i++)
+            {
+                const FT_Span& span = spans[i];
+                const int32_t begin = std::max<int32_t>(target.originX + span.x, 0);
+                const int32_t end = std::min<int32_t>(target.originX + span.x + span.len, static_cast<int32_t>(dest.width));
+                const ColorF32& color = target.colorTable->grayColors[span.coverage];
+
+                for (int32_t x = begin; x < end; x++)
+                    destRow[x] = destRow[x].BlendPreMultiplied(color);
+            }
+        }
+    }
+
+    void FreeTypeRenderer::BlendOutlineSpans(FT_Library library, FT_Outline& outline, int32_t originX, int32_t baselineY, const CoverageColorTable& colorTable, BlitBox& dest)
+    {
+        SpanTarget target{ &colorTable, &dest, originX, baselineY };
+        RenderOutlineSpans(library, outline, dest.width, dest.height, &BlendSpans, &target, target.originX, target.baselineY);
+    }
+
+    void FreeTypeRenderer::RenderOutlineSpans(FT_Library library, FT_Outline& outline, uint32_t width, uint32_t height, FT_SpanFunc spanFunc, void* user
+        , int32_t& originX, int32_t& baselineY)
+    {
+        FT_BBox box;
+        FT_Outline_Get_CBox(&outline, &box);
+        const FT_Pos shiftX = box.xMin & ~FT_Pos{ 63 };
+        const FT_Pos shiftY = box.yMin & ~FT_Pos{ 63 };
+        originX += static_cast<int32_t>(shiftX / 64);
+        baselineY -= static_cast<int32_t>(shiftY / 64);
+
+        FT_Raster_Params rasterParams{};
+        rasterParams.flags = FT_RASTER_FLAG_AA | FT_RASTER_FLAG_DIRECT | FT_RASTER_FLAG_CLIP;
+        rasterParams.gray_spans = spanFunc;
+        rasterParams.user = user;
+        // Clip box is in whole pixels relative to the glyph origin for direct rendering.
+        rasterParams.clip_box.xMin = -originX;
+        rasterParams.clip_box.xMax = static_cast<FT_Pos>(width) - originX;
+        rasterParams.clip_box.yMin = baselineY - static_cast<FT_Pos>(height);
+        rasterParams.clip_box.yMax = baselineY;
+
+        FT_Outline_Translate(&outline, -shiftX, -shiftY);
+        const FT_Error error = FT_Outline_Render(library, &outline, &rasterParams);
+        FT_Outline_Translate(&outline, shiftX, shiftY);
+        if (error != FT_Err_Ok)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, "FreeType error, unable to render outline spans");
+    }
+
+    ByteBuffer FreeTypeRenderer::RenderGlyphToBuffer(const FreeTypeRenderer::GlyphRGBAParams& params, std::pmr::memory_resource* memoryResource)
+    {
+        using namespace LLUtils;
+
+        const size_t bufferSize = static_cast<size_t>(params.bitmapProperties.width) * params.bitmapProperties.height * sizeof(ColorF32);
+        ByteBuffer RGBABitmap(bufferSize, memoryResource);
+        ColorF32* dest = reinterpret_cast<ColorF32*>(RGBABitmap.data());
+
+        GlyphRGBAParams kernelParams = params;
+        CoverageColorTable colorTable;
+        if (kernelParams.colorTable == nullptr && params.bitmapGlyph->bitmap.pixel_mode != FT_PIXEL_MODE_LCD)
+        {
+            BuildCoverageColorTable(params.textColor, colorTable);
+            kernelParams.colorTable = &colorTable;
+        }
+
+        // Select the kernel once per glyph, every kernel writes each destination pixel exactly once.
+        switch (params.bitmapGlyph->bitmap.pixel_mode)
+        {
+        case FT_PIXEL_MODE_MONO:
+            RenderGlyph<GlyphPixelMode::Mono>(kernelParams, dest);
+            break;
+        case FT_PIXEL_MODE_GRAY:
+            RenderGlyph<GlyphPixelMode::Gray>(kernelParams, dest);
+            break;
+        case FT_PIXEL_MODE_LCD:
+            RenderGlyph<GlyphPixelMode::Lcd>(kernelParams, dest);
+            break;
+        default:
+            LL_EXCEPTION_UNEXPECTED_VALUE;
+        }
+
+        return RGBABitmap;
+    }
+
+    ByteBuffer FreeTypeRenderer::RenderGlyphToBufferReference(const FreeTypeRenderer::GlyphRGBAParams& params, std::pmr::memory_resource* memoryResource)
     {
         using namespace LLUtils;
 
@@ -84,7 +361,7 @@ namespace FreeType
         Color textColor = params.textColor;
 
         const size_t bufferSize = widthInPixels * HeightInPixels * destPixelSize;
-        LLUtils::Buffer RGBABitmap(bufferSize);
+        ByteBuffer RGBABitmap(bufferSize, memoryResource);
         memset(RGBABitmap.data(), 0, RGBABitmap.size());
         std::span<ColorF32,std::dynamic_extent> RGBABitmapPtr(reinterpret_cast<ColorF32*>(RGBABitmap.data()), widthInPixels * HeightInPixels);
 
@@ -1,9 +1,12 @@
 #pragma once
+#include <array>
 #include <cstdint>
 #include <LLUtils/Color.h>
-#include <LLUtils/Buffer.h>
+#include <memory_resource>
 #include <FreeTypeHeaders.h>
 #include <FreeTypeWrapper/FreeTypeCommon.h>
+#include <FreeTypeWrapper/ByteBuffer.h>
+#include "BlitBox.h"
 
 namespace FreeType
 {
@@ -19,18 +22,46 @@ namespace FreeType
             uint32_t rowpitchInBytes;
         };
 
+        // Premultiplied text color for every 8 bit coverage value, shared by all glyphs drawn with the same color.
+        struct CoverageColorTable
+        {
+            LLUtils::Color textColor;
+            // Colors are in linear light rather than sRGB.
+            bool linearBlending;
+            std::array<LLUtils::ColorF32, 256> grayColors;
+            std::array<LLUtils::ColorF32, 2> monoColors;
+        };
+
         struct GlyphRGBAParams
         {
             FT_BitmapGlyph bitmapGlyph;
             LLUtils::Color backgroudColor;
             LLUtils::Color textColor;
             BitmapProperties bitmapProperties;
+            // Optional, built from textColor when not given.
+            const CoverageColorTable* colorTable{};
         };
 
+        static FT_Glyph GetStrokerOutlineGlyph(FT_Stroker stroker, FT_GlyphSlot glyphSlot, uint32_t outlineWidth);
         static FT_BitmapGlyph GetStrokerGlyph(FT_Stroker stroker, FT_GlyphSlot glyphSlot, uint32_t outlineWidth, FT_Render_Mode renderMode);
         static FT_Render_Mode GetRenderMode(RenderMode renderMode);
         static BitmapProperties GetBitmapGlyphProperties(const FT_Bitmap_ bitmap);
-        static LLUtils::Buffer RenderGlyphToBuffer(const GlyphRGBAParams& params);
+        static void BuildCoverageColorTable(LLUtils::Color textColor, CoverageColorTable& out_table, bool linearBlending = false);
+        // Renders a glyph into a premultiplied ColorF32 buffer using a kernel specialized for the glyph's pixel mode.
+        static ByteBuffer RenderGlyphToBuffer(const GlyphRGBAParams& params, std::pmr::memory_resource* memoryResource = std::pmr::get_default_resource());
+        // Blends a MONO glyph straight into a premultiplied ColorF32 canvas at dest.left / dest.top, without an intermediate buffer.
+        static void BlendMonoGlyph(const GlyphRGBAParams& params, BlitBox& dest);
+        // Rasterizes an outline with FT_RASTER_FLAG_DIRECT and blends each coverage span straight into a premultiplied
+        // ColorF32 canvas, no glyph bitmap or intermediate buffer is created and pixels outside the spans are never touched.
+        // originX and baselineY are the canvas position of the outline's origin.
+        static void BlendOutlineSpans(FT_Library library, FT_Outline& outline, int32_t originX, int32_t baselineY, const CoverageColorTable& colorTable, BlitBox& dest);
+        // Rasterizes an outline with FT_RASTER_FLAG_DIRECT, clipped to a width x height canvas. The rasterizer's coverage
+        // depends on the outline's position, so the outline is moved to its pixel aligned bounding box like FT_Render_Glyph
+        // does and the spans match the glyph bitmap exactly. originX and baselineY are moved along, spanFunc reads them.
+        static void RenderOutlineSpans(FT_Library library, FT_Outline& outline, uint32_t width, uint32_t height, FT_SpanFunc spanFunc, void* user
+            , int32_t& originX, int32_t& baselineY);
+        // Straightforward per pixel implementation, kept as the reference the specialized kernels are verified against.
+        static ByteBuffer RenderGlyphToBufferReference(const GlyphRGBAParams& params, std::pmr::memory_resource* memoryResource = std::pmr::get_default_resource());
 
     };
 }
\ No newline at end of file
@@ -0,0 +1,38 @@
+#include "GammaTables.h"
+#include <cmath>
+
+namespace FreeType
+{
+    const std::array<float, 256>& GammaTables::GetSRGBToLinearTable()
+    {
+        static const std::array<float, 256> table = []
+        {
+            std::array<float, 256> result{};
+            for (size_t i = 0; i < result.size(); i++)
+            {
+                const double value = static_cast<double>(i) / 255.0;
+                result[i] = static_cast<float>(value <= 0.04045 ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4));
+            }
+            return result;
+        }();
+
+        return table;
+    }
+
+    const std::array<uint8_t, GammaTables::LinearToSRGBTableSize>& GammaTables::GetLinearToSRGBTable()
+    {
+        static const std::array<uint8_t, LinearToSRGBTableSize> table = []
+        {
+            std::array<uint8_t, LinearToSRGBTableSize> result{};
+            for (size_t i = 0; i < result.size(); i++)
+            {
+                const double value = static_cast<double>(i) / static_cast<double>(LinearToSRGBTableSize - 1);
+                const double encoded = value <= 0.0031308 ? value * 12.92 : 1.055 * std::pow(value, 1.0 / 2.4) - 0.055;
+                result[i] = static_cast<uint8_t>(std::clamp(encoded * 255.0 + 0.5, 0.0, 255.0));
+            }
+            return result;
+        }();
+
+        return table;
+    }
+}
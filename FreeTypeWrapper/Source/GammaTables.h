@@ -0,0 +1,50 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <algorithm>
+#include <LLUtils/Color.h>
+
+namespace FreeType
+{
+    // Lookup tables for converting between 8 bit sRGB and linear light float channels.
+    // std::pow is not constexpr, so the tables are built once on first use rather than at compile time.
+    class GammaTables
+    {
+    public:
+        // Linear values are quantized to 12 bits when converting back, fine enough for an exact 8 bit round trip.
+        static constexpr size_t LinearToSRGBTableSize = 4096;
+
+        static const std::array<float, 256>& GetSRGBToLinearTable();
+        static const std::array<uint8_t, LinearToSRGBTableSize>& GetLinearToSRGBTable();
+
+        static float SRGBToLinear(uint8_t value)
+        {
+            return GetSRGBToLinearTable()[value];
+        }
+
+        static uint8_t LinearToSRGB(float value)
+        {
+            const float index = std::clamp(value, 0.0f, 1.0f) * static_cast<float>(LinearToSRGBTableSize - 1) + 0.5f;
+            return GetLinearToSRGBTable()[static_cast<size_t>(index)];
+        }
+
+        // Straight (not premultiplied) linear light color, alpha is not gamma encoded.
+        static LLUtils::ColorF32 ToLinear(LLUtils::Color color)
+        {
+            const auto& table = GetSRGBToLinearTable();
+            return { table[color.R()], table[color.G()], table[color.B()], static_cast<float>(color.A()) / 255.0f };
+        }
+
+        // Converts a straight linear light color back to 8 bit sRGB.
+        static LLUtils::Color FromLinear(const LLUtils::ColorF32& color)
+        {
+            return
+            {
+                  LinearToSRGB(color.R())
+                , LinearToSRGB(color.G())
+                , LinearToSRGB(color.B())
+                , static_cast<uint8_t>(std::clamp(color.A(), 0.0f, 1.0f) * 255.0f + 0.5f)
+            };
+        }
+    };
+}
@@ -0,0 +1,277 @@
+#include <FreeTypeWrapper/GlyphAtlas.h>
+#include <algorithm>
+#include <cstring>
+#include <LLUtils/Exception.h>
+#include <LLUtils/Warnings.h>
+#include "FreeTypeHeaders.h"
+#include "FreeTypeFont.h"
+#include "GlyphCacheFile.h"
+#include "ShelfPacker.h"
+
+namespace FreeType
+{
+    namespace
+    {
+        // Glyphs are loaded with the default flags by the connector's layout.
+        GlyphCacheFile::Key GetFileKey(const FreeTypeConnector::GlyphQuadCache::GlyphKey& key)
+        {
+            constexpr uint32_t FreeTypeVersion = FREETYPE_MAJOR * 10000 + FREETYPE_MINOR * 100 + FREETYPE_PATCH;
+            return { key.font->GetContentHash(), key.glyphIndex, key.fontSize, key.DPIx, key.DPIy, key.renderMode, key.outlineWidth
+                , FreeTypeVersion, static_cast<uint32_t>(FT_LOAD_DEFAULT) };
+        }
+    }
+
+    GlyphAtlas::GlyphAtlas(FreeTypeConnector& connector, const GlyphAtlasParams& params)
+        : fConnector(connector)
+        , fParams(params)
+        , fPacker(std::make_unique<ShelfPacker>(params.width, params.height, params.padding, connector.GetMemoryResource()))
+        , fGlyphs(connector.GetMemoryResource())
+        , fLeastRecentlyUsed(connector.GetMemoryResource())
+        , fDirtyRects(connector.GetMemoryResource())
+    {
+        if (params.format != BitmapFormat::A8 && params.format != BitmapFormat::RGBA)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "Glyph atlas pages are either A8 or RGBA");
+        if (params.width == 0 || params.height == 0)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "Glyph atlas page must not be empty");
+
+        std::byte* pixels = fConnector.PrepareBitmap(fPage, params.width, params.height, params.format);
+        std::memset(pixels, 0, static_cast<size_t>(fPage.rowPitch) * fPage.height);
+    }
+
+    GlyphAtlas::~GlyphAtlas()
+    {
+        fConnector.ReleaseBitmap(fPage);
+    }
+
+    bool GlyphAtlas::LayoutQuads(const TextCreateParams& params, std::pmr::vector<GlyphQuad>& out_quads)
+    {
+        fLayoutCount++;
+        return fConnector.LayoutQuads(params, static_cast<GlyphQuadCache&>(*this), out_quads);
+    }
+
+    void GlyphAtlas::TakeDirtyRects(std::pmr::vector<AtlasRect>& out_rects)
+    {
+        out_rects.assign(fDirtyRects.begin(), fDirtyRects.end());
+        fDirtyRects.clear();
+    }
+
+    void GlyphAtlas::Clear()
+    {
+        fGlyphs.clear();
+        fLeastRecentlyUsed.clear();
+        fPacker->Clear();
+    }
+
+    void GlyphAtlas::SaveCacheFile(const std::wstring& filePath) const
+    {
+        std::pmr::vector<GlyphCacheFile::Glyph> glyphs(fConnector.GetMemoryResource());
+        glyphs.reserve(fGlyphs.size());
+
+        LLUTILS_DISABLE_WARNING_PUSH
+        LLUTILS_DISABLE_WARNING_UNSAFE_BUFFER_USAGE
+        for (const auto& [key, entry] : fGlyphs)
+        {
+            const GlyphCacheFile::Key fileKey = GetFileKey(key);
+            const std::byte* pixels = fPage.buffer.data() + static_cast<size_t>(entry.y) * fPage.rowPitch + static_cast<size_t>(entry.x) * fPage.PixelSize;
+            glyphs.push_back({ fileKey, entry.left, entry.top, entry.width, entry.height, pixels, fPage.rowPitch });
+        }
+        LLUTILS_DISABLE_WARNING_POP
+
+        GlyphCacheFile::Save(filePath, fPage.PixelSize, glyphs, fConnector.GetMemoryResource());
+    }
+
+    bool GlyphAtlas::OpenCacheFile(const std::wstring& filePath)
+    {
+        std::unique_ptr<GlyphCacheFile> cacheFile = GlyphCacheFile::Open(filePath);
+        if (cacheFile == nullptr || cacheFile->GetPixelSize() != fPage.PixelSize)
+            return false;
+
+        fCacheFile = std::move(cacheFile);
+        return true;
+    }
+
+    void GlyphAtlas::CloseCacheFile()
+    {
+        fCacheFile.reset();
+    }
+
+    const GlyphAtlas::Entry* GlyphAtlas::Find(const GlyphKey& key)
+    {
+        auto it = fGlyphs.find(key);
+        if (it != fGlyphs.end())
+        {
+            Entry& entry = it->second;
+            entry.lastUse = fLayoutCount;
+            fLeastRecentlyUsed.splice(fLeastRecentlyUsed.end(), fLeastRecentlyUsed, entry.lruPosition);
+            return &entry;
+        }
+
+        if (fCacheFile == nullptr)
+            return nullptr;
+
+        const GlyphCacheFile::Key fileKey = GetFileKey(key);
+        const std::optional<GlyphCacheFile::Glyph> cached = fCacheFile->Find(fileKey);
+        if (cached.has_value() == false)
+            return nullptr;
+
+        Entry* entry = Allocate(key, cached->width, cached->height, cached->left, cached->top);
+        if (entry != nullptr)
+        {
+            uint8_t* dest = GetPixels(*entry);
+            const size_t rowSize = static_cast<size_t>(entry->width) * fPage.PixelSize;
+
+            LLUTILS_DISABLE_WARNING_PUSH
+            LLUTILS_DISABLE_WARNING_UNSAFE_BUFFER_USAGE
+            for (uint32_t row = 0; row < entry->height; row++)
+                std::memcpy(dest + static_cast<size_t>(row) * fPage.rowPitch, cached->pixels + static_cast<size_t>(row) * cached->rowPitch, rowSize);
+            LLUTILS_DISABLE_WARNING_POP
+            fCacheFileHitCount++;
+        }
+
+        return entry;
+    }
+
+    bool GlyphAtlas::FindQuad(const GlyphKey& key, int32_t penX, int32_t baseline, LLUtils::Color color, GlyphQuad& out_quad)
+    {
+        const Entry* entry = Find(key);
+        if (entry != nullptr)
+            out_quad = GetQuad(*entry, penX, baseline, color);
+        return entry != nullptr;
+    }
+
+    bool GlyphAtlas::InsertQuad(const GlyphKey& key, const FT_Bitmap& bitmap, int32_t left, int32_t top
+        , int32_t penX, int32_t baseline, LLUtils::Color color, GlyphQuad& out_quad)
+    {
+        const Entry* entry = Insert(key, bitmap, left, top);
+        if (entry != nullptr)
+            out_quad = GetQuad(*entry, penX, baseline, color);
+        return entry != nullptr;
+    }
+
+    void GlyphAtlas::Evict(std::pmr::map<GlyphKey, Entry>::iterator glyph)
+    {
+        const Entry& entry = glyph->second;
+        if (entry.width > 0)
+            fPacker->Free(entry.x, entry.y, entry.width);
+        fLeastRecentlyUsed.erase(entry.lruPosition);
+        fGlyphs.erase(glyph);
+        fEvictionCount++;
+    }
+
+    void GlyphAtlas::AddDirtyRect(const AtlasRect& rect)
+    {
+        // Glyphs are mostly added left to right along a shelf, extend the previous rectangle when they are adjacent.
+        if (fDirtyRects.empty() == false)
+        {
+            AtlasRect& last = fDirtyRects.back();
+            if (last.y == rect.y && last.height == rect.height && last.x + last.width == rect.x)
+            {
+                last.width += rect.width;
+                return;
+            }
+        }
+        fDirtyRects.push_back(rect);
+    }
+
+    LLUTILS_DISABLE_WARNING_PUSH
+    LLUTILS_DISABLE_WARNING_UNSAFE_BUFFER_USAGE
+    GlyphAtlas::Entry* GlyphAtlas::Allocate(const GlyphKey& key, uint32_t width, uint32_t height, int32_t left, int32_t top)
+    {
+        uint32_t x = 0;
+        uint32_t y = 0;
+        if (width > fPage.width || height > fPage.height)
+            return nullptr;
+
+        const bool drawn = width > 0 && height > 0;
+        if (drawn)
+        {
+            // Make room by evicting the least recently used glyphs, but none the current layout uses.
+            while (fPacker->Pack(width, height, x, y) == false)
+            {
+                if (fLeastRecentlyUsed.empty() || fGlyphs.at(fLeastRecentlyUsed.front()).lastUse == fLayoutCount)
+                    return nullptr;
+                Evict(fGlyphs.find(fLeastRecentlyUsed.front()));
+            }
+
+            // The padding right of and below the glyph is cleared as well, it may hold an evicted glyph.
+            const uint32_t clearWidth = std::min(width + fParams.padding, fPage.width - x);
+            const uint32_t clearHeight = std::min(height + fParams.padding, fPage.height - y);
+            uint8_t* dest = reinterpret_cast<uint8_t*>(fPage.buffer.data()) + static_cast<size_t>(y) * fPage.rowPitch + static_cast<size_t>(x) * fPage.PixelSize;
+            for (uint32_t row = 0; row < clearHeight; row++)
+                std::memset(dest + static_cast<size_t>(row) * fPage.rowPitch, 0, static_cast<size_t>(clearWidth) * fPage.PixelSize);
+
+            AddDirtyRect({ x, y, clearWidth, clearHeight });
+        }
+
+        fLeastRecentlyUsed.push_back(key);
+        const Entry entry{ x, y, drawn ? width : 0, drawn ? height : 0, left, top, fLayoutCount, std::prev(fLeastRecentlyUsed.end()) };
+        return &fGlyphs.insert_or_assign(key, entry).first->second;
+    }
+
+    uint8_t* GlyphAtlas::GetPixels(const Entry& entry)
+    {
+        return reinterpret_cast<uint8_t*>(fPage.buffer.data()) + static_cast<size_t>(entry.y) * fPage.rowPitch + static_cast<size_t>(entry.x) * fPage.PixelSize;
+    }
+
+    const GlyphAtlas::Entry* GlyphAtlas::Insert(const GlyphKey& key, const FT_Bitmap& bitmap, int32_t left, int32_t top)
+    {
+        const bool lcd = bitmap.pixel_mode == FT_PIXEL_MODE_LCD;
+        Entry* entry = Allocate(key, lcd ? bitmap.width / 3 : bitmap.width, bitmap.rows, left, top);
+        if (entry == nullptr)
+            return nullptr;
+
+        const uint32_t pixelSize = fPage.PixelSize;
+        uint8_t* dest = GetPixels(*entry);
+        for (uint32_t row = 0; row < entry->height; row++)
+        {
+            uint8_t* destRow = dest + static_cast<size_t>(row) * fPage.rowPitch;
+            const uint8_t* sourceRow = bitmap.buffer + static_cast<ptrdiff_t>(row) * bitmap.pitch;
+            for (uint32_t column = 0; column < entry->width; column++)
+            {
+                uint8_t* pixel = destRow + static_cast<size_t>(column) * pixelSize;
+                if (lcd)
+                {
+                    const uint8_t* subpixels = sourceRow + column * 3;
+                    const uint8_t coverage = std::max({ subpixels[0], subpixels[1], subpixels[2] });
+                    if (pixelSize == 1)
+                    {
+                        pixel[0] = coverage;
+                    }
+                    else
+                    {
+                        pixel[0] = subpixels[0];
+                        pixel[1] = subpixels[1];
+                        pixel[2] = subpixels[2];
+                        pixel[3] = coverage;
+                    }
+                    continue;
+                }
+
+                const uint8_t coverage = bitmap.pixel_mode == FT_PIXEL_MODE_MONO
+                    ? ((sourceRow[column / 8] & (0x80 >> (column % 8))) != 0 ? uint8_t{ 255 } : uint8_t{ 0 }) : sourceRow[column];
+                std::memset(pixel, coverage, pixelSize);
+            }
+        }
+
+        return entry;
+    }
+    LLUTILS_DISABLE_WARNING_POP
+
+    GlyphQuad GlyphAtlas::GetQuad(const Entry& entry, int32_t penX, int32_t baseline, LLUtils::Color color) const
+    {
+        const float pageWidth = static_cast<float>(fPage.width);
+        const float pageHeight = static_cast<float>(fPage.height);
+
+        GlyphQuad quad;
+        quad.left = penX + entry.left;
+        quad.top = baseline - entry.top;
+        quad.width = entry.width;
+        quad.height = entry.height;
+        quad.u0 = static_cast<float>(entry.x) / pageWidth;
+        quad.v0 = static_cast<float>(entry.y) / pageHeight;
+        quad.u1 = static_cast<float>(entry.x + entry.width) / pageWidth;
+        quad.v1 = static_cast<float>(entry.y + entry.height) / pageHeight;
+        quad.color = color;
+        return quad;
+    }
+}
@@ -0,0 +1,286 @@
+#include "GlyphCacheFile.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <vector>
+#include <LLUtils/Exception.h>
+#include <LLUtils/Warnings.h>
+LLUTILS_DISABLE_WARNING_PUSH
+LLUTILS_DISABLE_WARNING_UNSAFE_BUFFER_USAGE
+    #define XXH_INLINE_ALL
+    #include <xxhash.h>
+LLUTILS_DISABLE_WARNING_POP
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace FreeType
+{
+    namespace
+    {
+        // "FTGC" in a little endian file, files of the other byte order don't match.
+        constexpr uint32_t Magic = 0x43475446;
+        // Incremented on every change to the layout or to how glyphs are rendered.
+        constexpr uint32_t Version = 2;
+
+        uint64_t HashBytes(std::span<const std::byte> bytes)
+        {
+            return XXH3_64bits(bytes.data(), bytes.size());
+        }
+    }
+
+    struct GlyphCacheFile::Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t pixelSize;
+        uint32_t glyphCount;
+        uint64_t dataSize;
+        uint64_t indexChecksum;
+        // Of all the fields above.
+        uint64_t headerChecksum;
+    };
+
+    struct GlyphCacheFile::IndexEntry
+    {
+        uint64_t fontHash;
+        uint32_t glyphIndex;
+        uint16_t fontSize;
+        uint16_t DPIx;
+        uint16_t DPIy;
+        uint8_t renderMode;
+        uint8_t reserved;
+        uint32_t outlineWidth;
+        uint32_t freetypeVersion;
+        uint32_t loadFlags;
+        int32_t left;
+        int32_t top;
+        uint32_t width;
+        uint32_t height;
+        // Relative to the start of the pixels.
+        uint64_t dataOffset;
+        uint64_t dataChecksum;
+
+        Key GetKey() const { return { fontHash, glyphIndex, fontSize, DPIx, DPIy, renderMode, outlineWidth, freetypeVersion, loadFlags }; }
+    };
+
+    void GlyphCacheFile::Save(const std::wstring& filePath, uint32_t pixelSize, std::span<const Glyph> glyphs, std::pmr::memory_resource* memoryResource)
+    {
+        static_assert(sizeof(Header) == 40 && sizeof(IndexEntry) == 64, "Glyph cache file layout changed, increment the version");
+
+        std::pmr::vector<const Glyph*> sortedGlyphs(memoryResource);
+        sortedGlyphs.reserve(glyphs.size());
+        for (const Glyph& glyph : glyphs)
+            sortedGlyphs.push_back(&glyph);
+
+        // Different font paths may hold the same font, only the first of equal keys is kept.
+        std::stable_sort(sortedGlyphs.begin(), sortedGlyphs.end(), [](const Glyph* a, const Glyph* b) { return a->key < b->key; });
+        sortedGlyphs.erase(std::unique(sortedGlyphs.begin(), sortedGlyphs.end(), [](const Glyph* a, const Glyph* b) { return a->key == b->key; }), sortedGlyphs.end());
+
+        std::pmr::vector<IndexEntry> index(memoryResource);
+        std::pmr::vector<std::byte> data(memoryResource);
+        index.reserve(sortedGlyphs.size());
+
+        LLUTILS_DISABLE_WARNING_PUSH
+        LLUTILS_DISABLE_WARNING_UNSAFE_BUFFER_USAGE
+        for (const Glyph* glyph : sortedGlyphs)
+        {
+            const size_t rowSize = static_cast<size_t>(glyph->width) * pixelSize;
+            const size_t offset = data.size();
+            data.resize(offset + rowSize * glyph->height);
+            for (uint32_t y = 0; y < glyph->height; y++)
+                std::memcpy(data.data() + offset + y * rowSize, glyph->pixels + y * glyph->rowPitch, rowSize);
+
+            IndexEntry& entry = index.emplace_back();
+            entry.fontHash = glyph->key.fontHash;
+            entry.glyphIndex = glyph->key.glyphIndex;
+            entry.fontSize = glyph->key.fontSize;
+            entry.DPIx = glyph->key.DPIx;
+            entry.DPIy = glyph->key.DPIy;
+            entry.renderMode = glyph->key.renderMode;
+            entry.outlineWidth = glyph->key.outlineWidth;
+            entry.freetypeVersion = glyph->key.freetypeVersion;
+            entry.loadFlags = glyph->key.loadFlags;
+            entry.left = glyph->left;
+            entry.top = glyph->top;
+            entry.width = glyph->width;
+            entry.height = glyph->height;
+            entry.dataOffset = offset;
+            entry.dataChecksum = HashBytes(std::span(data).subspan(offset));
+        }
+        LLUTILS_DISABLE_WARNING_POP
+
+        Header header{ Magic, Version, pixelSize, static_cast<uint32_t>(index.size()), data.size(), HashBytes(std::as_bytes(std::span(index))), 0 };
+        header.headerChecksum = HashBytes(std::as_bytes(std::span(&header, 1)).first(offsetof(Header, headerChecksum)));
+
+        // Written next to the destination under a name of its own, so concurrent saves don't write into each other, and
+        // renamed over it.
+        const std::filesystem::path destination(filePath);
+        std::filesystem::path temporary = destination;
+        std::random_device random;
+        const uint64_t suffix = (static_cast<uint64_t>(random()) << 32) ^ random();
+        temporary += "." + std::to_string(suffix) + ".tmp";
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(index.size() * sizeof(IndexEntry)));
+            file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+            file.close();
+            if (file.fail())
+            {
+                std::error_code error;
+                std::filesystem::remove(temporary, error);
+                LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, "Unable to write glyph cache file");
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(temporary, destination, error);
+        if (error)
+        {
+            std::filesystem::remove(temporary, error);
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, "Unable to replace glyph cache file");
+        }
+    }
+
+    std::unique_ptr<GlyphCacheFile> GlyphCacheFile::Open(const std::wstring& filePath)
+    {
+        std::unique_ptr<GlyphCacheFile> cacheFile(new GlyphCacheFile());
+        const std::filesystem::path path(filePath);
+
+#if defined(_WIN32)
+        HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return nullptr;
+        cacheFile->fFile = file;
+
+        LARGE_INTEGER size;
+        if (GetFileSizeEx(file, &size) == FALSE || size.QuadPart < static_cast<LONGLONG>(sizeof(Header)))
+            return nullptr;
+
+        cacheFile->fMapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (cacheFile->fMapping == nullptr)
+            return nullptr;
+
+        cacheFile->fView = static_cast<const std::byte*>(MapViewOfFile(cacheFile->fMapping, FILE_MAP_READ, 0, 0, 0));
+        if (cacheFile->fView == nullptr)
+            return nullptr;
+        cacheFile->fSize = static_cast<size_t>(size.QuadPart);
+#else
+        const int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (file < 0)
+            return nullptr;
+
+        struct stat status;
+        void* view = MAP_FAILED;
+        if (fstat(file, &status) == 0 && status.st_size >= static_cast<off_t>(sizeof(Header)))
+            view = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_SHARED, file, 0);
+        // The mapping keeps the file alive.
+        close(file);
+
+        if (view == MAP_FAILED)
+            return nullptr;
+        cacheFile->fView = static_cast<const std::byte*>(view);
+        cacheFile->fSize = static_cast<size_t>(status.st_size);
+#endif
+
+        Header header;
+        std::memcpy(&header, cacheFile->fView, sizeof(header));
+        if (header.magic != Magic || header.version != Version || (header.pixelSize != 1 && header.pixelSize != 4))
+            return nullptr;
+
+        const auto headerBytes = std::span(cacheFile->fView, sizeof(Header));
+        if (HashBytes(headerBytes.first(offsetof(Header, headerChecksum))) != header.headerChecksum)
+            return nullptr;
+
+        const size_t indexSize = static_cast<size_t>(header.glyphCount) * sizeof(IndexEntry);
+        if (cacheFile->fSize - sizeof(Header) < indexSize || cacheFile->fSize - sizeof(Header) - indexSize != header.dataSize)
+            return nullptr;
+
+        if (HashBytes(std::as_bytes(cacheFile->GetIndex())) != header.indexChecksum)
+            return nullptr;
+
+        return cacheFile;
+    }
+
+    GlyphCacheFile::~GlyphCacheFile()
+    {
+        Unmap();
+    }
+
+    void GlyphCacheFile::Unmap()
+    {
+#if defined(_WIN32)
+        if (fView != nullptr)
+            UnmapViewOfFile(fView);
+        if (fMapping != nullptr)
+            CloseHandle(fMapping);
+        if (fFile != nullptr)
+            CloseHandle(fFile);
+        fMapping = nullptr;
+        fFile = nullptr;
+#else
+        if (fView != nullptr)
+            munmap(const_cast<std::byte*>(fView), fSize);
+#endif
+        fView = nullptr;
+        fSize = 0;
+    }
+
+    uint32_t GlyphCacheFile::GetPixelSize() const
+    {
+        Header header;
+        std::memcpy(&header, fView, sizeof(header));
+        return header.pixelSize;
+    }
+
+    size_t GlyphCacheFile::GetGlyphCount() const
+    {
+        return GetIndex().size();
+    }
+
+    LLUTILS_DISABLE_WARNING_PUSH
+    LLUTILS_DISABLE_WARNING_UNSAFE_BUFFER_USAGE
+    std::span<const GlyphCacheFile::IndexEntry> GlyphCacheFile::GetIndex() const
+    {
+        Header header;
+        std::memcpy(&header, fView, sizeof(header));
+        // Mappings are page aligned and the header size is a multiple of the entry alignment.
+        return { reinterpret_cast<const IndexEntry*>(fView + sizeof(Header)), header.glyphCount };
+    }
+    LLUTILS_DISABLE_WARNING_POP
+
+    LLUTILS_DISABLE_WARNING_PUSH
+    LLUTILS_DISABLE_WARNING_UNSAFE_BUFFER_USAGE
+    std::optional<GlyphCacheFile::Glyph> GlyphCacheFile::Find(const Key& key) const
+    {
+        const std::span<const IndexEntry> index = GetIndex();
+        const auto it = std::lower_bound(index.begin(), index.end(), key, [](const IndexEntry& entry, const Key& value) { return entry.GetKey() < value; });
+        if (it == index.end() || it->GetKey() != key)
+            return std::nullopt;
+
+        const size_t dataStart = sizeof(Header) + index.size_bytes();
+        const size_t dataSize = fSize - dataStart;
+        const size_t rowPitch = static_cast<size_t>(it->width) * GetPixelSize();
+        const size_t size = rowPitch * it->height;
+        if (it->dataOffset > dataSize || dataSize - it->dataOffset < size)
+            return std::nullopt;
+
+        const std::span<const std::byte> pixels(fView + dataStart + it->dataOffset, size);
+        if (HashBytes(pixels) != it->dataChecksum)
+            return std::nullopt;
+
+        return Glyph{ key, it->left, it->top, it->width, it->height, pixels.data(), rowPitch };
+    }
+    LLUTILS_DISABLE_WARNING_POP
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <string>
+
+namespace FreeType
+{
+    // Rendered glyphs saved to a file and mapped read-only by later processes, so they start with the glyphs of an
+    // earlier run instead of rasterizing them again. Only the index is read when the file is opened, the pixels of a
+    // glyph are paged in by the system when the glyph is first looked up.
+    //
+    // Layout, native byte order: a header, the index sorted by key, then the pixels of every glyph, rows tightly
+    // packed. The header and the index carry a checksum verified on open, the pixels of each glyph one verified on
+    // lookup.
+    class GlyphCacheFile
+    {
+    public:
+        struct Key
+        {
+            // Hash of the font file's content, font paths differ between machines.
+            uint64_t fontHash;
+            uint32_t glyphIndex;
+            uint16_t fontSize;
+            uint16_t DPIx;
+            uint16_t DPIy;
+            uint8_t renderMode;
+            uint32_t outlineWidth;
+            // Glyphs rendered by another FreeType version or loaded with other flags may differ.
+            uint32_t freetypeVersion;
+            uint32_t loadFlags;
+
+            auto operator<=>(const Key&) const = default;
+        };
+
+        struct Glyph
+        {
+            Key key;
+            // Position of the bitmap relative to the pen position on the baseline, y up.
+            int32_t left;
+            int32_t top;
+            uint32_t width;
+            uint32_t height;
+            const std::byte* pixels;
+            size_t rowPitch;
+        };
+
+        // Writes the glyphs to a new file replacing filePath, glyphs are width * height pixels of pixelSize bytes each.
+        // On POSIX systems processes that mapped the old file keep reading it. Windows doesn't replace a file another
+        // process has mapped, Save throws then.
+        static void Save(const std::wstring& filePath, uint32_t pixelSize, std::span<const Glyph> glyphs, std::pmr::memory_resource* memoryResource);
+
+        // Maps a file written by Save. Returns nullptr when it doesn't exist, was written by another version or fails its
+        // checksum, e.g. after an interrupted write.
+        static std::unique_ptr<GlyphCacheFile> Open(const std::wstring& filePath);
+
+        ~GlyphCacheFile();
+        GlyphCacheFile(const GlyphCacheFile&) = delete;
+        GlyphCacheFile& operator=(const GlyphCacheFile&) = delete;
+
+        uint32_t GetPixelSize() const;
+        size_t GetGlyphCount() const;
+
+        // Pixels of the glyph point into the mapped file and are valid for the lifetime of this object. Glyphs whose
+        // pixels fail their checksum are not found.
+        std::optional<Glyph> Find(const Key& key) const;
+
+    private:
+        struct Header;
+        struct IndexEntry;
+
+        GlyphCacheFile() = default;
+        std::span<const IndexEntry> GetIndex() const;
+        void Unmap();
+
+    private:
+        const std::byte* fView = nullptr;
+        size_t fSize = 0;
+#if defined(_WIN32)
+        void* fFile = nullptr;
+        void* fMapping = nullptr;
+#endif
+    };
+}
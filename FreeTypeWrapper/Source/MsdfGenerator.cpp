@@ -0,0 +1,727 @@
+// The edge coloring, the contour combining distance selection and the channel median follow msdfgen by Viktor Chlumsky,
+// https://github.com/Chlumsky/msdfgen, MIT license. See ThirdPartyNotices.txt.
+#include "MsdfGenerator.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <span>
+#include <utility>
+#include <LLUtils/Warnings.h>
+
+namespace FreeType
+{
+    namespace
+    {
+        using Point = MsdfGenerator::Point;
+        using Edge = MsdfGenerator::Edge;
+        using EdgeColor = MsdfGenerator::EdgeColor;
+
+        Point operator+(Point a, Point b) { return { a.x + b.x, a.y + b.y }; }
+        Point operator-(Point a, Point b) { return { a.x - b.x, a.y - b.y }; }
+        Point operator*(double scalar, Point a) { return { scalar * a.x, scalar * a.y }; }
+        double Dot(Point a, Point b) { return a.x * b.x + a.y * b.y; }
+        double Cross(Point a, Point b) { return a.x * b.y - a.y * b.x; }
+        double Length(Point a) { return std::sqrt(Dot(a, a)); }
+        Point Mix(Point a, Point b, double t) { return a + t * (b - a); }
+        double NonZeroSign(double value) { return value > 0 ? 1.0 : -1.0; }
+
+        Point Normalize(Point a)
+        {
+            const double length = Length(a);
+            return length == 0 ? Point{ 0, 1 } : Point{ a.x / length, a.y / length };
+        }
+
+        // Distance to an edge, ties between edges sharing an end point are broken by how orthogonal the edge is to the
+        // direction of the point, the edge whose extension passes closer wins.
+        struct SignedDistance
+        {
+            double distance = -std::numeric_limits<double>::max();
+            double dot = 1;
+
+            bool operator<(const SignedDistance& other) const
+            {
+                return std::abs(distance) < std::abs(other.distance) || (std::abs(distance) == std::abs(other.distance) && dot < other.dot);
+            }
+        };
+
+        int SolveQuadratic(double roots[2], double a, double b, double c)
+        {
+            if (a == 0 || std::abs(b) > 1e12 * std::abs(a))
+            {
+                if (b == 0)
+                    return c == 0 ? -1 : 0;
+                roots[0] = -c / b;
+                return 1;
+            }
+
+            double discriminant = b * b - 4 * a * c;
+            if (discriminant > 0)
+            {
+                discriminant = std::sqrt(discriminant);
+                roots[0] = (-b + discriminant) / (2 * a);
+                roots[1] = (-b - discriminant) / (2 * a);
+                return 2;
+            }
+            if (discriminant == 0)
+            {
+                roots[0] = -b / (2 * a);
+                return 1;
+            }
+            return 0;
+        }
+
+        // Roots of x^3 + a x^2 + b x + c.
+        int SolveCubicNormed(double roots[3], double a, double b, double c)
+        {
+            const double a2 = a * a;
+            double q = (a2 - 3 * b) / 9;
+            const double r = (a * (2 * a2 - 9 * b) + 27 * c) / 54;
+            const double r2 = r * r;
+            const double q3 = q * q * q;
+            a /= 3;
+
+            if (r2 < q3)
+            {
+                const double t = std::acos(std::clamp(r / std::sqrt(q3), -1.0, 1.0));
+                q = -2 * std::sqrt(q);
+                roots[0] = q * std::cos(t / 3) - a;
+                roots[1] = q * std::cos((t + 2 * std::numbers::pi) / 3) - a;
+                roots[2] = q * std::cos((t - 2 * std::numbers::pi) / 3) - a;
+                return 3;
+            }
+
+            const double u = (r < 0 ? 1 : -1) * std::cbrt(std::abs(r) + std::sqrt(r2 - q3));
+            const double v = u == 0 ? 0 : q / u;
+            roots[0] = (u + v) - a;
+            if (u == v || std::abs(u - v) < 1e-12 * std::abs(u + v))
+            {
+                roots[1] = -0.5 * (u + v) - a;
+                return 2;
+            }
+            return 1;
+        }
+
+        int SolveCubic(double roots[3], double a, double b, double c, double d)
+        {
+            if (a != 0)
+            {
+                const double normalizedB = b / a;
+                // Near quadratic cubics are solved as quadratics, the normed form loses all precision.
+                if (std::abs(normalizedB) < 1e6)
+                    return SolveCubicNormed(roots, normalizedB, c / a, d / a);
+            }
+            return SolveQuadratic(roots, b, c, d);
+        }
+
+        const Point& EndPoint(const Edge& edge) { return edge.points[edge.degree]; }
+
+        Point PointAt(const Edge& edge, double t)
+        {
+            const auto& p = edge.points;
+            switch (edge.degree)
+            {
+            case 1:
+                return Mix(p[0], p[1], t);
+            case 2:
+                return Mix(Mix(p[0], p[1], t), Mix(p[1], p[2], t), t);
+            default:
+            {
+                const Point p12 = Mix(p[1], p[2], t);
+                return Mix(Mix(Mix(p[0], p[1], t), p12, t), Mix(p12, Mix(p[2], p[3], t), t), t);
+            }
+            }
+        }
+
+        Point DirectionAt(const Edge& edge, double t)
+        {
+            const auto& p = edge.points;
+            switch (edge.degree)
+            {
+            case 1:
+                return p[1] - p[0];
+            case 2:
+            {
+                const Point tangent = Mix(p[1] - p[0], p[2] - p[1], t);
+                return tangent.x == 0 && tangent.y == 0 ? p[2] - p[0] : tangent;
+            }
+            default:
+            {
+                const Point tangent = Mix(Mix(p[1] - p[0], p[2] - p[1], t), Mix(p[2] - p[1], p[3] - p[2], t), t);
+                if (tangent.x == 0 && tangent.y == 0)
+                {
+                    // Control point on an end point, the curve leaves towards the other control point.
+                    if (t == 0)
+                        return p[2] - p[0];
+                    if (t == 1)
+                        return p[3] - p[1];
+                }
+                return tangent;
+            }
+            }
+        }
+
+        std::pair<Edge, Edge> Split(const Edge& edge, double t)
+        {
+            const auto& p = edge.points;
+            Edge first = edge;
+            Edge second = edge;
+            switch (edge.degree)
+            {
+            case 1:
+            {
+                const Point middle = Mix(p[0], p[1], t);
+                first.points = { p[0], middle };
+                second.points = { middle, p[1] };
+                break;
+            }
+            case 2:
+            {
+                const Point a = Mix(p[0], p[1], t);
+                const Point b = Mix(p[1], p[2], t);
+                const Point middle = Mix(a, b, t);
+                first.points = { p[0], a, middle };
+                second.points = { middle, b, p[2] };
+                break;
+            }
+            default:
+            {
+                const Point a = Mix(p[0], p[1], t);
+                const Point b = Mix(p[1], p[2], t);
+                const Point c = Mix(p[2], p[3], t);
+                const Point ab = Mix(a, b, t);
+                const Point bc = Mix(b, c, t);
+                const Point middle = Mix(ab, bc, t);
+                first.points = { p[0], a, ab, middle };
+                second.points = { middle, bc, c, p[3] };
+                break;
+            }
+            }
+            return { first, second };
+        }
+
+        SignedDistance EdgeDistance(const Edge& edge, Point origin, double& param)
+        {
+            const auto& p = edge.points;
+            const Point qa = p[0] - origin;
+
+            if (edge.degree == 1)
+            {
+                const Point ab = p[1] - p[0];
+                const Point aq = origin - p[0];
+                param = Dot(aq, ab) / Dot(ab, ab);
+                const Point eq = (param > 0.5 ? p[1] : p[0]) - origin;
+                const double endpointDistance = Length(eq);
+                if (param > 0 && param < 1)
+                {
+                    const Point normal = Normalize({ ab.y, -ab.x });
+                    const double orthoDistance = Dot(normal, aq);
+                    if (std::abs(orthoDistance) < endpointDistance)
+                        return { orthoDistance, 0 };
+                }
+                return { NonZeroSign(Cross(aq, ab)) * endpointDistance, std::abs(Dot(Normalize(ab), Normalize(eq))) };
+            }
+
+            // Closest of the end points and the stationary points of the squared distance.
+            Point direction = DirectionAt(edge, 0);
+            double minDistance = NonZeroSign(Cross(direction, qa)) * Length(qa);
+            param = -Dot(qa, direction) / Dot(direction, direction);
+            {
+                direction = DirectionAt(edge, 1);
+                const Point eq = EndPoint(edge) - origin;
+                const double distance = Length(eq);
+                if (distance < std::abs(minDistance))
+                {
+                    minDistance = NonZeroSign(Cross(direction, eq)) * distance;
+                    param = Dot(origin - EndPoint(edge) + direction, direction) / Dot(direction, direction);
+                }
+            }
+
+            if (edge.degree == 2)
+            {
+                const Point ab = p[1] - p[0];
+                const Point br = p[2] - p[1] - ab;
+                double roots[3];
+                const int count = SolveCubic(roots, Dot(br, br), 3 * Dot(ab, br), 2 * Dot(ab, ab) + Dot(qa, br), Dot(qa, ab));
+                for (int i = 0; i < count; i++)
+                {
+                    const double t = roots[i];
+                    if (t > 0 && t < 1)
+                    {
+                        const Point qe = qa + 2 * t * ab + t * t * br;
+                        const double distance = Length(qe);
+                        if (distance <= std::abs(minDistance))
+                        {
+                            minDistance = NonZeroSign(Cross(ab + t * br, qe)) * distance;
+                            param = t;
+                        }
+                    }
+                }
+            }
+            else
+            {
+                // No closed form for cubics, Newton iterations from a few starting points.
+                constexpr int SearchStarts = 4;
+                constexpr int SearchSteps = 4;
+                const Point ab = p[1] - p[0];
+                const Point br = p[2] - p[1] - ab;
+                const Point as = (p[3] - p[2]) - (p[2] - p[1]) - br;
+                for (int i = 0; i <= SearchStarts; i++)
+                {
+                    double t = static_cast<double>(i) / SearchStarts;
+                    Point qe = qa + 3 * t * ab + 3 * t * t * br + t * t * t * as;
+                    for (int step = 0; step < SearchSteps; step++)
+                    {
+                        const Point d1 = 3 * ab + 6 * t * br + 3 * t * t * as;
+                        const Point d2 = 6 * br + 6 * t * as;
+                        t -= Dot(qe, d1) / (Dot(d1, d1) + Dot(qe, d2));
+                        if (t <= 0 || t >= 1)
+                            break;
+                        qe = qa + 3 * t * ab + 3 * t * t * br + t * t * t * as;
+                        const double distance = Length(qe);
+                        if (distance < std::abs(minDistance))
+                        {
+                            minDistance = NonZeroSign(Cross(DirectionAt(edge, t), qe)) * distance;
+                            param = t;
+                        }
+                    }
+                }
+            }
+
+            if (param >= 0 && param <= 1)
+                return { minDistance, 0 };
+            if (param < 0.5)
+                return { minDistance, std::abs(Dot(Normalize(DirectionAt(edge, 0)), Normalize(qa))) };
+            return { minDistance, std::abs(Dot(Normalize(DirectionAt(edge, 1)), Normalize(EndPoint(edge) - origin))) };
+        }
+
+        // Past its end points an edge is extended along its tangent, so that both edges at a corner keep their straight
+        // distance gradient up to the corner's bisector.
+        double PseudoDistance(const Edge& edge, Point origin, SignedDistance distance, double param)
+        {
+            if (param < 0)
+            {
+                const Point direction = Normalize(DirectionAt(edge, 0));
+                const Point aq = origin - edge.points[0];
+                if (Dot(aq, direction) < 0)
+                {
+                    const double pseudoDistance = Cross(aq, direction);
+                    if (std::abs(pseudoDistance) <= std::abs(distance.distance))
+                        return pseudoDistance;
+                }
+            }
+            else if (param > 1)
+            {
+                const Point direction = Normalize(DirectionAt(edge, 1));
+                const Point bq = origin - EndPoint(edge);
+                if (Dot(bq, direction) > 0)
+                {
+                    const double pseudoDistance = Cross(bq, direction);
+                    if (std::abs(pseudoDistance) <= std::abs(distance.distance))
+                        return pseudoDistance;
+                }
+            }
+            return distance.distance;
+        }
+
+        // Nonzero winding contribution of an edge for a ray from origin towards positive x.
+        int Winding(const Edge& edge, Point origin)
+        {
+            const auto& p = edge.points;
+            if (edge.degree == 1)
+            {
+                if ((p[0].y <= origin.y) == (p[1].y <= origin.y))
+                    return 0;
+                const double x = p[0].x + (origin.y - p[0].y) / (p[1].y - p[0].y) * (p[1].x - p[0].x);
+                return x > origin.x ? (p[1].y > p[0].y ? 1 : -1) : 0;
+            }
+
+            double roots[3];
+            int count;
+            if (edge.degree == 2)
+                count = SolveQuadratic(roots, p[0].y - 2 * p[1].y + p[2].y, 2 * (p[1].y - p[0].y), p[0].y - origin.y);
+            else
+                count = SolveCubic(roots, -p[0].y + 3 * p[1].y - 3 * p[2].y + p[3].y, 3 * (p[0].y - 2 * p[1].y + p[2].y)
+                    , 3 * (p[1].y - p[0].y), p[0].y - origin.y);
+
+            int winding = 0;
+            for (int i = 0; i < count; i++)
+            {
+                // Half open so that a crossing at a shared end point counts once.
+                const double t = roots[i];
+                if (t < 0 || t >= 1 || PointAt(edge, t).x <= origin.x)
+                    continue;
+                const double dy = DirectionAt(edge, t).y;
+                winding += dy > 0 ? 1 : dy < 0 ? -1 : 0;
+            }
+            return winding;
+        }
+
+        using Distances = MsdfGenerator::Distances;
+
+        double Median(const Distances& distances)
+        {
+            return std::max(std::min(distances[0], distances[1]), std::min(std::max(distances[0], distances[1]), distances[2]));
+        }
+
+        // Nearest edge of each channel and the nearest edge of any color.
+        struct NearestEdges
+        {
+            struct Channel
+            {
+                SignedDistance distance;
+                const Edge* edge = nullptr;
+                double param = 0;
+            };
+
+            Channel channels[3];
+            SignedDistance trueDistance;
+
+            void Add(const Edge& edge, SignedDistance distance, double param)
+            {
+                if (distance < trueDistance)
+                    trueDistance = distance;
+                for (int channel = 0; channel < 3; channel++)
+                {
+                    if ((edge.color & (1 << channel)) != 0 && distance < channels[channel].distance)
+                        channels[channel] = { distance, &edge, param };
+                }
+            }
+
+            Distances Resolve(Point origin) const
+            {
+                Distances distances;
+                for (int channel = 0; channel < 3; channel++)
+                {
+                    const Channel& nearest = channels[channel];
+                    distances[channel] = nearest.edge != nullptr
+                        ? PseudoDistance(*nearest.edge, origin, nearest.distance, nearest.param) : nearest.distance.distance;
+                }
+                distances[3] = trueDistance.distance;
+                return distances;
+            }
+        };
+
+        int ContourWinding(const MsdfGenerator::Contour& contour)
+        {
+            // Twice the signed area of a polygon through points of the edges, clockwise is positive.
+            const auto shoelace = [](Point a, Point b) { return (b.x - a.x) * (a.y + b.y); };
+            double total = 0;
+            if (contour.size() == 1)
+            {
+                const Point a = PointAt(contour[0], 0);
+                const Point b = PointAt(contour[0], 1.0 / 3.0);
+                const Point c = PointAt(contour[0], 2.0 / 3.0);
+                total = shoelace(a, b) + shoelace(b, c) + shoelace(c, a);
+            }
+            else if (contour.size() == 2)
+            {
+                const Point a = PointAt(contour[0], 0);
+                const Point b = PointAt(contour[0], 0.5);
+                const Point c = PointAt(contour[1], 0);
+                const Point d = PointAt(contour[1], 0.5);
+                total = shoelace(a, b) + shoelace(b, c) + shoelace(c, d) + shoelace(d, a);
+            }
+            else
+            {
+                Point previous = contour.back().points[0];
+                for (const Edge& edge : contour)
+                {
+                    total += shoelace(previous, edge.points[0]);
+                    previous = edge.points[0];
+                }
+            }
+            return total > 0 ? 1 : total < 0 ? -1 : 0;
+        }
+
+        // Distances of overlapping contours, taken from the contours that actually bound the fill around the point rather
+        // than from edges buried inside other contours.
+        Distances CombineContours(size_t contourCount, std::span<const MsdfGenerator::ContourDistance> contours, const Distances& shapeDistances)
+        {
+            constexpr double infinity = std::numeric_limits<double>::max();
+            Distances inner{ -infinity, -infinity, -infinity, -infinity };
+            Distances outer{ -infinity, -infinity, -infinity, -infinity };
+            double innerScalar = -infinity;
+            double outerScalar = -infinity;
+
+            for (size_t i = 0; i < contourCount; i++)
+            {
+                const double median = Median(contours[i].distances);
+                if (contours[i].winding > 0 && median >= 0 && std::abs(median) < std::abs(innerScalar))
+                {
+                    inner = contours[i].distances;
+                    innerScalar = median;
+                }
+                if (contours[i].winding < 0 && median <= 0 && std::abs(median) < std::abs(outerScalar))
+                {
+                    outer = contours[i].distances;
+                    outerScalar = median;
+                }
+            }
+
+            Distances distances;
+            int winding;
+            if (innerScalar >= 0 && std::abs(innerScalar) <= std::abs(outerScalar))
+            {
+                distances = inner;
+                winding = 1;
+                for (size_t i = 0; i < contourCount; i++)
+                {
+                    const double median = Median(contours[i].distances);
+                    if (contours[i].winding > 0 && std::abs(median) < std::abs(outerScalar) && median > Median(distances))
+                        distances = contours[i].distances;
+                }
+            }
+            else if (outerScalar <= 0 && std::abs(outerScalar) < std::abs(innerScalar))
+            {
+                distances = outer;
+                winding = -1;
+                for (size_t i = 0; i < contourCount; i++)
+                {
+                    const double median = Median(contours[i].distances);
+                    if (contours[i].winding < 0 && std::abs(median) < std::abs(innerScalar) && median < Median(distances))
+                        distances = contours[i].distances;
+                }
+            }
+            else
+            {
+                return shapeDistances;
+            }
+
+            for (size_t i = 0; i < contourCount; i++)
+            {
+                const double median = Median(contours[i].distances);
+                if (contours[i].winding != winding && median * Median(distances) >= 0 && std::abs(median) < std::abs(Median(distances)))
+                    distances = contours[i].distances;
+            }
+
+            return Median(distances) == Median(shapeDistances) ? shapeDistances : distances;
+        }
+
+        // Next of the two-channel colors, the same sequence for the same shape.
+        EdgeColor SwitchColor(EdgeColor color, uint64_t& seed, EdgeColor banned = EdgeColor::Black)
+        {
+            const auto combined = static_cast<EdgeColor>(color & banned);
+            if (combined == EdgeColor::Red || combined == EdgeColor::Green || combined == EdgeColor::Blue)
+                return static_cast<EdgeColor>(combined ^ EdgeColor::White);
+
+            if (color == EdgeColor::Black || color == EdgeColor::White)
+            {
+                constexpr EdgeColor start[3] = { EdgeColor::Cyan, EdgeColor::Magenta, EdgeColor::Yellow };
+                const EdgeColor next = start[seed % 3];
+                seed /= 3;
+                return next;
+            }
+
+            const int shifted = color << (1 + (seed & 1));
+            seed >>= 1;
+            return static_cast<EdgeColor>((shifted | shifted >> 3) & EdgeColor::White);
+        }
+    }
+
+    MsdfGenerator::Shape MsdfGenerator::LoadShape(const FT_Outline& outline, double scale, std::pmr::memory_resource* memoryResource)
+    {
+        struct Context
+        {
+            Shape* shape;
+            double scale;
+            Point position;
+
+            Point ToPoint(const FT_Vector* vector) const { return { static_cast<double>(vector->x) * scale, static_cast<double>(vector->y) * scale }; }
+
+            void AddEdge(Edge edge)
+            {
+                edge.points[0] = position;
+                position = edge.points[edge.degree];
+                // Zero length edges have no direction.
+                const auto begin = edge.points.begin();
+                const auto end = begin + edge.degree + 1;
+                if (std::any_of(begin + 1, end, [&](const Point& point) { return point.x != edge.points[0].x || point.y != edge.points[0].y; }))
+                    shape->back().push_back(edge);
+            }
+        };
+
+        FT_Outline_Funcs functions{};
+        functions.move_to = [](const FT_Vector* to, void* user) -> int
+        {
+            auto& context = *static_cast<Context*>(user);
+            context.shape->emplace_back();
+            context.position = context.ToPoint(to);
+            return 0;
+        };
+        functions.line_to = [](const FT_Vector* to, void* user) -> int
+        {
+            auto& context = *static_cast<Context*>(user);
+            context.AddEdge({ { Point{}, context.ToPoint(to) }, 1, EdgeColor::White });
+            return 0;
+        };
+        functions.conic_to = [](const FT_Vector* control, const FT_Vector* to, void* user) -> int
+        {
+            auto& context = *static_cast<Context*>(user);
+            context.AddEdge({ { Point{}, context.ToPoint(control), context.ToPoint(to) }, 2, EdgeColor::White });
+            return 0;
+        };
+        functions.cubic_to = [](const FT_Vector* control1, const FT_Vector* control2, const FT_Vector* to, void* user) -> int
+        {
+            auto& context = *static_cast<Context*>(user);
+            context.AddEdge({ { Point{}, context.ToPoint(control1), context.ToPoint(control2), context.ToPoint(to) }, 3, EdgeColor::White });
+            return 0;
+        };
+
+        Shape shape(memoryResource);
+        Context context{ &shape, scale, {} };
+        FT_Outline_Decompose(const_cast<FT_Outline*>(&outline), &functions, &context);
+        std::erase_if(shape, [](const Contour& contour) { return contour.empty(); });
+
+        // Distances come out positive inside for TrueType orientation, PostScript contours run the other way.
+        if (FT_Outline_Get_Orientation(const_cast<FT_Outline*>(&outline)) == FT_ORIENTATION_POSTSCRIPT)
+        {
+            for (Contour& contour : shape)
+            {
+                std::reverse(contour.begin(), contour.end());
+                for (Edge& edge : contour)
+                    std::reverse(edge.points.begin(), edge.points.begin() + edge.degree + 1);
+            }
+        }
+
+        return shape;
+    }
+
+    void MsdfGenerator::ColorEdges(Shape& shape, double angleThreshold)
+    {
+        const double crossThreshold = std::sin(angleThreshold);
+        uint64_t seed = 0;
+
+        for (Contour& contour : shape)
+        {
+            std::pmr::vector<size_t> corners(contour.get_allocator());
+            Point previousDirection = DirectionAt(contour.back(), 1);
+            for (size_t i = 0; i < contour.size(); i++)
+            {
+                const Point a = Normalize(previousDirection);
+                const Point b = Normalize(DirectionAt(contour[i], 0));
+                if (Dot(a, b) <= 0 || std::abs(Cross(a, b)) > crossThreshold)
+                    corners.push_back(i);
+                previousDirection = DirectionAt(contour[i], 1);
+            }
+
+            if (corners.empty())
+            {
+                // Smooth contour, a single channel field is exact.
+                for (Edge& edge : contour)
+                    edge.color = EdgeColor::White;
+            }
+            else if (corners.size() == 1)
+            {
+                // A teardrop, the contour is split into three spans so that the corner is still formed by two colors.
+                const EdgeColor first = SwitchColor(EdgeColor::White, seed);
+                const EdgeColor colors[3] = { first, EdgeColor::White, SwitchColor(first, seed) };
+                const size_t corner = corners.front();
+                const size_t count = contour.size();
+
+                if (count >= 3)
+                {
+                    for (size_t i = 0; i < count; i++)
+                    {
+                        const double position = 3.0 + 2.875 * static_cast<double>(i) / static_cast<double>(count - 1) - 1.4375 + 0.5;
+                        contour[(corner + i) % count].color = colors[static_cast<int>(position) - 2];
+                    }
+                }
+                else
+                {
+                    // One or two edges, split each into thirds starting at the corner.
+                    Contour parts(contour.get_allocator());
+                    for (size_t i = 0; i < count; i++)
+                    {
+                        const Edge& edge = contour[(corner + i) % count];
+                        const auto [third, rest] = Split(edge, 1.0 / 3.0);
+                        const auto [secondThird, lastThird] = Split(rest, 0.5);
+                        parts.insert(parts.end(), { third, secondThird, lastThird });
+                    }
+
+                    for (size_t i = 0; i < parts.size(); i++)
+                        parts[i].color = colors[i * 3 / parts.size()];
+                    contour = std::move(parts);
+                }
+            }
+            else
+            {
+                // Alternate colors between corners, the last span must not share a channel set with the first.
+                const size_t cornerCount = corners.size();
+                const size_t start = corners.front();
+                const size_t count = contour.size();
+                size_t spline = 0;
+                EdgeColor color = SwitchColor(EdgeColor::White, seed);
+                const EdgeColor initialColor = color;
+                for (size_t i = 0; i < count; i++)
+                {
+                    const size_t index = (start + i) % count;
+                    if (spline + 1 < cornerCount && corners[spline + 1] == index)
+                    {
+                        spline++;
+                        color = SwitchColor(color, seed, spline == cornerCount - 1 ? initialColor : EdgeColor::Black);
+                    }
+                    contour[index].color = color;
+                }
+            }
+        }
+    }
+
+    LLUTILS_DISABLE_WARNING_PUSH
+    LLUTILS_DISABLE_WARNING_UNSAFE_BUFFER_USAGE
+    void MsdfGenerator::GenerateField(const Shape& shape, double left, double top, uint32_t width, uint32_t height, double range
+        , uint8_t* dest, size_t rowPitch, std::span<ContourDistance> scratch)
+    {
+        const auto encode = [range](double distance)
+        {
+            return static_cast<uint8_t>(std::clamp(distance / range + 0.5, 0.0, 1.0) * 255.0 + 0.5);
+        };
+
+        // Orientation of each contour, positive for contours that add to the fill.
+        for (size_t i = 0; i < shape.size(); i++)
+            scratch[i].winding = ContourWinding(shape[i]);
+
+        for (uint32_t y = 0; y < height; y++)
+        {
+            uint8_t* row = dest + y * rowPitch;
+            for (uint32_t x = 0; x < width; x++)
+            {
+                const Point origin{ left + x + 0.5, top - y - 0.5 };
+                Distances shapeDistances;
+                NearestEdges shapeNearest;
+                int winding = 0;
+
+                for (size_t i = 0; i < shape.size(); i++)
+                {
+                    NearestEdges contourNearest;
+                    for (const Edge& edge : shape[i])
+                    {
+                        double param;
+                        const SignedDistance distance = EdgeDistance(edge, origin, param);
+                        contourNearest.Add(edge, distance, param);
+                        shapeNearest.Add(edge, distance, param);
+                        winding += Winding(edge, origin);
+                    }
+                    scratch[i].distances = contourNearest.Resolve(origin);
+                }
+                shapeDistances = shapeNearest.Resolve(origin);
+
+                Distances distances = CombineContours(shape.size(), scratch, shapeDistances);
+
+                // The edge distances only know which side of their own edge a point is on, overlapping contours and
+                // shape errors can still flip the median. The fill rule decides, those pixels fall back to the true distance.
+                const bool inside = winding != 0;
+                const double trueDistance = inside ? std::abs(distances[3]) : -std::abs(distances[3]);
+                if ((Median(distances) > 0) != inside)
+                    std::fill(distances.begin(), distances.begin() + 3, trueDistance);
+
+                uint8_t* pixel = row + x * 4;
+                pixel[0] = encode(distances[0]);
+                pixel[1] = encode(distances[1]);
+                pixel[2] = encode(distances[2]);
+                pixel[3] = encode(trueDistance);
+            }
+        }
+    }
+    LLUTILS_DISABLE_WARNING_POP
+}
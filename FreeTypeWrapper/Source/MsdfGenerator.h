@@ -0,0 +1,70 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <vector>
+#include <FreeTypeHeaders.h>
+
+namespace FreeType
+{
+    // Multi-channel signed distance fields of glyph outlines. Edges are colored so that the two edges meeting at a corner
+    // never share all channels, the median of the three channels then reconstructs the corner sharply at any scale.
+    // Generation is a pure function of the shape, fields of different glyphs may be generated on different threads.
+    // Derived from msdfgen, MIT license, see ThirdPartyNotices.txt.
+    class MsdfGenerator
+    {
+    public:
+        struct Point
+        {
+            double x;
+            double y;
+        };
+
+        // Channels an edge contributes to, one bit per channel, red in the lowest bit.
+        enum EdgeColor : uint8_t
+        {
+              Black     = 0
+            , Red       = 1
+            , Green     = 2
+            , Yellow    = Red | Green
+            , Blue      = 4
+            , Magenta   = Red | Blue
+            , Cyan      = Green | Blue
+            , White     = Red | Green | Blue
+        };
+
+        // A line, quadratic or cubic Bezier segment.
+        struct Edge
+        {
+            std::array<Point, 4> points;
+            uint8_t degree;
+            EdgeColor color;
+        };
+
+        using Contour = std::pmr::vector<Edge>;
+        using Shape = std::pmr::vector<Contour>;
+
+        // Red, green, blue and true distance.
+        using Distances = std::array<double, 4>;
+
+        // Working memory of GenerateField, one for each contour of the shape.
+        struct ContourDistance
+        {
+            Distances distances;
+            int winding;
+        };
+
+        // Edges of a glyph outline scaled by 'scale', y up, oriented so that distances are positive inside the glyph.
+        static Shape LoadShape(const FT_Outline& outline, double scale, std::pmr::memory_resource* memoryResource);
+
+        // Colors the edges of each contour, a corner is where the direction turns by more than angleThreshold radians.
+        static void ColorEdges(Shape& shape, double angleThreshold = 3.0);
+
+        // Writes a width x height RGBA field, left / top are the shape coordinates of the field's top left corner.
+        // Red, green and blue hold the multi-channel distance, alpha the true distance, both mapped from
+        // [-range / 2, range / 2] to [0, 255]. Doesn't allocate, scratch must hold an entry per contour.
+        static void GenerateField(const Shape& shape, double left, double top, uint32_t width, uint32_t height, double range
+            , uint8_t* dest, size_t rowPitch, std::span<ContourDistance> scratch);
+    };
+}
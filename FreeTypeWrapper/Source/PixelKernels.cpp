@@ -0,0 +1,270 @@
+#include "PixelKernels.h"
+#include "GammaTables.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define FREETYPE_WRAPPER_HAS_SSE2 1
+    #include <emmintrin.h>
+#else
+    #define FREETYPE_WRAPPER_HAS_SSE2 0
+#endif
+
+namespace FreeType::PixelKernels
+{
+    void LcdToRGBAScalar(const uint8_t* source, uint32_t numPixels, LLUtils::Color textColor, LLUtils::Color* dest)
+    {
+        for (uint32_t i = 0; i < numPixels; i++)
+        {
+            const uint8_t BC = source[i * 3 + 0];
+            const uint8_t GC = source[i * 3 + 1];
+            const uint8_t RC = source[i * 3 + 2];
+            const uint8_t AC = static_cast<uint8_t>((static_cast<int>(RC) + static_cast<int>(GC) + static_cast<int>(BC)) / 3);
+            const uint8_t INVAC = static_cast<uint8_t>(255 - AC);
+
+            dest[i] =
+            {
+                  static_cast<uint8_t>((textColor.R() * AC + BC * INVAC) / 0xFF)
+                , static_cast<uint8_t>((textColor.G() * AC + GC * INVAC) / 0xFF)
+                , static_cast<uint8_t>((textColor.B() * AC + RC * INVAC) / 0xFF)
+                , AC
+            };
+        }
+    }
+
+#if FREETYPE_WRAPPER_HAS_SSE2
+    namespace
+    {
+        // Splits 96 bytes of interleaved 3 channel data (32 pixels) into 6 planes, two registers per channel.
+        // Five rounds of byte interleaving act as a transpose, using SSE2 only.
+        inline void Deinterleave3(__m128i (&v)[6])
+        {
+            for (int round = 0; round < 5; round++)
+            {
+                const __m128i r0 = _mm_unpacklo_epi8(v[0], v[3]);
+                const __m128i r1 = _mm_unpackhi_epi8(v[0], v[3]);
+                const __m128i r2 = _mm_unpacklo_epi8(v[1], v[4]);
+                const __m128i r3 = _mm_unpackhi_epi8(v[1], v[4]);
+                const __m128i r4 = _mm_unpacklo_epi8(v[2], v[5]);
+                const __m128i r5 = _mm_unpackhi_epi8(v[2], v[5]);
+                v[0] = r0; v[1] = r1; v[2] = r2; v[3] = r3; v[4] = r4; v[5] = r5;
+            }
+        }
+
+        // Exact x / 255 for 0 <= x <= 255 * 255.
+        inline __m128i DivideBy255(__m128i x)
+        {
+            return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)), _mm_srli_epi16(x, 8)), 8);
+        }
+
+        // 8 pixels with 16 bit channels.
+        inline void LcdToRGBA8(__m128i b, __m128i g, __m128i r, __m128i textR, __m128i textG, __m128i textB
+            , __m128i& outR, __m128i& outG, __m128i& outB, __m128i& outA)
+        {
+            // Exact x / 3 for x <= 765.
+            const __m128i average = _mm_mulhi_epu16(_mm_add_epi16(_mm_add_epi16(b, g), r), _mm_set1_epi16(21846));
+            const __m128i inverse = _mm_sub_epi16(_mm_set1_epi16(255), average);
+
+            outR = DivideBy255(_mm_add_epi16(_mm_mullo_epi16(textR, average), _mm_mullo_epi16(b, inverse)));
+            outG = DivideBy255(_mm_add_epi16(_mm_mullo_epi16(textG, average), _mm_mullo_epi16(g, inverse)));
+            outB = DivideBy255(_mm_add_epi16(_mm_mullo_epi16(textB, average), _mm_mullo_epi16(r, inverse)));
+            outA = average;
+        }
+
+        // Stores the first count of 16 pixels held as 4 registers of RGBA, count may be less than 16 at the end of a run.
+        inline void StorePixels(const __m128i (&pixels)[4], uint32_t count, LLUtils::Color* dest)
+        {
+            __m128i* destVector = reinterpret_cast<__m128i*>(dest);
+            uint32_t vector = 0;
+            for (; vector < 4 && count >= 4; vector++, count -= 4)
+                _mm_storeu_si128(destVector + vector, pixels[vector]);
+
+            if (vector == 4 || count == 0)
+                return;
+
+            __m128i last = pixels[vector];
+            LLUtils::Color* destPixel = dest + vector * 4;
+            if (count >= 2)
+            {
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(destPixel), last);
+                last = _mm_srli_si128(last, 8);
+                destPixel += 2;
+                count -= 2;
+            }
+            if (count == 1)
+            {
+                const int pixel = _mm_cvtsi128_si32(last);
+                std::memcpy(static_cast<void*>(destPixel), &pixel, sizeof(pixel));
+            }
+        }
+
+        // 16 pixels, one plane register per channel, the first count of them written as RGBA.
+        inline void LcdToRGBA16(__m128i b, __m128i g, __m128i r, __m128i textR, __m128i textG, __m128i textB, uint32_t count, LLUtils::Color* dest)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            __m128i loR, loG, loB, loA, hiR, hiG, hiB, hiA;
+            LcdToRGBA8(_mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(g, zero), _mm_unpacklo_epi8(r, zero), textR, textG, textB, loR, loG, loB, loA);
+            LcdToRGBA8(_mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(g, zero), _mm_unpackhi_epi8(r, zero), textR, textG, textB, hiR, hiG, hiB, hiA);
+
+            const __m128i red = _mm_packus_epi16(loR, hiR);
+            const __m128i green = _mm_packus_epi16(loG, hiG);
+            const __m128i blue = _mm_packus_epi16(loB, hiB);
+            const __m128i alpha = _mm_packus_epi16(loA, hiA);
+
+            const __m128i redGreenLo = _mm_unpacklo_epi8(red, green);
+            const __m128i redGreenHi = _mm_unpackhi_epi8(red, green);
+            const __m128i blueAlphaLo = _mm_unpacklo_epi8(blue, alpha);
+            const __m128i blueAlphaHi = _mm_unpackhi_epi8(blue, alpha);
+
+            const __m128i pixels[4] =
+            {
+                  _mm_unpacklo_epi16(redGreenLo, blueAlphaLo)
+                , _mm_unpackhi_epi16(redGreenLo, blueAlphaLo)
+                , _mm_unpacklo_epi16(redGreenHi, blueAlphaHi)
+                , _mm_unpackhi_epi16(redGreenHi, blueAlphaHi)
+            };
+            StorePixels(pixels, count, dest);
+        }
+
+        // 32 pixels from 96 bytes of packed subpixels, the first count of them written to dest.
+        inline void LcdToRGBA32(const uint8_t* source, __m128i textR, __m128i textG, __m128i textB, uint32_t count, LLUtils::Color* dest)
+        {
+            const __m128i* sourceVector = reinterpret_cast<const __m128i*>(source);
+            __m128i v[6];
+            for (int i = 0; i < 6; i++)
+                v[i] = _mm_loadu_si128(sourceVector + i);
+
+            Deinterleave3(v);
+
+            // Planes: v[0], v[1] first subpixel, v[2], v[3] second subpixel, v[4], v[5] third subpixel.
+            LcdToRGBA16(v[0], v[2], v[4], textR, textG, textB, std::min(count, 16u), dest);
+            if (count > 16)
+                LcdToRGBA16(v[1], v[3], v[5], textR, textG, textB, count - 16, dest + 16);
+        }
+    }
+
+    void LcdToRGBASSE2(const uint8_t* source, uint32_t numPixels, LLUtils::Color textColor, LLUtils::Color* dest)
+    {
+        constexpr uint32_t PixelsPerBlock = 32;
+        const __m128i textR = _mm_set1_epi16(textColor.R());
+        const __m128i textG = _mm_set1_epi16(textColor.G());
+        const __m128i textB = _mm_set1_epi16(textColor.B());
+
+        uint32_t i = 0;
+        for (; i + PixelsPerBlock <= numPixels; i += PixelsPerBlock)
+            LcdToRGBA32(source + i * 3, textR, textG, textB, PixelsPerBlock, dest + i);
+
+        // The remaining pixels are read from a zero padded block and only they are written, small glyphs often fit in a
+        // single block.
+        if (const uint32_t remaining = numPixels - i; remaining > 0)
+        {
+            alignas(16) uint8_t sourceBlock[PixelsPerBlock * 3] = {};
+            std::memcpy(sourceBlock, source + i * 3, remaining * 3);
+            LcdToRGBA32(sourceBlock, textR, textG, textB, remaining, dest + i);
+        }
+    }
+
+#else
+    void LcdToRGBASSE2(const uint8_t* source, uint32_t numPixels, LLUtils::Color textColor, LLUtils::Color* dest)
+    {
+        LcdToRGBAScalar(source, numPixels, textColor, dest);
+    }
+#endif
+
+    void ExpandLcd(LLUtils::ColorF32* dest, const uint8_t* source, uint32_t numPixels, LLUtils::Color textColor, bool linearBlending)
+    {
+        using LLUtils::ColorF32;
+        constexpr uint32_t PixelsPerBlock = 32;
+        const KernelTable& kernels = GetKernels();
+        LLUtils::Color block[PixelsPerBlock];
+
+        for (uint32_t first = 0; first < numPixels; first += PixelsPerBlock)
+        {
+            const uint32_t count = std::min(PixelsPerBlock, numPixels - first);
+            kernels.lcdToRGBA(source + first * 3, count, textColor, block);
+            ColorF32* destBlock = dest + first;
+            if (linearBlending)
+            {
+                for (uint32_t i = 0; i < count; i++)
+                    destBlock[i] = GammaTables::ToLinear(block[i]).MultiplyAlpha();
+            }
+            else
+            {
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    const ColorF32 color = { block[i].R(), block[i].G(), block[i].B(), block[i].A() };
+                    destBlock[i] = color.MultiplyAlpha();
+                }
+            }
+        }
+    }
+
+    namespace
+    {
+        using LLUtils::Color;
+        using LLUtils::ColorF32;
+
+        void FillScalar(ColorF32* dest, ColorF32 value, size_t count)
+        {
+            std::fill_n(dest, count, value);
+        }
+
+        void BlendPremultipliedScalar(ColorF32* dest, const ColorF32* source, size_t count)
+        {
+            for (size_t i = 0; i < count; i++)
+                dest[i] = dest[i].BlendPreMultiplied(source[i]);
+        }
+
+        void ResolveScalar(Color* dest, const ColorF32* source, size_t count)
+        {
+            for (size_t i = 0; i < count; i++)
+                dest[i] = static_cast<Color>(source[i].DivideAlpha());
+        }
+
+        void ExpandGrayScalar(ColorF32* dest, const uint8_t* coverage, size_t count, const ColorF32* colorTable)
+        {
+            for (size_t i = 0; i < count; i++)
+                dest[i] = colorTable[coverage[i]];
+        }
+
+        void CompositeCoverageScalar(ColorF32* dest, const uint8_t* fill, const uint8_t* outline, const uint8_t* index, size_t count
+            , ColorF32 background, const ColorF32* outlineColors, const ColorF32* const* fillColors)
+        {
+            // Zero coverage maps to transparent black, which leaves the color as is, so every pixel takes the same path.
+            for (size_t i = 0; i < count; i++)
+                dest[i] = background.BlendPreMultiplied(outlineColors[outline[i]]).BlendPreMultiplied(fillColors[index[i]][fill[i]]);
+        }
+
+        void SwizzleRGBAToBGRAScalar(const std::byte* source, std::byte* dest, size_t numPixels)
+        {
+            for (size_t i = 0; i < numPixels * 4; i += 4)
+            {
+                const std::byte red = source[i + 0];
+                const std::byte green = source[i + 1];
+                const std::byte blue = source[i + 2];
+                const std::byte alpha = source[i + 3];
+                dest[i + 0] = blue;
+                dest[i + 1] = green;
+                dest[i + 2] = red;
+                dest[i + 3] = alpha;
+            }
+        }
+    }
+
+    const KernelTable* GetKernelsScalar()
+    {
+        static constexpr KernelTable table
+        {
+              CpuLevel::Scalar
+            , &FillScalar
+            , &BlendPremultipliedScalar
+            , &ResolveScalar
+            , &ExpandGrayScalar
+            , &CompositeCoverageScalar
+            , &SwizzleRGBAToBGRAScalar
+            , &LcdToRGBAScalar
+        };
+
+        return &table;
+    }
+}
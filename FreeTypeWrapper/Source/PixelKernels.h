@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <LLUtils/Color.h>
+#include <FreeTypeWrapper/CpuDispatch.h>
+
+namespace FreeType
+{
+    // Low level pixel kernels used by the renderer.
+    // Each kernel has a portable scalar reference version and SIMD versions. Kernels that copy or do integer math (fill,
+    // expandGray, lcdToRGBA, swizzleRGBAToBGRA) produce the same bytes at every level. The float kernels
+    // (blendPremultiplied, resolve, compositeCoverage) don't repeat the LLUtils color arithmetic operation for
+    // operation and may differ from the reference by one 8 bit level after resolving, so rendered text can differ by
+    // one level between CPU levels.
+    namespace PixelKernels
+    {
+        // Converts packed LCD subpixel coverage (3 bytes per pixel, no row padding) to 8 bit straight RGBA colors,
+        // with the channel average as alpha and each channel mixed between its subpixel coverage and the text color.
+        void LcdToRGBAScalar(const uint8_t* source, uint32_t numPixels, LLUtils::Color textColor, LLUtils::Color* dest);
+        void LcdToRGBASSE2(const uint8_t* source, uint32_t numPixels, LLUtils::Color textColor, LLUtils::Color* dest);
+        // Expands a row of an LCD glyph to premultiplied colors, in linear light when linearBlending is set. Converts
+        // blocks of pixels on the stack with lcdToRGBA of the active level, so the colors are the same at every level.
+        void ExpandLcd(LLUtils::ColorF32* dest, const uint8_t* source, uint32_t numPixels, LLUtils::Color textColor, bool linearBlending);
+        // SSE4.1 blend and composite kernels, also used by the AVX2 and AVX-512 tables since the wider versions measured
+        // slower: these kernels are bound by the color table lookups, not by arithmetic. Only built on x86.
+        void BlendPremultipliedSSE41(LLUtils::ColorF32* dest, const LLUtils::ColorF32* source, size_t count);
+        void CompositeCoverageSSE41(LLUtils::ColorF32* dest, const uint8_t* fill, const uint8_t* outline, const uint8_t* index, size_t count
+            , LLUtils::ColorF32 background, const LLUtils::ColorF32* outlineColors, const LLUtils::ColorF32* const* fillColors);
+
+        // One implementation of every kernel for a single instruction set level.
+        struct KernelTable
+        {
+            CpuLevel level;
+            // dest[i] = value
+            void (*fill)(LLUtils::ColorF32* dest, LLUtils::ColorF32 value, size_t count);
+            // dest[i] = source[i] over dest[i], both premultiplied.
+            void (*blendPremultiplied)(LLUtils::ColorF32* dest, const LLUtils::ColorF32* source, size_t count);
+            // Premultiplied float to straight 8 bit.
+            void (*resolve)(LLUtils::Color* dest, const LLUtils::ColorF32* source, size_t count);
+            // dest[i] = colorTable[coverage[i]], expands a row of an 8 bit gray glyph.
+            void (*expandGray)(LLUtils::ColorF32* dest, const uint8_t* coverage, size_t count, const LLUtils::ColorF32* colorTable);
+            // dest[i] = fillColors[index[i]][fill[i]] over outlineColors[outline[i]] over background, composites the planes
+            // of a CoverageCanvas.
+            void (*compositeCoverage)(LLUtils::ColorF32* dest, const uint8_t* fill, const uint8_t* outline, const uint8_t* index, size_t count
+                , LLUtils::ColorF32 background, const LLUtils::ColorF32* outlineColors, const LLUtils::ColorF32* const* fillColors);
+            void (*swizzleRGBAToBGRA)(const std::byte* source, std::byte* dest, size_t numPixels);
+            void (*lcdToRGBA)(const uint8_t* source, uint32_t numPixels, LLUtils::Color textColor, LLUtils::Color* dest);
+        };
+
+        // Kernels of the active level, see CpuDispatch.
+        const KernelTable& GetKernels();
+        // Kernels of a specific level, nullptr when the build or the processor doesn't support it.
+        const KernelTable* GetKernels(CpuLevel level);
+
+        // Per level tables, each defined in its own translation unit built with the matching instruction set.
+        // nullptr when the level wasn't compiled in.
+        const KernelTable* GetKernelsScalar();
+        const KernelTable* GetKernelsSSE41();
+        const KernelTable* GetKernelsAVX2();
+        const KernelTable* GetKernelsAVX512();
+
+        inline void LcdToRGBA(const uint8_t* source, uint32_t numPixels, LLUtils::Color textColor, LLUtils::Color* dest)
+        {
+            GetKernels().lcdToRGBA(source, numPixels, textColor, dest);
+        }
+    }
+}
@@ -0,0 +1,139 @@
+#include "PixelKernels.h"
+#include <cstring>
+
+// This file is built with AVX2 code generation enabled, see CMakeLists.txt. It must not instantiate templates or call
+// inline functions shared with other translation units, the linker could keep this file's copy of them and run it on a
+// processor without AVX2. Pixels are accessed as raw floats and bytes for that reason.
+#if defined(__AVX2__)
+    #define FREETYPE_WRAPPER_BUILD_AVX2 1
+    #include <immintrin.h>
+#else
+    #define FREETYPE_WRAPPER_BUILD_AVX2 0
+#endif
+
+namespace FreeType::PixelKernels
+{
+#if FREETYPE_WRAPPER_BUILD_AVX2
+    namespace
+    {
+        using LLUtils::Color;
+        using LLUtils::ColorF32;
+
+        // Straight alpha 8 bit channels of two premultiplied pixels, as 8 32 bit integers.
+        inline __m256i ResolvePixels(__m256 pixels)
+        {
+            const __m256 alpha = _mm256_permute_ps(pixels, _MM_SHUFFLE(3, 3, 3, 3));
+            const __m256 transparent = _mm256_cmp_ps(alpha, _mm256_setzero_ps(), _CMP_EQ_OQ);
+            __m256 straight = _mm256_blendv_ps(_mm256_div_ps(pixels, alpha), pixels, transparent);
+            straight = _mm256_blend_ps(straight, pixels, 0x88);
+            straight = _mm256_min_ps(_mm256_max_ps(straight, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+            return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(straight, _mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f)));
+        }
+
+        inline void ResolvePixel(const float* source, uint8_t* dest)
+        {
+            const __m256i p = ResolvePixels(_mm256_castps128_ps256(_mm_loadu_ps(source)));
+            const __m128i low = _mm256_castsi256_si128(p);
+            const int packed = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(low, low), _mm_setzero_si128()));
+            std::memcpy(dest, &packed, 4);
+        }
+
+        void FillAVX2(ColorF32* dest, ColorF32 value, size_t count)
+        {
+            float* destFloats = reinterpret_cast<float*>(dest);
+            const __m128 pixel = _mm_loadu_ps(reinterpret_cast<const float*>(&value));
+            const __m256 pixels = _mm256_broadcast_ps(&pixel);
+
+            size_t i = 0;
+            for (; i + 2 <= count; i += 2)
+                _mm256_storeu_ps(destFloats + i * 4, pixels);
+            if (i < count)
+                _mm_storeu_ps(destFloats + i * 4, pixel);
+        }
+
+        void ResolveAVX2(Color* dest, const ColorF32* source, size_t count)
+        {
+            uint8_t* destBytes = reinterpret_cast<uint8_t*>(dest);
+            const float* sourceFloats = reinterpret_cast<const float*>(source);
+            // Packing works within 128 bit lanes, leaving the pixels in 0 2 4 6 1 3 5 7 order.
+            const __m256i pixelOrder = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                const __m256i p01 = ResolvePixels(_mm256_loadu_ps(sourceFloats + i * 4 + 0));
+                const __m256i p23 = ResolvePixels(_mm256_loadu_ps(sourceFloats + i * 4 + 8));
+                const __m256i p45 = ResolvePixels(_mm256_loadu_ps(sourceFloats + i * 4 + 16));
+                const __m256i p67 = ResolvePixels(_mm256_loadu_ps(sourceFloats + i * 4 + 24));
+                const __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(p01, p23), _mm256_packs_epi32(p45, p67));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(destBytes + i * 4), _mm256_permutevar8x32_epi32(packed, pixelOrder));
+            }
+
+            for (; i < count; i++)
+                ResolvePixel(sourceFloats + i * 4, destBytes + i * 4);
+        }
+
+        void ExpandGrayAVX2(ColorF32* dest, const uint8_t* coverage, size_t count, const ColorF32* colorTable)
+        {
+            float* destFloats = reinterpret_cast<float*>(dest);
+            const float* tableFloats = reinterpret_cast<const float*>(colorTable);
+
+            size_t i = 0;
+            for (; i + 2 <= count; i += 2)
+            {
+                const __m128 first = _mm_loadu_ps(tableFloats + coverage[i] * 4);
+                const __m128 second = _mm_loadu_ps(tableFloats + coverage[i + 1] * 4);
+                _mm256_storeu_ps(destFloats + i * 4, _mm256_insertf128_ps(_mm256_castps128_ps256(first), second, 1));
+            }
+
+            if (i < count)
+                _mm_storeu_ps(destFloats + i * 4, _mm_loadu_ps(tableFloats + coverage[i] * 4));
+        }
+
+        void SwizzleRGBAToBGRAAVX2(const std::byte* source, std::byte* dest, size_t numPixels)
+        {
+            const __m256i mask = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15
+                , 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+            size_t i = 0;
+            for (; i + 8 <= numPixels; i += 8)
+            {
+                const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i * 4));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i * 4), _mm256_shuffle_epi8(pixels, mask));
+            }
+
+            for (; i < numPixels; i++)
+            {
+                const std::byte red = source[i * 4 + 0];
+                const std::byte blue = source[i * 4 + 2];
+                dest[i * 4 + 0] = blue;
+                dest[i * 4 + 1] = source[i * 4 + 1];
+                dest[i * 4 + 2] = red;
+                dest[i * 4 + 3] = source[i * 4 + 3];
+            }
+        }
+    }
+
+    const KernelTable* GetKernelsAVX2()
+    {
+        static constexpr KernelTable table
+        {
+              CpuLevel::AVX2
+            , &FillAVX2
+            , &BlendPremultipliedSSE41
+            , &ResolveAVX2
+            , &ExpandGrayAVX2
+            , &CompositeCoverageSSE41
+            , &SwizzleRGBAToBGRAAVX2
+            , &LcdToRGBASSE2
+        };
+
+        return &table;
+    }
+#else
+    const KernelTable* GetKernelsAVX2()
+    {
+        return nullptr;
+    }
+#endif
+}
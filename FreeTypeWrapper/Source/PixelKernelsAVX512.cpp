@@ -0,0 +1,127 @@
+#include "PixelKernels.h"
+
+// This file is built with AVX-512 (F, BW, VL) code generation enabled, see CMakeLists.txt. It must not instantiate
+// templates or call inline functions shared with other translation units, the linker could keep this file's copy of them
+// and run it on a processor without AVX-512. Pixels are accessed as raw floats and bytes for that reason.
+#if defined(__AVX512F__) && defined(__AVX512BW__) && defined(__AVX512VL__)
+    #define FREETYPE_WRAPPER_BUILD_AVX512 1
+    #include <immintrin.h>
+    #if defined(__GNUC__) && !defined(__clang__)
+        // GCC 12 headers start several AVX-512 intrinsics from an undefined register and warn about it where they're inlined.
+        #pragma GCC diagnostic ignored "-Wuninitialized"
+        #pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+    #endif
+#else
+    #define FREETYPE_WRAPPER_BUILD_AVX512 0
+#endif
+
+namespace FreeType::PixelKernels
+{
+#if FREETYPE_WRAPPER_BUILD_AVX512
+    namespace
+    {
+        using LLUtils::Color;
+        using LLUtils::ColorF32;
+
+        // Mask of the float lanes of the first numPixels pixels in a 4 pixel register.
+        inline __mmask16 PixelMask(size_t numPixels)
+        {
+            return static_cast<__mmask16>((1u << (numPixels * 4)) - 1);
+        }
+
+        // Straight alpha 8 bit channels of four premultiplied pixels, as 16 bytes.
+        inline __m128i ResolvePixels(__m512 pixels)
+        {
+            const __m512 alpha = _mm512_permute_ps(pixels, _MM_SHUFFLE(3, 3, 3, 3));
+            // Divide the color channels of pixels that aren't fully transparent.
+            const __mmask16 divide = _mm512_cmp_ps_mask(alpha, _mm512_setzero_ps(), _CMP_NEQ_OQ) & 0x7777;
+            __m512 straight = _mm512_mask_div_ps(pixels, divide, pixels, alpha);
+            straight = _mm512_min_ps(_mm512_max_ps(straight, _mm512_setzero_ps()), _mm512_set1_ps(1.0f));
+            const __m512i channels = _mm512_cvttps_epi32(_mm512_add_ps(_mm512_mul_ps(straight, _mm512_set1_ps(255.0f)), _mm512_set1_ps(0.5f)));
+            return _mm512_cvtusepi32_epi8(channels);
+        }
+
+        void FillAVX512(ColorF32* dest, ColorF32 value, size_t count)
+        {
+            float* destFloats = reinterpret_cast<float*>(dest);
+            const __m512 pixels = _mm512_broadcast_f32x4(_mm_loadu_ps(reinterpret_cast<const float*>(&value)));
+
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4)
+                _mm512_storeu_ps(destFloats + i * 4, pixels);
+            if (i < count)
+                _mm512_mask_storeu_ps(destFloats + i * 4, PixelMask(count - i), pixels);
+        }
+
+        void ResolveAVX512(Color* dest, const ColorF32* source, size_t count)
+        {
+            uint8_t* destBytes = reinterpret_cast<uint8_t*>(dest);
+            const float* sourceFloats = reinterpret_cast<const float*>(source);
+
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4)
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(destBytes + i * 4), ResolvePixels(_mm512_loadu_ps(sourceFloats + i * 4)));
+
+            if (i < count)
+            {
+                const __mmask16 mask = PixelMask(count - i);
+                _mm_mask_storeu_epi8(destBytes + i * 4, mask, ResolvePixels(_mm512_maskz_loadu_ps(mask, sourceFloats + i * 4)));
+            }
+        }
+
+        void ExpandGrayAVX512(ColorF32* dest, const uint8_t* coverage, size_t count, const ColorF32* colorTable)
+        {
+            float* destFloats = reinterpret_cast<float*>(dest);
+            const float* tableFloats = reinterpret_cast<const float*>(colorTable);
+
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4)
+            {
+                __m512 pixels = _mm512_castps128_ps512(_mm_loadu_ps(tableFloats + coverage[i] * 4));
+                pixels = _mm512_insertf32x4(pixels, _mm_loadu_ps(tableFloats + coverage[i + 1] * 4), 1);
+                pixels = _mm512_insertf32x4(pixels, _mm_loadu_ps(tableFloats + coverage[i + 2] * 4), 2);
+                pixels = _mm512_insertf32x4(pixels, _mm_loadu_ps(tableFloats + coverage[i + 3] * 4), 3);
+                _mm512_storeu_ps(destFloats + i * 4, pixels);
+            }
+
+            for (; i < count; i++)
+                _mm_storeu_ps(destFloats + i * 4, _mm_loadu_ps(tableFloats + coverage[i] * 4));
+        }
+
+        void SwizzleRGBAToBGRAAVX512(const std::byte* source, std::byte* dest, size_t numPixels)
+        {
+            const __m512i mask = _mm512_broadcast_i32x4(_mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15));
+
+            for (size_t i = 0; i < numPixels; i += 16)
+            {
+                const size_t remaining = numPixels - i;
+                const __mmask64 bytes = remaining >= 16 ? ~__mmask64{ 0 } : (__mmask64{ 1 } << (remaining * 4)) - 1;
+                const __m512i pixels = _mm512_maskz_loadu_epi8(bytes, source + i * 4);
+                _mm512_mask_storeu_epi8(dest + i * 4, bytes, _mm512_shuffle_epi8(pixels, mask));
+            }
+        }
+    }
+
+    const KernelTable* GetKernelsAVX512()
+    {
+        static constexpr KernelTable table
+        {
+              CpuLevel::AVX512
+            , &FillAVX512
+            , &BlendPremultipliedSSE41
+            , &ResolveAVX512
+            , &ExpandGrayAVX512
+            , &CompositeCoverageSSE41
+            , &SwizzleRGBAToBGRAAVX512
+            , &LcdToRGBASSE2
+        };
+
+        return &table;
+    }
+#else
+    const KernelTable* GetKernelsAVX512()
+    {
+        return nullptr;
+    }
+#endif
+}
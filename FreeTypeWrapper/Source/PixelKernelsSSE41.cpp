@@ -0,0 +1,154 @@
+#include "PixelKernels.h"
+#include <cstring>
+
+// This file is built with SSE4.1 code generation enabled, see CMakeLists.txt. It must not instantiate templates or call
+// inline functions shared with other translation units, the linker could keep this file's copy of them and run it on a
+// processor without SSE4.1. Pixels are accessed as raw floats and bytes for that reason.
+#if defined(__SSE4_1__) || (defined(_MSC_VER) && !defined(__clang__) && (defined(_M_X64) || defined(_M_IX86)))
+    #define FREETYPE_WRAPPER_BUILD_SSE41 1
+    #include <smmintrin.h>
+#else
+    #define FREETYPE_WRAPPER_BUILD_SSE41 0
+#endif
+
+namespace FreeType::PixelKernels
+{
+#if FREETYPE_WRAPPER_BUILD_SSE41
+    namespace
+    {
+        using LLUtils::Color;
+        using LLUtils::ColorF32;
+
+        // Straight alpha 8 bit channels of a premultiplied pixel, as 4 32 bit integers.
+        inline __m128i ResolvePixel(__m128 pixel)
+        {
+            const __m128 alpha = _mm_shuffle_ps(pixel, pixel, _MM_SHUFFLE(3, 3, 3, 3));
+            const __m128 transparent = _mm_cmpeq_ps(alpha, _mm_setzero_ps());
+            __m128 straight = _mm_blendv_ps(_mm_div_ps(pixel, alpha), pixel, transparent);
+            straight = _mm_blend_ps(straight, pixel, 0x8);
+            straight = _mm_min_ps(_mm_max_ps(straight, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+            return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(straight, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+        }
+
+        void FillSSE41(ColorF32* dest, ColorF32 value, size_t count)
+        {
+            float* destFloats = reinterpret_cast<float*>(dest);
+            const __m128 pixel = _mm_loadu_ps(reinterpret_cast<const float*>(&value));
+            for (size_t i = 0; i < count; i++)
+                _mm_storeu_ps(destFloats + i * 4, pixel);
+        }
+
+        void ResolveSSE41(Color* dest, const ColorF32* source, size_t count)
+        {
+            uint8_t* destBytes = reinterpret_cast<uint8_t*>(dest);
+            const float* sourceFloats = reinterpret_cast<const float*>(source);
+
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4)
+            {
+                const __m128i p0 = ResolvePixel(_mm_loadu_ps(sourceFloats + i * 4 + 0));
+                const __m128i p1 = ResolvePixel(_mm_loadu_ps(sourceFloats + i * 4 + 4));
+                const __m128i p2 = ResolvePixel(_mm_loadu_ps(sourceFloats + i * 4 + 8));
+                const __m128i p3 = ResolvePixel(_mm_loadu_ps(sourceFloats + i * 4 + 12));
+                const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(destBytes + i * 4), packed);
+            }
+
+            for (; i < count; i++)
+            {
+                const __m128i p = ResolvePixel(_mm_loadu_ps(sourceFloats + i * 4));
+                const int packed = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(p, p), _mm_setzero_si128()));
+                std::memcpy(destBytes + i * 4, &packed, 4);
+            }
+        }
+
+        void ExpandGraySSE41(ColorF32* dest, const uint8_t* coverage, size_t count, const ColorF32* colorTable)
+        {
+            float* destFloats = reinterpret_cast<float*>(dest);
+            const float* tableFloats = reinterpret_cast<const float*>(colorTable);
+            for (size_t i = 0; i < count; i++)
+                _mm_storeu_ps(destFloats + i * 4, _mm_loadu_ps(tableFloats + coverage[i] * 4));
+        }
+
+        // source over dest, both premultiplied.
+        inline __m128 BlendPixel(__m128 dest, __m128 source)
+        {
+            const __m128 inverseAlpha = _mm_sub_ps(_mm_set1_ps(1.0f), _mm_shuffle_ps(source, source, _MM_SHUFFLE(3, 3, 3, 3)));
+            return _mm_add_ps(source, _mm_mul_ps(dest, inverseAlpha));
+        }
+
+        void SwizzleRGBAToBGRASSE41(const std::byte* source, std::byte* dest, size_t numPixels)
+        {
+            const __m128i mask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+            size_t i = 0;
+            for (; i + 4 <= numPixels; i += 4)
+            {
+                const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i * 4), _mm_shuffle_epi8(pixels, mask));
+            }
+
+            for (; i < numPixels; i++)
+            {
+                const std::byte red = source[i * 4 + 0];
+                const std::byte blue = source[i * 4 + 2];
+                dest[i * 4 + 0] = blue;
+                dest[i * 4 + 1] = source[i * 4 + 1];
+                dest[i * 4 + 2] = red;
+                dest[i * 4 + 3] = source[i * 4 + 3];
+            }
+        }
+    }
+
+    void BlendPremultipliedSSE41(LLUtils::ColorF32* dest, const LLUtils::ColorF32* source, size_t count)
+    {
+        float* destFloats = reinterpret_cast<float*>(dest);
+        const float* sourceFloats = reinterpret_cast<const float*>(source);
+        const __m128 one = _mm_set1_ps(1.0f);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const __m128 src = _mm_loadu_ps(sourceFloats + i * 4);
+            const __m128 dst = _mm_loadu_ps(destFloats + i * 4);
+            const __m128 inverseAlpha = _mm_sub_ps(one, _mm_shuffle_ps(src, src, _MM_SHUFFLE(3, 3, 3, 3)));
+            _mm_storeu_ps(destFloats + i * 4, _mm_add_ps(src, _mm_mul_ps(dst, inverseAlpha)));
+        }
+    }
+
+    void CompositeCoverageSSE41(LLUtils::ColorF32* dest, const uint8_t* fill, const uint8_t* outline, const uint8_t* index, size_t count
+        , LLUtils::ColorF32 background, const LLUtils::ColorF32* outlineColors, const LLUtils::ColorF32* const* fillColors)
+    {
+        float* destFloats = reinterpret_cast<float*>(dest);
+        const __m128 backgroundPixel = _mm_loadu_ps(reinterpret_cast<const float*>(&background));
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const __m128 outlineColor = _mm_loadu_ps(reinterpret_cast<const float*>(outlineColors + outline[i]));
+            const __m128 fillColor = _mm_loadu_ps(reinterpret_cast<const float*>(fillColors[index[i]] + fill[i]));
+            _mm_storeu_ps(destFloats + i * 4, BlendPixel(BlendPixel(backgroundPixel, outlineColor), fillColor));
+        }
+    }
+
+    const KernelTable* GetKernelsSSE41()
+    {
+        static constexpr KernelTable table
+        {
+              CpuLevel::SSE41
+            , &FillSSE41
+            , &BlendPremultipliedSSE41
+            , &ResolveSSE41
+            , &ExpandGraySSE41
+            , &CompositeCoverageSSE41
+            , &SwizzleRGBAToBGRASSE41
+            , &LcdToRGBASSE2
+        };
+
+        return &table;
+    }
+#else
+    const KernelTable* GetKernelsSSE41()
+    {
+        return nullptr;
+    }
+#endif
+}
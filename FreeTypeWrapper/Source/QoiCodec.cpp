@@ -0,0 +1,338 @@
+#include <FreeTypeWrapper/QoiCodec.h>
+#include <FreeTypeWrapper/BitmapFile.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <LLUtils/Exception.h>
+#include <LLUtils/Warnings.h>
+
+namespace FreeType
+{
+    namespace
+    {
+        constexpr uint8_t OpIndex = 0x00;
+        constexpr uint8_t OpDiff = 0x40;
+        constexpr uint8_t OpLuma = 0x80;
+        constexpr uint8_t OpRun = 0xC0;
+        constexpr uint8_t OpRGB = 0xFE;
+        constexpr uint8_t OpRGBA = 0xFF;
+        constexpr uint8_t OpMask = 0xC0;
+
+        constexpr size_t HeaderSize = 14;
+        constexpr uint8_t EndMarker[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+        // Same limit as the reference decoder, guards the decoded size against corrupt headers.
+        constexpr uint64_t MaxPixels = 400'000'000;
+        // Pixels per chunk, large enough that the index restarting at every chunk costs next to nothing.
+        constexpr size_t ChunkPixels = 256 * 1024;
+        // Largest encoding of a pixel, QOI_OP_RGBA.
+        constexpr size_t MaxPixelSize = 5;
+
+        struct Pixel
+        {
+            uint8_t r;
+            uint8_t g;
+            uint8_t b;
+            uint8_t a;
+
+            bool operator==(const Pixel&) const = default;
+        };
+
+        uint32_t Hash(Pixel pixel)
+        {
+            return (pixel.r * 3u + pixel.g * 5u + pixel.b * 7u + pixel.a * 11u) % 64u;
+        }
+
+        void WriteHeader(uint8_t* dest, uint32_t width, uint32_t height)
+        {
+            LLUTILS_DISABLE_WARNING_PUSH
+            LLUTILS_DISABLE_WARNING_UNSAFE_BUFFER_USAGE
+            const uint8_t header[HeaderSize] = { 'q', 'o', 'i', 'f'
+                , static_cast<uint8_t>(width >> 24), static_cast<uint8_t>(width >> 16), static_cast<uint8_t>(width >> 8), static_cast<uint8_t>(width)
+                , static_cast<uint8_t>(height >> 24), static_cast<uint8_t>(height >> 16), static_cast<uint8_t>(height >> 8), static_cast<uint8_t>(height)
+                // RGBA, sRGB with linear alpha.
+                , 4, 0 };
+            LLUTILS_DISABLE_WARNING_POP
+            std::memcpy(dest, header, HeaderSize);
+        }
+
+        // Encodes rows [firstRow, lastRow) into dest, which holds at least MaxPixelSize bytes per pixel, returns the
+        // bytes written. 'previous' is the pixel before the chunk, the first chunk starts with the reference encoder's
+        // state.
+        size_t EncodeRows(const BitmapBuffer& bitmap, uint32_t firstRow, uint32_t lastRow, Pixel previous, bool firstChunk, uint8_t* dest)
+        {
+            Pixel index[64]{};
+            // The first chunk shares the zeroed index with the decoder, later chunks only know the entries they added.
+            uint64_t validEntries = firstChunk ? ~uint64_t{ 0 } : 0;
+            uint8_t* out = dest;
+            uint32_t run = 0;
+
+            LLUTILS_DISABLE_WARNING_PUSH
+            LLUTILS_DISABLE_WARNING_UNSAFE_BUFFER_USAGE
+            for (uint32_t y = firstRow; y < lastRow; y++)
+            {
+                const std::byte* row = bitmap.buffer + static_cast<size_t>(y) * bitmap.rowPitch;
+                for (uint32_t x = 0; x < bitmap.width; x++)
+                {
+                    Pixel pixel;
+                    std::memcpy(&pixel, row + static_cast<size_t>(x) * 4, sizeof(pixel));
+
+                    if (pixel == previous)
+                    {
+                        if (++run == 62)
+                        {
+                            *out++ = static_cast<uint8_t>(OpRun | (run - 1));
+                            run = 0;
+                        }
+                        continue;
+                    }
+
+                    if (run > 0)
+                    {
+                        *out++ = static_cast<uint8_t>(OpRun | (run - 1));
+                        run = 0;
+                    }
+
+                    const uint32_t hash = Hash(pixel);
+                    if ((validEntries >> hash & 1) != 0 && index[hash] == pixel)
+                    {
+                        *out++ = static_cast<uint8_t>(OpIndex | hash);
+                    }
+                    else
+                    {
+                        index[hash] = pixel;
+                        validEntries |= uint64_t{ 1 } << hash;
+
+                        if (pixel.a == previous.a)
+                        {
+                            const int vr = static_cast<int8_t>(pixel.r - previous.r);
+                            const int vg = static_cast<int8_t>(pixel.g - previous.g);
+                            const int vb = static_cast<int8_t>(pixel.b - previous.b);
+                            const int vgr = vr - vg;
+                            const int vgb = vb - vg;
+
+                            if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2)
+                            {
+                                *out++ = static_cast<uint8_t>(OpDiff | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));
+                            }
+                            else if (vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8)
+                            {
+                                *out++ = static_cast<uint8_t>(OpLuma | (vg + 32));
+                                *out++ = static_cast<uint8_t>((vgr + 8) << 4 | (vgb + 8));
+                            }
+                            else
+                            {
+                                *out++ = OpRGB;
+                                *out++ = pixel.r;
+                                *out++ = pixel.g;
+                                *out++ = pixel.b;
+                            }
+                        }
+                        else
+                        {
+                            *out++ = OpRGBA;
+                            *out++ = pixel.r;
+                            *out++ = pixel.g;
+                            *out++ = pixel.b;
+                            *out++ = pixel.a;
+                        }
+                    }
+                    previous = pixel;
+                }
+            }
+
+            // Runs don't continue into the next chunk.
+            if (run > 0)
+                *out++ = static_cast<uint8_t>(OpRun | (run - 1));
+            LLUTILS_DISABLE_WARNING_POP
+
+            return static_cast<size_t>(out - dest);
+        }
+    }
+
+    std::pmr::vector<std::vector<std::byte>> QoiCodec::EncodeChunks(const BitmapBuffer& bitmap, uint32_t maxThreads, std::pmr::memory_resource* memoryResource)
+    {
+        if (bitmap.bitsPerPixel != 32)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "Only 32 bit bitmaps can be encoded");
+        if (bitmap.width == 0 || bitmap.height == 0 || static_cast<uint64_t>(bitmap.width) * bitmap.height > MaxPixels)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "Bitmap size is not supported by QOI");
+
+        const uint32_t rowsPerChunk = static_cast<uint32_t>(std::max<size_t>(ChunkPixels / bitmap.width, 1));
+        const uint32_t chunkCount = (bitmap.height + rowsPerChunk - 1) / rowsPerChunk;
+        // The memory resource isn't required to be thread safe, the threads only allocate from the heap.
+        std::pmr::vector<std::vector<std::byte>> chunks(chunkCount, memoryResource);
+
+        const uint32_t threadCount = std::min(maxThreads != 0 ? maxThreads : std::max(std::thread::hardware_concurrency(), 1u), chunkCount);
+        std::pmr::vector<std::exception_ptr> threadErrors(threadCount, memoryResource);
+
+        // Each thread encodes into its own worst case sized scratch, chunks keep only the bytes they use.
+        std::atomic<uint32_t> nextChunk{ 0 };
+        const auto encode = [&](uint32_t thread)
+        {
+            try
+            {
+                std::pmr::vector<std::byte> scratch(static_cast<size_t>(rowsPerChunk) * bitmap.width * MaxPixelSize, std::pmr::new_delete_resource());
+                for (uint32_t chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++)
+                {
+                    const uint32_t firstRow = chunk * rowsPerChunk;
+                    const uint32_t lastRow = std::min(firstRow + rowsPerChunk, bitmap.height);
+
+                    Pixel previous{ 0, 0, 0, 255 };
+                    if (firstRow > 0)
+                    {
+                        LLUTILS_DISABLE_WARNING_PUSH
+                        LLUTILS_DISABLE_WARNING_UNSAFE_BUFFER_USAGE
+                        std::memcpy(&previous, bitmap.buffer + static_cast<size_t>(firstRow - 1) * bitmap.rowPitch + (static_cast<size_t>(bitmap.width) - 1) * 4, sizeof(previous));
+                        LLUTILS_DISABLE_WARNING_POP
+                    }
+
+                    const size_t size = EncodeRows(bitmap, firstRow, lastRow, previous, chunk == 0, reinterpret_cast<uint8_t*>(scratch.data()));
+                    chunks[chunk].assign(scratch.begin(), scratch.begin() + static_cast<std::ptrdiff_t>(size));
+                }
+            }
+            catch (...)
+            {
+                threadErrors[thread] = std::current_exception();
+                nextChunk = chunkCount;
+            }
+        };
+
+        {
+            std::vector<std::jthread> workers;
+            for (uint32_t i = 1; i < threadCount; i++)
+                workers.emplace_back(encode, i);
+            encode(0);
+        }
+
+        for (const std::exception_ptr& error : threadErrors)
+            if (error)
+                std::rethrow_exception(error);
+
+        return chunks;
+    }
+
+    std::pmr::vector<std::byte> QoiCodec::Encode(const BitmapBuffer& bitmap, uint32_t maxThreads, std::pmr::memory_resource* memoryResource)
+    {
+        const std::pmr::vector<std::vector<std::byte>> chunks = EncodeChunks(bitmap, maxThreads, memoryResource);
+        size_t size = HeaderSize + sizeof(EndMarker);
+        for (const auto& chunk : chunks)
+            size += chunk.size();
+
+        std::pmr::vector<std::byte> encoded(size, memoryResource);
+        WriteHeader(reinterpret_cast<uint8_t*>(encoded.data()), bitmap.width, bitmap.height);
+        auto out = encoded.begin() + HeaderSize;
+        for (const auto& chunk : chunks)
+            out = std::copy(chunk.begin(), chunk.end(), out);
+        std::memcpy(&*out, EndMarker, sizeof(EndMarker));
+        return encoded;
+    }
+
+    void QoiCodec::SaveToFile(const std::wstring& filePath, const BitmapBuffer& bitmap, uint32_t maxThreads, std::pmr::memory_resource* memoryResource)
+    {
+        const std::pmr::vector<std::vector<std::byte>> chunks = EncodeChunks(bitmap, maxThreads, memoryResource);
+        uint8_t header[HeaderSize];
+        WriteHeader(header, bitmap.width, bitmap.height);
+
+        std::ofstream file(std::filesystem::path(filePath), std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        for (const auto& chunk : chunks)
+            file.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+        file.write(reinterpret_cast<const char*>(EndMarker), sizeof(EndMarker));
+        file.close();
+        if (file.fail())
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, "Unable to write QOI file");
+    }
+
+    std::pmr::vector<std::byte> QoiCodec::Decode(std::span<const std::byte> data, uint32_t& out_width, uint32_t& out_height, std::pmr::memory_resource* memoryResource)
+    {
+        const auto* bytes = reinterpret_cast<const uint8_t*>(data.data());
+        if (data.size() < HeaderSize + sizeof(EndMarker) || std::memcmp(bytes, "qoif", 4) != 0)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "Not a QOI image");
+
+        LLUTILS_DISABLE_WARNING_PUSH
+        LLUTILS_DISABLE_WARNING_UNSAFE_BUFFER_USAGE
+        const uint32_t width = static_cast<uint32_t>(bytes[4]) << 24 | static_cast<uint32_t>(bytes[5]) << 16 | static_cast<uint32_t>(bytes[6]) << 8 | bytes[7];
+        const uint32_t height = static_cast<uint32_t>(bytes[8]) << 24 | static_cast<uint32_t>(bytes[9]) << 16 | static_cast<uint32_t>(bytes[10]) << 8 | bytes[11];
+        const uint8_t channels = bytes[12];
+        if (width == 0 || height == 0 || static_cast<uint64_t>(width) * height > MaxPixels || (channels != 3 && channels != 4) || bytes[13] > 1)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "Invalid QOI header");
+
+        const size_t pixelCount = static_cast<size_t>(width) * height;
+        std::pmr::vector<std::byte> pixels(pixelCount * 4, memoryResource);
+        auto* dest = reinterpret_cast<uint8_t*>(pixels.data());
+
+        // Ops never read into the end marker.
+        const size_t end = data.size() - sizeof(EndMarker);
+        size_t position = HeaderSize;
+        const auto next = [&]()
+        {
+            if (position >= end)
+                LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "QOI data is truncated");
+            return bytes[position++];
+        };
+
+        Pixel index[64]{};
+        Pixel pixel{ 0, 0, 0, 255 };
+        uint32_t run = 0;
+        for (size_t i = 0; i < pixelCount; i++)
+        {
+            if (run > 0)
+            {
+                run--;
+            }
+            else
+            {
+                const uint8_t op = next();
+                if (op == OpRGB)
+                {
+                    pixel.r = next();
+                    pixel.g = next();
+                    pixel.b = next();
+                }
+                else if (op == OpRGBA)
+                {
+                    pixel.r = next();
+                    pixel.g = next();
+                    pixel.b = next();
+                    pixel.a = next();
+                }
+                else if ((op & OpMask) == OpIndex)
+                {
+                    pixel = index[op];
+                }
+                else if ((op & OpMask) == OpDiff)
+                {
+                    pixel.r = static_cast<uint8_t>(pixel.r + ((op >> 4) & 0x03) - 2);
+                    pixel.g = static_cast<uint8_t>(pixel.g + ((op >> 2) & 0x03) - 2);
+                    pixel.b = static_cast<uint8_t>(pixel.b + (op & 0x03) - 2);
+                }
+                else if ((op & OpMask) == OpLuma)
+                {
+                    const uint8_t second = next();
+                    const int vg = (op & 0x3F) - 32;
+                    pixel.r = static_cast<uint8_t>(pixel.r + vg - 8 + ((second >> 4) & 0x0F));
+                    pixel.g = static_cast<uint8_t>(pixel.g + vg);
+                    pixel.b = static_cast<uint8_t>(pixel.b + vg - 8 + (second & 0x0F));
+                }
+                else
+                {
+                    run = op & 0x3F;
+                }
+                index[Hash(pixel)] = pixel;
+            }
+
+            std::memcpy(dest + i * 4, &pixel, sizeof(pixel));
+        }
+
+        if (std::memcmp(bytes + end, EndMarker, sizeof(EndMarker)) != 0)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "QOI end marker is missing");
+        LLUTILS_DISABLE_WARNING_POP
+
+        out_width = width;
+        out_height = height;
+        return pixels;
+    }
+}
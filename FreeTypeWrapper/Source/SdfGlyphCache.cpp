@@ -0,0 +1,208 @@
+#include "SdfGlyphCache.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <LLUtils/Exception.h>
+#include <LLUtils/Warnings.h>
+
+namespace FreeType
+{
+    SdfGlyphCache::SdfGlyphCache(FT_Library library, std::pmr::memory_resource* memoryResource, size_t maxBytes)
+        : fLibrary(library)
+        , fMemoryResource(memoryResource)
+        , fMaxBytes(maxBytes)
+        , fGlyphs(memoryResource)
+        , fLru(memoryResource)
+        , fSizes(memoryResource)
+        , fCoverage(memoryResource)
+    {
+        // Both the outline based and the bitmap based renderers, the latter is used for glyphs with overlapping contours.
+        FT_Int spread = static_cast<FT_Int>(Spread);
+        for (const char* moduleName : { "sdf", "bsdf" })
+        {
+            if (FT_Error error = FT_Property_Set(fLibrary, moduleName, "spread", &spread); error != FT_Err_Ok)
+                LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, "FreeType error, signed distance field renderers are not available");
+        }
+    }
+
+    uint32_t SdfGlyphCache::GetBucketSize(float pixelSize)
+    {
+        // Fields are downscaled for all but the largest sizes, which keeps thin strokes intact at small sizes.
+        constexpr uint32_t MinBucketSize = 32;
+        constexpr uint32_t MaxBucketSize = 128;
+        uint32_t bucketSize = MinBucketSize;
+        while (bucketSize < MaxBucketSize && static_cast<float>(bucketSize) < pixelSize)
+            bucketSize *= 2;
+        return bucketSize;
+    }
+
+    FT_Size SdfGlyphCache::GetBucketFTSize(FT_Face face, uint32_t bucketSize)
+    {
+        const SizeKey key{ face, bucketSize };
+        if (auto it = fSizes.find(key); it != fSizes.end())
+            return it->second;
+
+        FT_Size size;
+        if (FT_Error error = FT_New_Size(face, &size); error != FT_Err_Ok)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, "FreeType error, can't create size");
+
+        FT_Size previousSize = face->size;
+        FT_Activate_Size(size);
+        const FT_Error error = FT_Set_Pixel_Sizes(face, 0, bucketSize);
+        FT_Activate_Size(previousSize);
+
+        if (error != FT_Err_Ok)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, "FreeType error, can't set pixel size");
+
+        fSizes.emplace(key, size);
+        return size;
+    }
+
+    const SdfGlyphCache::Glyph& SdfGlyphCache::GetGlyph(FT_Face face, FT_UInt glyphIndex, uint32_t bucketSize)
+    {
+        const GlyphKey key{ face, glyphIndex, bucketSize };
+        if (auto it = fGlyphs.find(key); it != fGlyphs.end())
+        {
+            fLru.splice(fLru.begin(), fLru, it->second.lruPosition);
+            return it->second.glyph;
+        }
+
+        FT_Size previousSize = face->size;
+        FT_Activate_Size(GetBucketFTSize(face, bucketSize));
+
+        Glyph glyph{ 0, 0, 0, 0, bucketSize, std::pmr::vector<uint8_t>(fMemoryResource) };
+        FT_GlyphSlot slot = face->glyph;
+
+        // Fields are scaled to every display size, so the outlines are not hinted for the bucket size.
+        FT_Error error = FT_Load_Glyph(face, glyphIndex, FT_LOAD_NO_HINTING | FT_LOAD_NO_BITMAP);
+        if (error == FT_Err_Ok && slot->format == FT_GLYPH_FORMAT_OUTLINE && slot->outline.n_contours > 0)
+        {
+            // The outline based renderer doesn't handle overlapping contours, the bitmap based renderer does.
+            if ((slot->outline.flags & FT_OUTLINE_OVERLAP) != 0)
+                error = FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL);
+            if (error == FT_Err_Ok)
+                error = FT_Render_Glyph(slot, FT_RENDER_MODE_SDF);
+
+            if (error == FT_Err_Ok)
+            {
+                const FT_Bitmap& bitmap = slot->bitmap;
+                glyph.left = slot->bitmap_left;
+                glyph.top = slot->bitmap_top;
+                glyph.width = bitmap.width;
+                glyph.height = bitmap.rows;
+                glyph.distances.resize(static_cast<size_t>(bitmap.width) * bitmap.rows);
+
+                LLUTILS_DISABLE_WARNING_PUSH
+                LLUTILS_DISABLE_WARNING_UNSAFE_BUFFER_USAGE
+                for (uint32_t y = 0; y < bitmap.rows; y++)
+                    std::memcpy(glyph.distances.data() + static_cast<size_t>(y) * bitmap.width, bitmap.buffer + static_cast<ptrdiff_t>(y) * bitmap.pitch, bitmap.width);
+                LLUTILS_DISABLE_WARNING_POP
+            }
+        }
+
+        FT_Activate_Size(previousSize);
+
+        if (error != FT_Err_Ok)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::RuntimeError, "FreeType error, unable to render signed distance field");
+
+        // The new field is kept even when it alone is over the budget.
+        while (fLru.empty() == false && fBytes + glyph.distances.size() > fMaxBytes)
+        {
+            auto evicted = fGlyphs.find(fLru.back());
+            fBytes -= evicted->second.glyph.distances.size();
+            fGlyphs.erase(evicted);
+            fLru.pop_back();
+        }
+
+        fBytes += glyph.distances.size();
+        fLru.push_front(key);
+        return fGlyphs.emplace(key, Entry{ std::move(glyph), fLru.begin() }).first->second.glyph;
+    }
+
+    void SdfGlyphCache::ReleaseFace(FT_Face face)
+    {
+        for (auto it = fGlyphs.lower_bound(GlyphKey{ face, 0, 0 }); it != fGlyphs.end() && std::get<0>(it->first) == face;)
+        {
+            fBytes -= it->second.glyph.distances.size();
+            fLru.erase(it->second.lruPosition);
+            it = fGlyphs.erase(it);
+        }
+
+        for (auto it = fSizes.lower_bound(SizeKey{ face, 0 }); it != fSizes.end() && std::get<0>(it->first) == face;)
+        {
+            FT_Done_Size(it->second);
+            it = fSizes.erase(it);
+        }
+    }
+
+    LLUTILS_DISABLE_WARNING_PUSH
+    LLUTILS_DISABLE_WARNING_UNSAFE_BUFFER_USAGE
+    void SdfGlyphCache::Rasterize(const Glyph& glyph, CoverageCanvas& canvas, CoverageCanvas::Layer layer, float scaleX, float scaleY
+        , float dilation, int32_t originX, int32_t baselineY, uint8_t colorIndex)
+    {
+        if (glyph.width == 0 || glyph.height == 0)
+            return;
+
+        // Display pixels per distance unit, 128 units span the spread.
+        const float distanceScale = (scaleX + scaleY) * 0.5f * static_cast<float>(Spread) / 128.0f;
+        // The field ends at the spread, dilating past it would cover the whole field rectangle.
+        dilation = std::min(dilation, 128.0f * distanceScale - 1.0f);
+
+        // FreeType pads the field by the spread around the glyph's box, only the part within the dilation and the edge ramp
+        // can be covered.
+        const float insetX = std::max(0.0f, static_cast<float>(Spread) - (dilation + 1.0f) / scaleX);
+        const float insetY = std::max(0.0f, static_cast<float>(Spread) - (dilation + 1.0f) / scaleY);
+        const int32_t left = static_cast<int32_t>(std::floor(static_cast<float>(originX) + (static_cast<float>(glyph.left) + insetX) * scaleX));
+        const int32_t right = static_cast<int32_t>(std::ceil(static_cast<float>(originX) + (static_cast<float>(glyph.left + static_cast<int32_t>(glyph.width)) - insetX) * scaleX));
+        const int32_t top = static_cast<int32_t>(std::floor(static_cast<float>(baselineY) - (static_cast<float>(glyph.top) - insetY) * scaleY));
+        const int32_t bottom = static_cast<int32_t>(std::ceil(static_cast<float>(baselineY) - (static_cast<float>(glyph.top - static_cast<int32_t>(glyph.height)) + insetY) * scaleY));
+        if (right <= left || bottom <= top)
+            return;
+        const uint32_t width = static_cast<uint32_t>(right - left);
+        const uint32_t height = static_cast<uint32_t>(bottom - top);
+        fCoverage.resize(static_cast<size_t>(width) * height);
+
+        const int32_t fieldWidth = static_cast<int32_t>(glyph.width);
+        const int32_t fieldHeight = static_cast<int32_t>(glyph.height);
+        const auto fetch = [&](int32_t x, int32_t y) -> float
+        {
+            // Everything outside the field is at least a spread away from the outline.
+            if (x < 0 || y < 0 || x >= fieldWidth || y >= fieldHeight)
+                return 0.0f;
+            return static_cast<float>(glyph.distances[static_cast<size_t>(y) * glyph.width + static_cast<size_t>(x)]);
+        };
+
+        for (uint32_t y = 0; y < height; y++)
+        {
+            // Field coordinates of the display pixel center, field pixel centers are at integer coordinates.
+            const float fieldY = static_cast<float>(glyph.top) - (static_cast<float>(baselineY - top - static_cast<int32_t>(y)) - 0.5f) / scaleY - 0.5f;
+            const int32_t y0 = static_cast<int32_t>(std::floor(fieldY));
+            const float fy = fieldY - static_cast<float>(y0);
+
+            for (uint32_t x = 0; x < width; x++)
+            {
+                const float fieldX = (static_cast<float>(left - originX + static_cast<int32_t>(x)) + 0.5f) / scaleX - static_cast<float>(glyph.left) - 0.5f;
+                const int32_t x0 = static_cast<int32_t>(std::floor(fieldX));
+                const float fx = fieldX - static_cast<float>(x0);
+
+                const float topValue = fetch(x0, y0) + (fetch(x0 + 1, y0) - fetch(x0, y0)) * fx;
+                const float bottomValue = fetch(x0, y0 + 1) + (fetch(x0 + 1, y0 + 1) - fetch(x0, y0 + 1)) * fx;
+                const float value = topValue + (bottomValue - topValue) * fy;
+
+                // Signed distance in display pixels, positive inside, a one pixel wide ramp centered on the edge.
+                const float distance = (value - 128.0f) * distanceScale + dilation;
+                fCoverage[static_cast<size_t>(y) * width + x] = static_cast<uint8_t>(std::clamp(distance + 0.5f, 0.0f, 1.0f) * 255.0f + 0.5f);
+            }
+        }
+
+        FT_Bitmap bitmap{};
+        bitmap.rows = height;
+        bitmap.width = width;
+        bitmap.pitch = static_cast<int>(width);
+        bitmap.buffer = fCoverage.data();
+        bitmap.num_grays = 256;
+        bitmap.pixel_mode = FT_PIXEL_MODE_GRAY;
+        canvas.AccumulateBitmap(layer, bitmap, left, top, colorIndex);
+    }
+    LLUTILS_DISABLE_WARNING_POP
+}
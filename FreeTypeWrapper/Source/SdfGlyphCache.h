@@ -0,0 +1,82 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory_resource>
+#include <tuple>
+#include <vector>
+#include <FreeTypeHeaders.h>
+#include "CoverageCanvas.h"
+
+namespace FreeType
+{
+    // Signed distance fields of glyphs, generated by FreeType's sdf renderers at a few fixed pixel sizes. A field rendered
+    // at one size bucket is resampled to draw the glyph at any nearby display size, with or without an outline, so
+    // changing the text size doesn't render glyphs again. The least recently used fields are evicted past the budget.
+    class SdfGlyphCache
+    {
+    public:
+        // Distance range stored in the fields, in pixels of the size bucket. Outlines are limited to Spread * scale.
+        static constexpr uint32_t Spread = 16;
+
+        struct Glyph
+        {
+            // Position of the field's top left corner relative to the glyph origin, y up, in pixels of the size bucket.
+            int32_t left{};
+            int32_t top{};
+            uint32_t width{};
+            uint32_t height{};
+            uint32_t bucketSize{};
+            // Distance of each pixel center to the outline, 128 on the outline, higher inside.
+            std::pmr::vector<uint8_t> distances;
+        };
+
+        static constexpr size_t DefaultMaxBytes = 16 * 1024 * 1024;
+
+        SdfGlyphCache(FT_Library library, std::pmr::memory_resource* memoryResource, size_t maxBytes = DefaultMaxBytes);
+
+        // Pixel size fields are rendered at for text of pixelSize pixels per em.
+        static uint32_t GetBucketSize(float pixelSize);
+
+        // Field of a glyph at a size bucket, rendered on first use. The face's active size is kept.
+        // The field is valid until the next call.
+        const Glyph& GetGlyph(FT_Face face, FT_UInt glyphIndex, uint32_t bucketSize);
+
+        // Resamples a field to 8 bit coverage and accumulates it into a canvas layer. scaleX / scaleY are display pixels
+        // per bucket pixel, pixels within 'dilation' display pixels outside the glyph are covered too, e.g. for outlines.
+        void Rasterize(const Glyph& glyph, CoverageCanvas& canvas, CoverageCanvas::Layer layer, float scaleX, float scaleY
+            , float dilation, int32_t originX, int32_t baselineY, uint8_t colorIndex);
+
+        // Drops the fields and sizes of a face, before the face is released.
+        void ReleaseFace(FT_Face face);
+
+        size_t GetGlyphCount() const { return fGlyphs.size(); }
+        // Bytes of distances kept.
+        size_t GetSize() const { return fBytes; }
+
+    private:
+        FT_Size GetBucketFTSize(FT_Face face, uint32_t bucketSize);
+
+    private:
+        using GlyphKey = std::tuple<FT_Face, FT_UInt, uint32_t>;
+        using SizeKey = std::tuple<FT_Face, uint32_t>;
+
+        struct Entry
+        {
+            Glyph glyph;
+            std::pmr::list<GlyphKey>::iterator lruPosition;
+        };
+
+        FT_Library fLibrary;
+        std::pmr::memory_resource* fMemoryResource;
+        size_t fMaxBytes;
+        size_t fBytes = 0;
+        std::pmr::map<GlyphKey, Entry> fGlyphs;
+        // Most recently used first.
+        std::pmr::list<GlyphKey> fLru;
+        // Size objects are owned and released by their faces.
+        std::pmr::map<SizeKey, FT_Size> fSizes;
+        std::pmr::vector<uint8_t> fCoverage;
+    };
+}
@@ -0,0 +1,97 @@
+#include "ShelfPacker.h"
+#include <algorithm>
+
+namespace FreeType
+{
+    ShelfPacker::ShelfPacker(uint32_t width, uint32_t height, uint32_t spacing, std::pmr::memory_resource* memoryResource)
+        : fWidth(width)
+        , fHeight(height)
+        , fSpacing(spacing)
+        , fShelves(memoryResource)
+    {
+
+    }
+
+    bool ShelfPacker::Pack(uint32_t width, uint32_t height, uint32_t& out_x, uint32_t& out_y)
+    {
+        // The spacing right of the last rectangle of a shelf may fall outside the area.
+        const uint64_t paddedWidth = static_cast<uint64_t>(width) + fSpacing;
+        const uint64_t paddedHeight = static_cast<uint64_t>(height) + fSpacing;
+        if (width > fWidth)
+            return false;
+
+        const auto fits = [&](const Gap& gap) { return gap.width >= paddedWidth || (gap.x + gap.width == fWidth && gap.width >= width); };
+
+        // The lowest existing shelf with room, the least height is wasted there.
+        Shelf* best = nullptr;
+        Gap* bestGap = nullptr;
+        for (Shelf& shelf : fShelves)
+        {
+            if (shelf.height < paddedHeight || (best != nullptr && shelf.height >= best->height))
+                continue;
+            if (auto gap = std::find_if(shelf.gaps.begin(), shelf.gaps.end(), fits); gap != shelf.gaps.end())
+            {
+                best = &shelf;
+                bestGap = &*gap;
+            }
+        }
+
+        if (best == nullptr)
+        {
+            const uint64_t y = fShelves.empty() ? 0 : static_cast<uint64_t>(fShelves.back().y) + fShelves.back().height;
+            if (y + height > fHeight)
+                return false;
+            fShelves.push_back({ static_cast<uint32_t>(y), static_cast<uint32_t>(paddedHeight), std::pmr::vector<Gap>(fShelves.get_allocator()) });
+            best = &fShelves.back();
+            best->gaps.push_back({ 0, fWidth });
+            bestGap = &best->gaps.front();
+        }
+
+        out_x = bestGap->x;
+        out_y = best->y;
+        const uint32_t usedWidth = static_cast<uint32_t>(std::min<uint64_t>(paddedWidth, bestGap->width));
+        bestGap->x += usedWidth;
+        bestGap->width -= usedWidth;
+        if (bestGap->width == 0)
+            best->gaps.erase(best->gaps.begin() + (bestGap - best->gaps.data()));
+        return true;
+    }
+
+    void ShelfPacker::Free(uint32_t x, uint32_t y, uint32_t width)
+    {
+        auto shelf = std::find_if(fShelves.begin(), fShelves.end(), [y](const Shelf& s) { return s.y == y; });
+        if (shelf == fShelves.end())
+            return;
+
+        const uint32_t usedWidth = static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(width) + fSpacing, fWidth - x));
+        auto& gaps = shelf->gaps;
+        auto next = std::lower_bound(gaps.begin(), gaps.end(), x, [](const Gap& gap, uint32_t value) { return gap.x < value; });
+        next = gaps.insert(next, { x, usedWidth });
+
+        // Merge with the following gap, then with the preceding one.
+        if (next + 1 != gaps.end() && next->x + next->width == (next + 1)->x)
+        {
+            next->width += (next + 1)->width;
+            gaps.erase(next + 1);
+        }
+        if (next != gaps.begin() && (next - 1)->x + (next - 1)->width == next->x)
+        {
+            (next - 1)->width += next->width;
+            gaps.erase(next);
+        }
+
+        // Empty shelves at the bottom are given back, they may be needed at another height.
+        while (fShelves.empty() == false && fShelves.back().gaps.size() == 1 && fShelves.back().gaps.front().width == fWidth)
+            fShelves.pop_back();
+    }
+
+    uint32_t ShelfPacker::GetUsedHeight() const
+    {
+        return fShelves.empty() ? 0 : fShelves.back().y + fShelves.back().height - fSpacing;
+    }
+
+    void ShelfPacker::Clear()
+    {
+        fShelves.clear();
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+namespace FreeType
+{
+    // Packs rectangles into horizontal shelves of a fixed width area. A shelf is as tall as the first rectangle placed on
+    // it, rectangles go to the lowest shelf they fit in, so packing them tallest first wastes little space. Freed
+    // rectangles leave a gap on their shelf for later rectangles, an empty last shelf is removed.
+    class ShelfPacker
+    {
+    public:
+        // 'spacing' empty pixels are kept right of and below every rectangle.
+        ShelfPacker(uint32_t width, uint32_t height, uint32_t spacing, std::pmr::memory_resource* memoryResource);
+
+        // Returns false when the rectangle doesn't fit.
+        bool Pack(uint32_t width, uint32_t height, uint32_t& out_x, uint32_t& out_y);
+
+        // Frees a rectangle returned by Pack, with the width it was packed with.
+        void Free(uint32_t x, uint32_t y, uint32_t width);
+
+        // Height of all shelves, excluding the spacing below the last one.
+        uint32_t GetUsedHeight() const;
+
+        void Clear();
+
+    private:
+        // A free horizontal range of a shelf.
+        struct Gap
+        {
+            uint32_t x;
+            uint32_t width;
+        };
+
+        struct Shelf
+        {
+            uint32_t y;
+            uint32_t height;
+            // Sorted by x, adjacent gaps are merged.
+            std::pmr::vector<Gap> gaps;
+        };
+
+        uint32_t fWidth;
+        uint32_t fHeight;
+        uint32_t fSpacing;
+        std::pmr::vector<Shelf> fShelves;
+    };
+}
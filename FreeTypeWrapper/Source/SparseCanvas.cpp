@@ -0,0 +1,86 @@
+#include "SparseCanvas.h"
+#include "PixelKernels.h"
+#include <algorithm>
+#include <LLUtils/Exception.h>
+
+namespace FreeType
+{
+    SparseCanvas::SparseCanvas(std::byte* buffer, uint32_t width, uint32_t height, LLUtils::ColorF32 background
+        , std::pmr::memory_resource* memoryResource)
+        : fBox{ buffer, width * static_cast<uint32_t>(sizeof(LLUtils::ColorF32)), width, height, 0, 0, static_cast<uint32_t>(sizeof(LLUtils::ColorF32)) }
+        , fBackground(background)
+        , fTilesX((width + TileSize - 1) / TileSize)
+        , fTilesY((height + TileSize - 1) / TileSize)
+        , fDirty(static_cast<size_t>(fTilesX) * fTilesY, uint8_t{ 0 }, memoryResource)
+    {
+
+    }
+
+    LLUTILS_DISABLE_WARNING_PUSH
+    LLUTILS_DISABLE_WARNING_UNSAFE_BUFFER_USAGE
+    void SparseCanvas::Touch(int32_t left, int32_t top, int32_t width, int32_t height)
+    {
+        const int32_t right = std::min(left + width, static_cast<int32_t>(fBox.width));
+        const int32_t bottom = std::min(top + height, static_cast<int32_t>(fBox.height));
+        left = std::max(left, 0);
+        top = std::max(top, 0);
+
+        if (left >= right || top >= bottom)
+            return;
+
+        const PixelKernels::KernelTable& kernels = PixelKernels::GetKernels();
+        const uint32_t lastTileX = static_cast<uint32_t>(right - 1) / TileSize;
+        const uint32_t lastTileY = static_cast<uint32_t>(bottom - 1) / TileSize;
+
+        for (uint32_t tileY = static_cast<uint32_t>(top) / TileSize; tileY <= lastTileY; tileY++)
+        {
+            for (uint32_t tileX = static_cast<uint32_t>(left) / TileSize; tileX <= lastTileX; tileX++)
+            {
+                uint8_t& dirty = fDirty[tileY * fTilesX + tileX];
+                if (dirty != 0)
+                    continue;
+
+                dirty = 1;
+                const uint32_t beginX = tileX * TileSize;
+                const uint32_t beginY = tileY * TileSize;
+                const uint32_t tileWidth = GetTileWidth(tileX);
+                const uint32_t tileHeight = GetTileHeight(tileY);
+
+                for (uint32_t y = beginY; y < beginY + tileHeight; y++)
+                    kernels.fill(GetRow(y) + beginX, fBackground, tileWidth);
+            }
+        }
+    }
+
+    void SparseCanvas::BlendOnto(SparseCanvas& dest) const
+    {
+        if (dest.fBox.width != fBox.width || dest.fBox.height != fBox.height)
+            LL_EXCEPTION(LLUtils::Exception::ErrorCode::LogicError, "Canvas size mismatch");
+
+        const PixelKernels::KernelTable& kernels = PixelKernels::GetKernels();
+
+        for (uint32_t tileY = 0; tileY < fTilesY; tileY++)
+        {
+            for (uint32_t tileX = 0; tileX < fTilesX; tileX++)
+            {
+                if (IsDirty(tileX, tileY) == false)
+                    continue;
+
+                const uint32_t beginX = tileX * TileSize;
+                const uint32_t beginY = tileY * TileSize;
+                const uint32_t tileWidth = GetTileWidth(tileX);
+                const uint32_t tileHeight = GetTileHeight(tileY);
+                dest.Touch(static_cast<int32_t>(beginX), static_cast<int32_t>(beginY), static_cast<int32_t>(tileWidth), static_cast<int32_t>(tileHeight));
+
+                for (uint32_t y = beginY; y < beginY + tileHeight; y++)
+                    kernels.blendPremultiplied(dest.GetRow(y) + beginX, GetRow(y) + beginX, tileWidth);
+            }
+        }
+    }
+    LLUTILS_DISABLE_WARNING_POP
+
+    size_t SparseCanvas::GetDirtyTileCount() const
+    {
+        return static_cast<size_t>(std::count(fDirty.begin(), fDirty.end(), uint8_t{ 1 }));
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <memory_resource>
+#include <vector>
+#include <LLUtils/Color.h>
+#include <LLUtils/Warnings.h>
+#include "BlitBox.h"
+
+namespace FreeType
+{
+    // A premultiplied ColorF32 canvas split into square tiles. A tile is filled with the background color only when
+    // something is about to be drawn into it, untouched tiles are known to hold the background so merging and resolving
+    // can skip reading them. The canvas doesn't own its pixels.
+    class SparseCanvas
+    {
+    public:
+        static constexpr uint32_t TileSize = 32;
+
+        SparseCanvas(std::byte* buffer, uint32_t width, uint32_t height, LLUtils::ColorF32 background
+            , std::pmr::memory_resource* memoryResource = std::pmr::get_default_resource());
+
+        // Fills the not yet drawn tiles intersecting the rectangle, must be called before drawing into it.
+        // The rectangle is clipped to the canvas.
+        void Touch(int32_t left, int32_t top, int32_t width, int32_t height);
+
+        // Blends the drawn tiles of this canvas onto dest, tiles never drawn to are fully transparent or hold the
+        // background and are skipped. Both canvases must have the same size.
+        void BlendOnto(SparseCanvas& dest) const;
+
+        // Resolves every pixel to 8 bit, drawn tiles with resolveRow(dest, source, count) and the rest with the resolved background.
+        template <typename resolve_row_func>
+        void Resolve(LLUtils::Color* dest, resolve_row_func resolveRow) const;
+
+        BlitBox GetBlitBox() const { return fBox; }
+        size_t GetDirtyTileCount() const;
+
+    private:
+        bool IsDirty(uint32_t tileX, uint32_t tileY) const { return fDirty[tileY * fTilesX + tileX] != 0; }
+        LLUtils::ColorF32* GetRow(uint32_t y) const { return reinterpret_cast<LLUtils::ColorF32*>(fBox.buffer + static_cast<size_t>(y) * fBox.rowPitch); }
+        uint32_t GetTileWidth(uint32_t tileX) const { return std::min(TileSize, fBox.width - tileX * TileSize); }
+        uint32_t GetTileHeight(uint32_t tileY) const { return std::min(TileSize, fBox.height - tileY * TileSize); }
+
+    private:
+        BlitBox fBox;
+        LLUtils::ColorF32 fBackground;
+        uint32_t fTilesX;
+        uint32_t fTilesY;
+        std::pmr::vector<uint8_t> fDirty;
+    };
+
+    LLUTILS_DISABLE_WARNING_PUSH
+    LLUTILS_DISABLE_WARNING_UNSAFE_BUFFER_USAGE
+    template <typename resolve_row_func>
+    void SparseCanvas::Resolve(LLUtils::Color* dest, resolve_row_func resolveRow) const
+    {
+        LLUtils::Color resolvedBackground;
+        resolveRow(&resolvedBackground, &fBackground, 1);
+
+        for (uint32_t y = 0; y < fBox.height; y++)
+        {
+            const LLUtils::ColorF32* sourceRow = GetRow(y);
+            LLUtils::Color* destRow = dest + static_cast<size_t>(y) * fBox.width;
+            const uint32_t tileY = y / TileSize;
+
+            for (uint32_t tileX = 0; tileX < fTilesX; tileX++)
+            {
+                const uint32_t begin = tileX * TileSize;
+                const uint32_t end = begin + GetTileWidth(tileX);
+
+                if (IsDirty(tileX, tileY))
+                {
+                    resolveRow(destRow + begin, sourceRow + begin, end - begin);
+                }
+                else
+                {
+                    std::fill(destRow + begin, destRow + end, resolvedBackground);
+                }
+            }
+        }
+    }
+    LLUTILS_DISABLE_WARNING_POP
+}
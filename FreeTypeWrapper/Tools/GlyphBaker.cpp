@@ -0,0 +1,251 @@
+// Bakes glyphs of a font into a C++ source file, drawn at runtime by FreeType::BakedTextRenderer without FreeType.
+// Used by the freetype_wrapper_bake_font CMake function.
+//
+// FreeTypeGlyphBaker --font <path> --name <identifier> --output <directory> --sizes 11,16 [--dpi 96[,96]]
+//     [--characters 0x20-0x7E,0xA0-0xFF] [--mode antialiased|aliased]
+//
+// Writes <directory>/<identifier>.h declaring 'extern const FreeType::BakedFont <identifier>[]', one font per size in
+// the given order, and <identifier>.cpp holding the glyph tables.
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <FreeTypeWrapper/FreeTypeConnector.h>
+
+namespace
+{
+    struct Options
+    {
+        std::filesystem::path fontPath;
+        std::string name;
+        std::filesystem::path outputDirectory;
+        std::vector<uint16_t> sizes;
+        uint16_t DPIx = 96;
+        uint16_t DPIy = 96;
+        std::wstring characters;
+        FreeType::RenderMode renderMode = FreeType::RenderMode::Antialiased;
+    };
+
+    std::vector<std::string> Split(const std::string& value, char separator)
+    {
+        std::vector<std::string> parts;
+        std::stringstream stream(value);
+        for (std::string part; std::getline(stream, part, separator);)
+            if (part.empty() == false)
+                parts.push_back(part);
+        return parts;
+    }
+
+    uint32_t ParseNumber(const std::string& value, uint32_t maxValue)
+    {
+        size_t end = 0;
+        const unsigned long number = std::stoul(value, &end, 0);
+        if (end != value.size() || number > maxValue)
+            throw std::invalid_argument("invalid number '" + value + "'");
+        return static_cast<uint32_t>(number);
+    }
+
+    Options ParseOptions(int argc, char* argv[])
+    {
+        Options options;
+        std::string characters = "0x20-0x7E";
+        for (int i = 1; i < argc; i += 2)
+        {
+            const std::string option = argv[i];
+            if (i + 1 == argc)
+                throw std::invalid_argument("option '" + option + "' needs a value");
+            const std::string value = argv[i + 1];
+            if (option == "--font")
+            {
+                options.fontPath = value;
+            }
+            else if (option == "--name")
+            {
+                options.name = value;
+            }
+            else if (option == "--output")
+            {
+                options.outputDirectory = value;
+            }
+            else if (option == "--sizes")
+            {
+                for (const std::string& size : Split(value, ','))
+                {
+                    // Each size names its own arrays in the generated source.
+                    const uint16_t fontSize = static_cast<uint16_t>(ParseNumber(size, std::numeric_limits<uint16_t>::max()));
+                    if (std::find(options.sizes.begin(), options.sizes.end(), fontSize) != options.sizes.end())
+                        throw std::invalid_argument("size " + size + " is given more than once");
+                    options.sizes.push_back(fontSize);
+                }
+            }
+            else if (option == "--dpi")
+            {
+                const std::vector<std::string> dpi = Split(value, ',');
+                if (dpi.empty() || dpi.size() > 2)
+                    throw std::invalid_argument("--dpi takes one or two values");
+                options.DPIx = static_cast<uint16_t>(ParseNumber(dpi.front(), std::numeric_limits<uint16_t>::max()));
+                options.DPIy = static_cast<uint16_t>(ParseNumber(dpi.back(), std::numeric_limits<uint16_t>::max()));
+            }
+            else if (option == "--characters")
+            {
+                characters = value;
+            }
+            else if (option == "--mode")
+            {
+                if (value == "aliased")
+                    options.renderMode = FreeType::RenderMode::Aliased;
+                else if (value != "antialiased")
+                    throw std::invalid_argument("--mode is either antialiased or aliased");
+            }
+            else
+            {
+                throw std::invalid_argument("unknown option '" + option + "'");
+            }
+        }
+
+        if (options.fontPath.empty() || options.name.empty() || options.outputDirectory.empty() || options.sizes.empty())
+            throw std::invalid_argument("--font, --name, --output and --sizes are required");
+
+        // Codepoint ranges, e.g. 0x20-0x7E,0xB0. Surrogates can't be converted from wide strings on every platform.
+        for (const std::string& range : Split(characters, ','))
+        {
+            const std::vector<std::string> bounds = Split(range, '-');
+            if (bounds.empty() || bounds.size() > 2)
+                throw std::invalid_argument("invalid character range '" + range + "'");
+            const uint32_t first = ParseNumber(bounds.front(), 0x10FFFF);
+            const uint32_t last = ParseNumber(bounds.back(), 0x10FFFF);
+            for (uint32_t codepoint = first; codepoint <= last; codepoint++)
+            {
+                if (codepoint >= 0xD800 && codepoint <= 0xDFFF)
+                    continue;
+                if constexpr (sizeof(wchar_t) == 2)
+                {
+                    if (codepoint >= 0x10000)
+                    {
+                        options.characters.push_back(static_cast<wchar_t>(0xD800 + ((codepoint - 0x10000) >> 10)));
+                        options.characters.push_back(static_cast<wchar_t>(0xDC00 + ((codepoint - 0x10000) & 0x3FF)));
+                        continue;
+                    }
+                }
+                options.characters.push_back(static_cast<wchar_t>(codepoint));
+            }
+        }
+
+        return options;
+    }
+
+    template <typename T>
+    T CheckedCast(int64_t value, const char* what)
+    {
+        if (value < std::numeric_limits<T>::min() || value > std::numeric_limits<T>::max())
+            throw std::out_of_range(std::string(what) + " doesn't fit a baked font, bake smaller sizes or fewer characters");
+        return static_cast<T>(value);
+    }
+
+    void WriteFont(std::ostream& source, const std::string& suffix, const FreeType::FreeTypeConnector::CoverageAtlas& atlas)
+    {
+        const auto* pixels = reinterpret_cast<const uint8_t*>(atlas.bitmap.buffer.data());
+        source << "    constexpr uint8_t Pixels" << suffix << "[] =\n    {";
+        for (uint32_t y = 0; y < atlas.bitmap.height; y++)
+        {
+            for (uint32_t x = 0; x < atlas.bitmap.width; x++)
+            {
+                if (x % 32 == 0)
+                    source << "\n        ";
+                source << static_cast<unsigned>(pixels[static_cast<size_t>(y) * atlas.bitmap.rowPitch + x]) << ',';
+            }
+        }
+        source << "\n    };\n\n";
+
+        source << "    constexpr FreeType::BakedGlyph Glyphs" << suffix << "[] =\n    {\n";
+        for (const FreeType::FreeTypeConnector::CoverageGlyph& glyph : atlas.glyphs)
+        {
+            source << "        { " << static_cast<uint32_t>(glyph.codepoint)
+                << ", " << CheckedCast<uint16_t>(glyph.atlasX, "atlas")
+                << ", " << CheckedCast<uint16_t>(glyph.atlasY, "atlas")
+                << ", " << CheckedCast<uint16_t>(glyph.width, "glyph width")
+                << ", " << CheckedCast<uint16_t>(glyph.height, "glyph height")
+                << ", " << CheckedCast<int16_t>(glyph.left, "glyph position")
+                << ", " << CheckedCast<int16_t>(glyph.top, "glyph position")
+                << ", " << CheckedCast<int16_t>(glyph.advance, "glyph advance") << " },\n";
+        }
+        source << "    };\n\n";
+    }
+
+    void WriteFile(const std::filesystem::path& path, const std::string& content)
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << content;
+        if (file.flush().fail())
+            throw std::runtime_error("unable to write " + path.string());
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        const Options options = ParseOptions(argc, argv);
+        FreeType::FreeTypeConnector freeType;
+
+        std::ostringstream source;
+        source << "// Generated by FreeTypeGlyphBaker from " << options.fontPath.filename().string() << ", don't edit.\n"
+            << "#include \"" << options.name << ".h\"\n\nnamespace\n{\n";
+
+        std::ostringstream fonts;
+        for (const uint16_t size : options.sizes)
+        {
+            FreeType::CoverageAtlasParams params;
+            params.fontPath = options.fontPath.wstring();
+            params.characters = options.characters;
+            params.fontSize = size;
+            params.DPIx = options.DPIx;
+            params.DPIy = options.DPIy;
+            params.renderMode = options.renderMode;
+
+            FreeType::FreeTypeConnector::CoverageAtlas atlas;
+            freeType.CreateCoverageAtlas(params, atlas);
+
+            const std::string suffix = std::to_string(size);
+            WriteFont(source, suffix, atlas);
+            fonts << "    { " << size << ", " << options.DPIx << ", " << options.DPIy
+                << ", " << CheckedCast<uint16_t>(atlas.lineHeight, "line height")
+                << ", " << CheckedCast<int16_t>(atlas.baseline, "baseline")
+                << ", " << CheckedCast<uint16_t>(atlas.bitmap.width, "atlas")
+                << ", " << CheckedCast<uint16_t>(atlas.bitmap.height, "atlas")
+                << ", Pixels" << suffix << ", Glyphs" << suffix << " },\n";
+            freeType.ReleaseBitmap(atlas.bitmap);
+        }
+
+        source << "}\n\nextern const FreeType::BakedFont " << options.name << "[] =\n{\n" << fonts.str() << "};\n";
+
+        std::ostringstream header;
+        header << "// Generated by FreeTypeGlyphBaker from " << options.fontPath.filename().string() << ", don't edit.\n"
+            << "#pragma once\n#include <FreeTypeWrapper/BakedFont.h>\n\n"
+            << "// One font per baked size:";
+        for (const uint16_t size : options.sizes)
+            header << ' ' << size;
+        header << ".\nextern const FreeType::BakedFont " << options.name << '[' << options.sizes.size() << "];\n";
+
+        std::filesystem::create_directories(options.outputDirectory);
+        WriteFile(options.outputDirectory / (options.name + ".h"), header.str());
+        WriteFile(options.outputDirectory / (options.name + ".cpp"), source.str());
+    }
+    catch (const std::exception& exception)
+    {
+        std::cerr << "FreeTypeGlyphBaker: " << exception.what() << std::endl;
+        return 1;
+    }
+    catch (...)
+    {
+        std::cerr << "FreeTypeGlyphBaker: unable to bake the font" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,213 @@
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <FreeTypeWrapper/FreeTypeConnector.h>
+#include <FreeTypeWrapper/BitmapFile.h>
+#include <FreeTypeWrapper/CpuDispatch.h>
+#include <LLUtils/Colors.h>
+
+using Clock = std::chrono::steady_clock;
+
+const std::wstring fontPath = L"./CascadiaCode.ttf";
+
+FreeType::TextCreateParams GetLabelParams()
+{
+	FreeType::TextCreateParams params{};
+	params.fontPath = fontPath;
+	params.text = L"Texel: 1218.3 X  584.6";
+	params.textColor = LLUtils::Colors::Black;
+	params.backgroundColor = LLUtils::Colors::White;
+	params.fontSize = 11;
+	params.renderMode = FreeType::RenderMode::Antialiased;
+	params.DPIx = 120;
+	params.DPIy = 120;
+	return params;
+}
+
+// Startup cost of a short lived worker: create a connector, load a font and render a single label.
+void BenchmarkStartup(const std::string& name, FreeType::FreeTypeModules modules, int iterations)
+{
+	using namespace FreeType;
+	const TextCreateParams params = GetLabelParams();
+	FreeTypeMemoryStats memoryStats{};
+
+	const auto start = Clock::now();
+	for (int i = 0; i < iterations; i++)
+	{
+		FreeTypeConnector freeType(ConnectorCreateParams{ std::pmr::get_default_resource(), modules });
+		FreeTypeConnector::Bitmap bitmap;
+		freeType.CreateBitmap(params, bitmap, nullptr);
+		memoryStats = freeType.GetFreeTypeMemoryStats();
+	}
+	const auto elapsed = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+	std::cout << name << ": " << elapsed / iterations << " us per startup, "
+		<< memoryStats.peakBytesInUse / 1024 << " KB peak FreeType memory, "
+		<< memoryStats.totalAllocations << " FreeType allocations" << std::endl;
+}
+
+// Rendering cost of a single label with a warm connector.
+void BenchmarkRender(const std::string& name, const FreeType::TextCreateParams& params, int iterations)
+{
+	using namespace FreeType;
+	FreeTypeConnector freeType;
+	FreeTypeConnector::Bitmap bitmap;
+	freeType.CreateBitmap(params, bitmap, nullptr);
+
+	const auto start = Clock::now();
+	for (int i = 0; i < iterations; i++)
+		freeType.CreateBitmap(params, bitmap, nullptr);
+	const auto elapsed = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+	std::cout << name << " " << bitmap.width << "x" << bitmap.height << ": " << elapsed / iterations << " us per render" << std::endl;
+}
+
+// Recoloring a label rendered once as coverage, e.g. for hover and pressed states.
+void BenchmarkColorize(const std::string& name, const FreeType::TextCreateParams& params, int iterations)
+{
+	using namespace FreeType;
+	FreeTypeConnector freeType;
+	FreeTypeConnector::TextCoverage coverage;
+	FreeTypeConnector::Bitmap bitmap;
+	freeType.CreateCoverage(params, coverage);
+
+	const auto start = Clock::now();
+	for (int i = 0; i < iterations; i++)
+	{
+		const uint8_t shade = static_cast<uint8_t>(i);
+		freeType.Colorize(coverage, { LLUtils::Color(shade, shade, shade), params.outlineColor, params.backgroundColor }, bitmap);
+	}
+	const auto elapsed = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+	std::cout << name << " " << bitmap.width << "x" << bitmap.height << ": " << elapsed / iterations << " us per colorize" << std::endl;
+}
+
+// Zooming a label through a range of sizes, every render is at a size not drawn in the previous one.
+void BenchmarkZoom(const std::string& name, FreeType::TextCreateParams params, int iterations)
+{
+	using namespace FreeType;
+	FreeTypeConnector freeType;
+	FreeTypeConnector::Bitmap bitmap;
+	constexpr uint16_t minSize = 10;
+	constexpr uint16_t maxSize = 40;
+
+	const auto start = Clock::now();
+	for (int i = 0; i < iterations; i++)
+	{
+		params.fontSize = static_cast<uint16_t>(minSize + i % (maxSize - minSize + 1));
+		freeType.CreateBitmap(params, bitmap, nullptr);
+	}
+	const auto elapsed = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+	std::cout << name << " " << minSize << "-" << maxSize << "pt: " << elapsed / iterations << " us per render" << std::endl;
+}
+
+// Generating an atlas of the printable ASCII characters.
+void BenchmarkMsdfAtlas(const std::string& name, uint32_t maxThreads, int iterations)
+{
+	using namespace FreeType;
+	FreeTypeConnector freeType;
+	FreeTypeConnector::MsdfAtlas atlas;
+	MsdfAtlasParams params;
+	params.fontPath = fontPath;
+	for (wchar_t character = L' '; character <= L'~'; character++)
+		params.characters += character;
+	params.maxThreads = maxThreads;
+
+	const auto start = Clock::now();
+	for (int i = 0; i < iterations; i++)
+		freeType.CreateMsdfAtlas(params, atlas);
+	const auto elapsed = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	std::cout << name << " " << atlas.bitmap.width << "x" << atlas.bitmap.height << ": " << elapsed / iterations << " ms per atlas" << std::endl;
+}
+
+// Saving a large capture, e.g. a golden image dump, as a bitmap file or as a QOI image with the given threads.
+void BenchmarkSaveToFile(const std::string& name, FreeType::StreamFormat format, uint32_t qoiThreads, int iterations)
+{
+	using namespace FreeType;
+	constexpr uint32_t width = 2048;
+	constexpr uint32_t height = 1024;
+	std::vector<LLUtils::Color> pixels(static_cast<size_t>(width) * height, LLUtils::Colors::White);
+	Bitmap bitmap(BitmapBuffer{ reinterpret_cast<const std::byte*>(pixels.data()), 32, width, height, width * 4 });
+	// Text on a flat background, a label every 64 rows.
+	for (uint32_t y = 0; y < height; y += 64)
+		for (uint32_t x = 0; x < width; x++)
+			pixels[static_cast<size_t>(y + (x * 7) % 16) * width + x] = LLUtils::Color(static_cast<uint8_t>(x), uint8_t{ 0 }, uint8_t{ 0 });
+	const std::filesystem::path filePath = std::filesystem::temp_directory_path() / "FreeTypeWrapperBenchmark.bin";
+
+	const auto start = Clock::now();
+	for (int i = 0; i < iterations; i++)
+	{
+		if (qoiThreads != 0)
+			bitmap.SaveToQoiFile(filePath.wstring(), qoiThreads);
+		else
+			bitmap.SaveToFile(filePath.wstring(), format);
+	}
+	const auto elapsed = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	const auto fileSize = std::filesystem::file_size(filePath);
+	std::filesystem::remove(filePath);
+
+	std::cout << name << " " << width << "x" << height << ": " << elapsed / iterations << " ms, " << fileSize / 1024 << " KB per file" << std::endl;
+}
+
+int main()
+{
+	try
+	{
+		constexpr int iterations = 200;
+		BenchmarkStartup("All modules", FreeType::FreeTypeModules::All, iterations);
+		BenchmarkStartup("Minimal modules", FreeType::FreeTypeModules::Minimal, iterations);
+
+		// A wide label that is mostly empty space, only a few canvas tiles are drawn into.
+		FreeType::TextCreateParams sparseLabel = GetLabelParams();
+		sparseLabel.text = L"[" + std::wstring(160, L' ') + L"]";
+		sparseLabel.outlineWidth = 2;
+		sparseLabel.outlineColor = LLUtils::Colors::White;
+		BenchmarkRender("Sparse label", sparseLabel, iterations);
+
+		FreeType::TextCreateParams outlinedLabel = GetLabelParams();
+		outlinedLabel.fontSize = 30;
+		outlinedLabel.outlineWidth = 2;
+		outlinedLabel.outlineColor = LLUtils::Colors::White;
+		BenchmarkRender("Outlined label", outlinedLabel, iterations);
+		outlinedLabel.flags = outlinedLabel.flags | FreeType::TextCreateFlags::FusedCompositing;
+		BenchmarkRender("Outlined label, fused compositing", outlinedLabel, iterations);
+		BenchmarkColorize("Outlined label, recolored coverage", outlinedLabel, iterations);
+		outlinedLabel.bitmapFormat = FreeType::BitmapFormat::A8;
+		BenchmarkRender("Outlined label, A8 coverage mask", outlinedLabel, iterations);
+		outlinedLabel.bitmapFormat = FreeType::BitmapFormat::RGBA;
+
+		BenchmarkZoom("Outlined label zoom, antialiased", outlinedLabel, iterations);
+		outlinedLabel.renderMode = FreeType::RenderMode::SignedDistanceField;
+		BenchmarkZoom("Outlined label zoom, signed distance fields", outlinedLabel, iterations);
+		outlinedLabel.renderMode = FreeType::RenderMode::Antialiased;
+
+		BenchmarkMsdfAtlas("MSDF atlas, 1 thread", 1, 5);
+		BenchmarkMsdfAtlas("MSDF atlas, all threads", 0, 5);
+
+		BenchmarkSaveToFile("Save bitmap, bottom-up", FreeType::StreamFormat::Bmp, 0, 10);
+		BenchmarkSaveToFile("Save bitmap, top-down", FreeType::StreamFormat::BmpTopDown, 0, 10);
+		BenchmarkSaveToFile("Save QOI, 1 thread", FreeType::StreamFormat::Bmp, 1, 10);
+		BenchmarkSaveToFile("Save QOI, 4 threads", FreeType::StreamFormat::Bmp, 4, 10);
+
+		// The sparse label again at every instruction set level this machine supports.
+		using FreeType::CpuDispatch;
+		const FreeType::CpuLevel activeLevel = CpuDispatch::GetActiveLevel();
+		for (uint8_t level = 0; level <= static_cast<uint8_t>(CpuDispatch::GetSupportedLevel()); level++)
+		{
+			CpuDispatch::SetActiveLevel(static_cast<FreeType::CpuLevel>(level));
+			BenchmarkRender(std::string("Sparse label, ") + CpuDispatch::GetLevelName(CpuDispatch::GetActiveLevel()), sparseLabel, iterations);
+		}
+		CpuDispatch::SetActiveLevel(activeLevel);
+	}
+	catch (...)
+	{
+		std::cout << "Benchmark failed.";
+		return 1;
+	}
+
+	return 0;
+}
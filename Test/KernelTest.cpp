@@ -0,0 +1,539 @@
+// Conformance and throughput of the pixel kernels.
+// Every instruction set level the build and the processor support is run on randomized rows and compared against the
+// scalar reference kernels. Integer kernels must match exactly, float kernels within one 8 bit level once resolved.
+// Glyphs rendered or blended by the specialized glyph kernels must match the per pixel reference implementation
+// exactly, with each level forced in turn.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <FreeTypeWrapper/CpuDispatch.h>
+#include "PixelKernels.h"
+#include "FreeTypeRenderer.h"
+#include "GammaTables.h"
+#include "SparseCanvas.h"
+
+using Clock = std::chrono::steady_clock;
+using LLUtils::Color;
+using LLUtils::ColorF32;
+using FreeType::PixelKernels::KernelTable;
+using FreeType::FreeTypeRenderer;
+
+std::mt19937 randomEngine(0x46545752);
+
+float RandomFloat()
+{
+	return std::uniform_real_distribution<float>(0.0f, 1.0f)(randomEngine);
+}
+
+uint8_t RandomByte()
+{
+	return static_cast<uint8_t>(std::uniform_int_distribution<int>(0, 255)(randomEngine));
+}
+
+size_t RandomSize(size_t min, size_t max)
+{
+	return std::uniform_int_distribution<size_t>(min, max)(randomEngine);
+}
+
+// A premultiplied pixel, with most of the alpha values coming from the edge cases the kernels have to handle.
+ColorF32 RandomPremultiplied()
+{
+	static constexpr float edgeAlphas[] = { 0.0f, 1.0f, 1.0f / 255.0f, 254.0f / 255.0f, 0.5f, 1e-6f };
+	const size_t choice = RandomSize(0, std::size(edgeAlphas) * 2);
+	const float alpha = choice < std::size(edgeAlphas) ? edgeAlphas[choice] : RandomFloat();
+
+	switch (RandomSize(0, 3))
+	{
+	case 0:
+		// Color as strong as alpha allows.
+		return { alpha, alpha, alpha, alpha };
+	case 1:
+		// Transparent black or rounding error slightly above alpha, resolving has to clamp it.
+		return { 0.0f, alpha * 1.0001f, std::min(alpha + 1e-7f, 1.0f), alpha };
+	default:
+		return { RandomFloat() * alpha, RandomFloat() * alpha, RandomFloat() * alpha, alpha };
+	}
+}
+
+// Row layouts to test, the first few widths cover every SIMD tail length.
+std::vector<size_t> GetWidths()
+{
+	std::vector<size_t> widths;
+	for (size_t width = 1; width <= 67; width++)
+		widths.push_back(width);
+	for (int i = 0; i < 16; i++)
+		widths.push_back(RandomSize(68, 1031));
+	return widths;
+}
+
+// A 2D buffer whose rows start at an odd element offset and have padding between them.
+// Padding holds a guard pattern so kernels writing past the end of a row are caught.
+template <typename T>
+struct PaddedBuffer
+{
+	size_t width;
+	size_t height;
+	size_t offset;
+	size_t pitch;
+	std::vector<T> data;
+
+	PaddedBuffer(size_t aWidth, size_t aHeight, T guard)
+		: width(aWidth), height(aHeight), offset(RandomSize(1, 3)), pitch(aWidth + RandomSize(1, 5))
+		, data(offset + pitch * aHeight, guard)
+	{
+	}
+
+	T* Row(size_t y) { return data.data() + offset + y * pitch; }
+	const T* Row(size_t y) const { return data.data() + offset + y * pitch; }
+};
+
+std::vector<const KernelTable*> GetLevels()
+{
+	std::vector<const KernelTable*> levels;
+	for (uint8_t level = 0; level <= static_cast<uint8_t>(FreeType::CpuLevel::AVX512); level++)
+		if (const KernelTable* kernels = FreeType::PixelKernels::GetKernels(static_cast<FreeType::CpuLevel>(level)); kernels != nullptr)
+			levels.push_back(kernels);
+	return levels;
+}
+
+void Fail(const KernelTable& kernels, const std::string& kernel, size_t width, const std::string& reason)
+{
+	throw std::runtime_error(std::string(FreeType::CpuDispatch::GetLevelName(kernels.level)) + " " + kernel
+		+ " differs from the scalar kernel at width " + std::to_string(width) + ", " + reason);
+}
+
+bool EqualBytes(const void* a, const void* b, size_t size)
+{
+	return std::memcmp(a, b, size) == 0;
+}
+
+// Float channels compared as the 8 bit values they resolve to.
+bool EqualWithinOneLevel(const ColorF32* a, const ColorF32* b, size_t count)
+{
+	const float* aFloats = reinterpret_cast<const float*>(a);
+	const float* bFloats = reinterpret_cast<const float*>(b);
+	for (size_t i = 0; i < count * 4; i++)
+		if (std::abs(std::lround(aFloats[i] * 255.0f) - std::lround(bFloats[i] * 255.0f)) > 1)
+			return false;
+	return true;
+}
+
+bool EqualWithinOneLevel(const Color* a, const Color* b, size_t count)
+{
+	const uint8_t* aBytes = reinterpret_cast<const uint8_t*>(a);
+	const uint8_t* bBytes = reinterpret_cast<const uint8_t*>(b);
+	for (size_t i = 0; i < count * 4; i++)
+		if (std::abs(static_cast<int>(aBytes[i]) - static_cast<int>(bBytes[i])) > 1)
+			return false;
+	return true;
+}
+
+// Runs a row kernel of the given level and of the scalar level on copies of the same destination,
+// then compares the rows and checks the padding around them is untouched.
+template <typename T, typename RunRow, typename CompareRow>
+void CompareRows(const KernelTable& kernels, const KernelTable& reference, const std::string& kernel
+	, const PaddedBuffer<T>& initialDest, RunRow runRow, CompareRow compareRow)
+{
+	PaddedBuffer<T> expected = initialDest;
+	PaddedBuffer<T> actual = initialDest;
+	for (size_t y = 0; y < initialDest.height; y++)
+	{
+		runRow(reference, expected.Row(y), y);
+		runRow(kernels, actual.Row(y), y);
+	}
+
+	for (size_t y = 0; y < initialDest.height; y++)
+	{
+		if (!compareRow(expected.Row(y), actual.Row(y), initialDest.width))
+			Fail(kernels, kernel, initialDest.width, "row " + std::to_string(y));
+
+		const T* padding = initialDest.Row(y) + initialDest.width;
+		const size_t paddingSize = initialDest.pitch - initialDest.width;
+		if (!EqualBytes(actual.Row(y) + initialDest.width, padding, paddingSize * sizeof(T)))
+			Fail(kernels, kernel, initialDest.width, "wrote past the end of row " + std::to_string(y));
+	}
+
+	if (!EqualBytes(actual.data.data(), initialDest.data.data(), initialDest.offset * sizeof(T)))
+		Fail(kernels, kernel, initialDest.width, "wrote before the first row");
+}
+
+void TestConformance(const KernelTable& kernels, const KernelTable& reference)
+{
+	constexpr size_t height = 3;
+	const ColorF32 floatGuard(-7.0f, -7.0f, -7.0f, -7.0f);
+	const Color byteGuard(0xA5, 0x5A, 0xC3, 0x3C);
+
+	for (const size_t width : GetWidths())
+	{
+		PaddedBuffer<ColorF32> floatSource(width, height, floatGuard);
+		PaddedBuffer<ColorF32> floatDest(width, height, floatGuard);
+		PaddedBuffer<uint8_t> coverage(width, height, 0);
+		PaddedBuffer<uint8_t> subpixels(width * 3, height, 0);
+		PaddedBuffer<Color> byteDest(width, height, byteGuard);
+		PaddedBuffer<std::byte> rgba(width * 4, height, std::byte{ 0x77 });
+		for (size_t y = 0; y < height; y++)
+		{
+			for (size_t x = 0; x < width; x++)
+			{
+				floatSource.Row(y)[x] = RandomPremultiplied();
+				floatDest.Row(y)[x] = RandomPremultiplied();
+				coverage.Row(y)[x] = x % 7 == 0 ? static_cast<uint8_t>(x % 2 == 0 ? 0 : 255) : RandomByte();
+			}
+			for (size_t x = 0; x < width * 3; x++)
+				subpixels.Row(y)[x] = RandomByte();
+			for (size_t x = 0; x < width * 4; x++)
+				rgba.Row(y)[x] = static_cast<std::byte>(RandomByte());
+		}
+
+		std::vector<ColorF32> colorTable(256);
+		const ColorF32 textColor(RandomFloat(), RandomFloat(), RandomFloat(), 1.0f);
+		for (size_t i = 0; i < colorTable.size(); i++)
+		{
+			const float coverageValue = static_cast<float>(i) / 255.0f;
+			colorTable[i] = { textColor.R() * coverageValue, textColor.G() * coverageValue, textColor.B() * coverageValue, coverageValue };
+		}
+
+		const auto exactFloats = [](const ColorF32* a, const ColorF32* b, size_t count) { return EqualBytes(a, b, count * sizeof(ColorF32)); };
+		const auto exactColors = [](const Color* a, const Color* b, size_t count) { return EqualBytes(a, b, count * sizeof(Color)); };
+		const auto exactBytes = [](const std::byte* a, const std::byte* b, size_t count) { return EqualBytes(a, b, count); };
+		const auto closeFloats = [](const ColorF32* a, const ColorF32* b, size_t count) { return EqualWithinOneLevel(a, b, count); };
+		const auto closeColors = [](const Color* a, const Color* b, size_t count) { return EqualWithinOneLevel(a, b, count); };
+
+		const ColorF32 fillValue = RandomPremultiplied();
+		CompareRows(kernels, reference, "fill", floatDest
+			, [&](const KernelTable& k, ColorF32* dest, size_t) { k.fill(dest, fillValue, width); }, exactFloats);
+
+		CompareRows(kernels, reference, "blendPremultiplied", floatDest
+			, [&](const KernelTable& k, ColorF32* dest, size_t y) { k.blendPremultiplied(dest, floatSource.Row(y), width); }, closeFloats);
+
+		CompareRows(kernels, reference, "resolve", byteDest
+			, [&](const KernelTable& k, Color* dest, size_t y) { k.resolve(dest, floatSource.Row(y), width); }, closeColors);
+
+		CompareRows(kernels, reference, "expandGray", floatDest
+			, [&](const KernelTable& k, ColorF32* dest, size_t y) { k.expandGray(dest, coverage.Row(y), width, colorTable.data()); }, exactFloats);
+
+		// Fill tables for the color index plane, indexed by run.
+		std::vector<ColorF32> outlineTable(256);
+		std::vector<std::vector<ColorF32>> runTables(4, std::vector<ColorF32>(256));
+		std::vector<const ColorF32*> fillTables;
+		for (std::vector<ColorF32>& runTable : runTables)
+		{
+			for (ColorF32& color : runTable)
+				color = RandomPremultiplied();
+			runTable[0] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			fillTables.push_back(runTable.data());
+		}
+		for (ColorF32& color : outlineTable)
+			color = RandomPremultiplied();
+		outlineTable[0] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+		PaddedBuffer<uint8_t> outlineCoverage(width, height, 0);
+		PaddedBuffer<uint8_t> runIndices(width, height, 0);
+		for (size_t y = 0; y < height; y++)
+		{
+			for (size_t x = 0; x < width; x++)
+			{
+				outlineCoverage.Row(y)[x] = x % 5 == 0 ? 0 : RandomByte();
+				runIndices.Row(y)[x] = static_cast<uint8_t>(RandomSize(0, runTables.size() - 1));
+			}
+		}
+
+		const ColorF32 background = RandomPremultiplied();
+		CompareRows(kernels, reference, "compositeCoverage", floatDest
+			, [&](const KernelTable& k, ColorF32* dest, size_t y)
+			{
+				k.compositeCoverage(dest, coverage.Row(y), outlineCoverage.Row(y), runIndices.Row(y), width, background, outlineTable.data(), fillTables.data());
+			}, closeFloats);
+
+		const Color lcdTextColor(RandomByte(), RandomByte(), RandomByte(), static_cast<uint8_t>(255));
+		CompareRows(kernels, reference, "lcdToRGBA", byteDest
+			, [&](const KernelTable& k, Color* dest, size_t y) { k.lcdToRGBA(subpixels.Row(y), static_cast<uint32_t>(width), lcdTextColor, dest); }, exactColors);
+
+		PaddedBuffer<std::byte> swizzleDest(width * 4, height, std::byte{ 0x11 });
+		CompareRows(kernels, reference, "swizzleRGBAToBGRA", swizzleDest
+			, [&](const KernelTable& k, std::byte* dest, size_t y) { k.swizzleRGBAToBGRA(rgba.Row(y), dest, width); }, exactBytes);
+
+		// In place, as used when saving bitmaps.
+		CompareRows(kernels, reference, "swizzleRGBAToBGRA in place", rgba
+			, [&](const KernelTable& k, std::byte* dest, size_t) { k.swizzleRGBAToBGRA(dest, dest, width); }, exactBytes);
+	}
+}
+
+// Glyphs drawn on a text canvas blended onto an outline canvas, once on tiled canvases that only fill the touched
+// tiles and once on canvases filled entirely up front. The resolved pixels must be identical.
+void TestSparseCanvas()
+{
+	const auto& kernels = FreeType::PixelKernels::GetKernels();
+	const auto resolveRow = [&](Color* dest, const ColorF32* source, size_t count) { kernels.resolve(dest, source, count); };
+
+	for (int iteration = 0; iteration < 32; iteration++)
+	{
+		const uint32_t width = static_cast<uint32_t>(RandomSize(1, 200));
+		const uint32_t height = static_cast<uint32_t>(RandomSize(1, 100));
+		const size_t numPixels = static_cast<size_t>(width) * height;
+		const ColorF32 background = RandomPremultiplied();
+		const ColorF32 transparent(0.0f, 0.0f, 0.0f, 0.0f);
+
+		// Untouched tiles of the sparse canvases keep this garbage.
+		std::vector<ColorF32> sparseText(numPixels, ColorF32(-7.0f, -7.0f, -7.0f, -7.0f));
+		std::vector<ColorF32> sparseOutline(sparseText);
+		std::vector<ColorF32> denseText(numPixels, transparent);
+		std::vector<ColorF32> denseOutline(numPixels, background);
+		FreeType::SparseCanvas textCanvas(reinterpret_cast<std::byte*>(sparseText.data()), width, height, transparent);
+		FreeType::SparseCanvas outlineCanvas(reinterpret_cast<std::byte*>(sparseOutline.data()), width, height, background);
+
+		// Glyph sized rectangles, some partly outside the canvas.
+		for (size_t glyph = RandomSize(0, 12); glyph > 0; glyph--)
+		{
+			const bool outline = RandomSize(0, 1) == 0;
+			const int32_t left = static_cast<int32_t>(RandomSize(0, width + 8)) - 8;
+			const int32_t top = static_cast<int32_t>(RandomSize(0, height + 8)) - 8;
+			const int32_t glyphWidth = static_cast<int32_t>(RandomSize(1, 40));
+			const int32_t glyphHeight = static_cast<int32_t>(RandomSize(1, 40));
+			(outline ? outlineCanvas : textCanvas).Touch(left, top, glyphWidth, glyphHeight);
+
+			std::vector<ColorF32>& sparse = outline ? sparseOutline : sparseText;
+			std::vector<ColorF32>& dense = outline ? denseOutline : denseText;
+			for (int32_t y = std::max(top, 0); y < std::min<int32_t>(top + glyphHeight, static_cast<int32_t>(height)); y++)
+			{
+				for (int32_t x = std::max(left, 0); x < std::min<int32_t>(left + glyphWidth, static_cast<int32_t>(width)); x++)
+				{
+					const size_t i = static_cast<size_t>(y) * width + static_cast<size_t>(x);
+					const ColorF32 color = RandomPremultiplied();
+					sparse[i] = sparse[i].BlendPreMultiplied(color);
+					dense[i] = dense[i].BlendPreMultiplied(color);
+				}
+			}
+		}
+
+		textCanvas.BlendOnto(outlineCanvas);
+		kernels.blendPremultiplied(denseOutline.data(), denseText.data(), numPixels);
+
+		std::vector<Color> expected(numPixels);
+		std::vector<Color> actual(numPixels);
+		resolveRow(expected.data(), denseOutline.data(), numPixels);
+		outlineCanvas.Resolve(actual.data(), resolveRow);
+		if (!EqualBytes(actual.data(), expected.data(), numPixels * sizeof(Color)))
+			throw std::runtime_error("sparse canvas differs from the dense canvas at " + std::to_string(width) + "x" + std::to_string(height));
+	}
+}
+
+// Converting 8 bit sRGB to linear light and back must return the input, linear blending relies on it to leave
+// unblended pixels as they are.
+void TestGammaTables()
+{
+	using FreeType::GammaTables;
+	for (int value = 0; value <= 255; value++)
+	{
+		const uint8_t channel = static_cast<uint8_t>(value);
+		if (GammaTables::LinearToSRGB(GammaTables::SRGBToLinear(channel)) != channel)
+			throw std::runtime_error("gamma tables don't round trip " + std::to_string(value));
+		if (value > 0 && GammaTables::SRGBToLinear(channel) <= GammaTables::SRGBToLinear(static_cast<uint8_t>(value - 1)))
+			throw std::runtime_error("sRGB to linear table isn't increasing at " + std::to_string(value));
+
+		const Color color(channel, static_cast<uint8_t>(255 - value), RandomByte(), RandomByte());
+		if (GammaTables::FromLinear(GammaTables::ToLinear(color)) != color)
+			throw std::runtime_error("linear colors don't round trip");
+	}
+}
+
+// The SSE2 LCD kernel is used by every SIMD level, it must write exactly the scalar kernel's bytes and nothing past
+// the last pixel, for every length of the block tail.
+void TestLcdKernel()
+{
+	const Color guard(uint8_t{ 0xA5 }, uint8_t{ 0x5A }, uint8_t{ 0xC3 }, uint8_t{ 0x3C });
+	for (uint32_t numPixels = 0; numPixels <= 97; numPixels++)
+	{
+		std::vector<uint8_t> subpixels(static_cast<size_t>(numPixels) * 3);
+		for (uint8_t& subpixel : subpixels)
+			subpixel = RandomByte();
+		const Color textColor(RandomByte(), RandomByte(), RandomByte(), RandomByte());
+
+		std::vector<Color> expected(numPixels + 4, guard);
+		std::vector<Color> actual(numPixels + 4, guard);
+		FreeType::PixelKernels::LcdToRGBAScalar(subpixels.data(), numPixels, textColor, expected.data());
+		FreeType::PixelKernels::LcdToRGBASSE2(subpixels.data(), numPixels, textColor, actual.data());
+		if (!EqualBytes(actual.data(), expected.data(), actual.size() * sizeof(Color)))
+			throw std::runtime_error("LcdToRGBASSE2 differs from the scalar kernel at " + std::to_string(numPixels) + " pixels");
+	}
+}
+
+// A glyph bitmap of random coverage, its rows padded to a multiple of 4 bytes like FreeType pads them.
+struct TestGlyph
+{
+	std::vector<uint8_t> pixels;
+	FT_BitmapGlyphRec glyph{};
+
+	TestGlyph(unsigned char pixelMode, uint32_t width, uint32_t height)
+	{
+		const uint32_t rowSize = pixelMode == FT_PIXEL_MODE_MONO ? (width + 7) / 8 : pixelMode == FT_PIXEL_MODE_LCD ? width * 3 : width;
+		const uint32_t pitch = (rowSize + 3) & ~3u;
+		pixels.resize(static_cast<size_t>(pitch) * height);
+		for (uint8_t& pixel : pixels)
+			pixel = RandomSize(0, 3) == 0 ? static_cast<uint8_t>(RandomSize(0, 1) * 255) : RandomByte();
+
+		glyph.bitmap.rows = height;
+		glyph.bitmap.width = pixelMode == FT_PIXEL_MODE_LCD ? width * 3 : width;
+		glyph.bitmap.pitch = static_cast<int>(pitch);
+		glyph.bitmap.buffer = pixels.data();
+		glyph.bitmap.num_grays = pixelMode == FT_PIXEL_MODE_MONO ? 2 : 256;
+		glyph.bitmap.pixel_mode = pixelMode;
+	}
+
+	FreeTypeRenderer::GlyphRGBAParams GetParams(Color textColor)
+	{
+		return { &glyph, Color(uint8_t{ 0 }, uint8_t{ 0 }, uint8_t{ 0 }, uint8_t{ 0 }), textColor, FreeTypeRenderer::GetBitmapGlyphProperties(glyph.bitmap) };
+	}
+};
+
+// Blending a mono glyph straight into a canvas must give what blending its reference rendering onto the canvas gives.
+void TestBlendMonoGlyph(const FreeTypeRenderer::GlyphRGBAParams& params, const ColorF32* reference, const char* levelName)
+{
+	const uint32_t width = params.bitmapProperties.width;
+	const uint32_t height = params.bitmapProperties.height;
+	PaddedBuffer<ColorF32> initialCanvas(width + 3, height + 2, ColorF32(-7.0f, -7.0f, -7.0f, -7.0f));
+	for (size_t y = 0; y < initialCanvas.height; y++)
+		for (size_t x = 0; x < initialCanvas.width; x++)
+			initialCanvas.Row(y)[x] = RandomPremultiplied();
+
+	const uint32_t left = static_cast<uint32_t>(RandomSize(0, 3));
+	const uint32_t top = static_cast<uint32_t>(RandomSize(0, 2));
+	PaddedBuffer<ColorF32> expected = initialCanvas;
+	for (uint32_t y = 0; y < height; y++)
+		for (uint32_t x = 0; x < width; x++)
+			expected.Row(top + y)[left + x] = expected.Row(top + y)[left + x].BlendPreMultiplied(reference[y * width + x]);
+
+	PaddedBuffer<ColorF32> actual = initialCanvas;
+	FreeType::BlitBox dest{ reinterpret_cast<std::byte*>(actual.Row(0)), static_cast<uint32_t>(actual.pitch * sizeof(ColorF32))
+		, static_cast<uint32_t>(actual.width), static_cast<uint32_t>(actual.height), left, top, static_cast<uint32_t>(sizeof(ColorF32)) };
+	FreeTypeRenderer::BlendMonoGlyph(params, dest);
+
+	if (!EqualBytes(actual.data.data(), expected.data.data(), expected.data.size() * sizeof(ColorF32)))
+		throw std::runtime_error(std::string(levelName) + " BlendMonoGlyph differs from the reference at width " + std::to_string(width));
+}
+
+void TestGlyphKernels()
+{
+	const char* levelName = FreeType::CpuDispatch::GetLevelName(FreeType::CpuDispatch::GetActiveLevel());
+	for (const unsigned char pixelMode : { FT_PIXEL_MODE_MONO, FT_PIXEL_MODE_GRAY, FT_PIXEL_MODE_LCD })
+	{
+		for (const size_t width : GetWidths())
+		{
+			TestGlyph glyph(pixelMode, static_cast<uint32_t>(width), static_cast<uint32_t>(RandomSize(1, 5)));
+			const FreeTypeRenderer::GlyphRGBAParams params = glyph.GetParams(Color(RandomByte(), RandomByte(), RandomByte(), RandomByte()));
+
+			const FreeType::ByteBuffer expected = FreeTypeRenderer::RenderGlyphToBufferReference(params);
+			const FreeType::ByteBuffer actual = FreeTypeRenderer::RenderGlyphToBuffer(params);
+			if (actual.size() != expected.size() || !EqualBytes(actual.data(), expected.data(), expected.size()))
+				throw std::runtime_error(std::string(levelName) + " RenderGlyphToBuffer differs from the reference for pixel mode "
+					+ std::to_string(pixelMode) + " at width " + std::to_string(width));
+
+			if (pixelMode == FT_PIXEL_MODE_MONO)
+				TestBlendMonoGlyph(params, reinterpret_cast<const ColorF32*>(expected.data()), levelName);
+		}
+	}
+}
+
+// Millions of pixels per second of a kernel over a buffer that fits in the L2 cache.
+template <typename Kernel>
+double MeasureThroughput(size_t numPixels, Kernel kernel)
+{
+	constexpr auto minimumDuration = std::chrono::milliseconds(20);
+	size_t iterations = 0;
+	const auto start = Clock::now();
+	auto elapsed = Clock::duration::zero();
+	do
+	{
+		kernel();
+		iterations++;
+		elapsed = Clock::now() - start;
+	} while (elapsed < minimumDuration);
+
+	return static_cast<double>(numPixels * iterations) / std::chrono::duration<double, std::micro>(elapsed).count();
+}
+
+void ReportThroughput(const KernelTable& kernels)
+{
+	constexpr size_t numPixels = 8192;
+	std::vector<ColorF32> floatSource(numPixels);
+	std::vector<ColorF32> floatDest(numPixels);
+	std::vector<Color> byteDest(numPixels);
+	std::vector<uint8_t> coverage(numPixels);
+	std::vector<uint8_t> subpixels(numPixels * 3);
+	std::vector<std::byte> rgba(numPixels * 4);
+	std::vector<ColorF32> colorTable(256, ColorF32(0.5f, 0.25f, 0.125f, 0.5f));
+	for (size_t i = 0; i < numPixels; i++)
+	{
+		floatSource[i] = RandomPremultiplied();
+		floatDest[i] = RandomPremultiplied();
+		coverage[i] = RandomByte();
+	}
+	for (uint8_t& subpixel : subpixels)
+		subpixel = RandomByte();
+	// Index plane of the composite kernel, all pixels use the only fill table.
+	std::fill_n(subpixels.data() + numPixels, numPixels, static_cast<uint8_t>(0));
+	const ColorF32* const fillTables[] = { colorTable.data() };
+
+	const std::pair<const char*, double> results[] =
+	{
+		  { "fill", MeasureThroughput(numPixels, [&] { kernels.fill(floatDest.data(), floatSource[0], numPixels); }) }
+		, { "blendPremultiplied", MeasureThroughput(numPixels, [&] { kernels.blendPremultiplied(floatDest.data(), floatSource.data(), numPixels); }) }
+		, { "resolve", MeasureThroughput(numPixels, [&] { kernels.resolve(byteDest.data(), floatSource.data(), numPixels); }) }
+		, { "expandGray", MeasureThroughput(numPixels, [&] { kernels.expandGray(floatDest.data(), coverage.data(), numPixels, colorTable.data()); }) }
+		, { "compositeCoverage", MeasureThroughput(numPixels, [&] { kernels.compositeCoverage(floatDest.data(), coverage.data(), subpixels.data(), subpixels.data() + numPixels, numPixels, floatSource[0], colorTable.data(), fillTables); }) }
+		, { "lcdToRGBA", MeasureThroughput(numPixels, [&] { kernels.lcdToRGBA(subpixels.data(), static_cast<uint32_t>(numPixels), Color(10, 20, 30), byteDest.data()); }) }
+		, { "swizzleRGBAToBGRA", MeasureThroughput(numPixels, [&] { kernels.swizzleRGBAToBGRA(rgba.data(), rgba.data(), numPixels); }) }
+	};
+
+	for (const auto& [kernel, pixelsPerMicrosecond] : results)
+	{
+		std::cout << std::left << std::setw(8) << FreeType::CpuDispatch::GetLevelName(kernels.level)
+			<< std::setw(20) << kernel << std::right << std::fixed << std::setprecision(1)
+			<< std::setw(10) << pixelsPerMicrosecond << " MPixels/s" << std::endl;
+	}
+}
+
+int main()
+{
+	try
+	{
+		const std::vector<const KernelTable*> levels = GetLevels();
+		const KernelTable& reference = *levels.front();
+
+		for (const KernelTable* kernels : levels)
+		{
+			if (kernels != &reference)
+				TestConformance(*kernels, reference);
+			ReportThroughput(*kernels);
+		}
+		// The library's own code runs at the active level, force each level in turn as FREETYPE_WRAPPER_CPU_LEVEL does.
+		const FreeType::CpuLevel initialLevel = FreeType::CpuDispatch::GetActiveLevel();
+		for (const KernelTable* kernels : levels)
+		{
+			if (FreeType::CpuDispatch::SetActiveLevel(kernels->level) != kernels->level)
+				throw std::runtime_error(std::string("unable to force ") + FreeType::CpuDispatch::GetLevelName(kernels->level));
+			TestSparseCanvas();
+			TestGlyphKernels();
+		}
+		FreeType::CpuDispatch::SetActiveLevel(initialLevel);
+
+		TestGammaTables();
+		TestLcdKernel();
+
+		std::cout << "All kernel levels match the scalar kernels and glyphs match the reference." << std::endl;
+	}
+	catch (const std::exception& exception)
+	{
+		std::cout << "Kernel conformance test failed: " << exception.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
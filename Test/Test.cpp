@@ -23,8 +23,19 @@ SOFTWARE.
 
 #include <iostream>
 #include <array>
+#include <memory_resource>
+#include <cstring>
+#include <cstdlib>
 #include <FreeTypeWrapper/FreeTypeConnector.h>
 #include <FreeTypeWrapper/BitmapFile.h>
+#include <FreeTypeWrapper/BitmapStreamWriter.h>
+#include <FreeTypeWrapper/CpuDispatch.h>
+#include <FreeTypeWrapper/GlyphAtlas.h>
+#include <FreeTypeWrapper/QoiCodec.h>
+#if FREETYPE_WRAPPER_TEST_BAKED_FONT
+#include <FreeTypeWrapper/BakedFont.h>
+#include "BakedCascadiaCode.h"
+#endif
 #include <LLUtils/Colors.h>
 #include <LLUtils/Exception.h>
 #include "xxh3.h"
@@ -39,6 +50,9 @@ std::filesystem::path folderToSaveFiles = "./testImages/";
 #else
 	#pragma error "Non-compatible platform detected."
 #endif
+// Simple shapes without overlapping contours, FreeType renders the glyphs of the other test fonts with overlap
+// supersampling, which keeps them off the span paths.
+std::filesystem::path fontPathShapes = L"./TestShapes.ttf";
 
 
 
@@ -86,6 +100,1013 @@ void runTest(FreeType::FreeTypeConnector& freeType, FreeType::TextCreateParams f
 
 }
 
+// Blending in linear light changes partially covered pixels only, the background goes through the gamma tables and
+// back unchanged.
+void runLinearBlendingTest(FreeType::FreeTypeConnector& freeType, FreeType::TextCreateParams freetypeParams)
+{
+	using namespace FreeType;
+	FreeTypeConnector::Bitmap srgb;
+	FreeTypeConnector::Bitmap linear;
+	freetypeParams.flags = TextCreateFlags::UseMetaText | TextCreateFlags::Bidirectional;
+	freeType.CreateBitmap(freetypeParams, srgb, nullptr);
+	freetypeParams.flags = freetypeParams.flags | TextCreateFlags::LinearBlending;
+	freeType.CreateBitmap(freetypeParams, linear, nullptr);
+
+	if (linear.width != srgb.width || linear.height != srgb.height)
+		throw std::runtime_error("test failed, linear blending changed the bitmap size");
+
+	const size_t bitmapSize = static_cast<size_t>(srgb.rowPitch) * srgb.height;
+	if (std::memcmp(linear.buffer.data(), srgb.buffer.data(), bitmapSize) == 0)
+		throw std::runtime_error("test failed, linear blending didn't change the blended pixels");
+
+	const auto* srgbPixels = reinterpret_cast<const LLUtils::Color*>(srgb.buffer.data());
+	const auto* linearPixels = reinterpret_cast<const LLUtils::Color*>(linear.buffer.data());
+	if (srgbPixels[0] != freetypeParams.backgroundColor || linearPixels[0] != freetypeParams.backgroundColor)
+		throw std::runtime_error("test failed, linear blending changed the background");
+}
+
+void runBufferReuseTest(FreeType::FreeTypeConnector& freeType, FreeType::TextCreateParams freetypeParams)
+{
+	using namespace FreeType;
+	BufferPool bufferPool;
+	freeType.SetBufferPool(&bufferPool);
+
+	FreeTypeConnector::Bitmap textBitmap;
+	freeType.CreateBitmap(freetypeParams, textBitmap, nullptr);
+	const std::byte* firstBuffer = textBitmap.buffer.data();
+
+	// Rendering into a bitmap that is big enough must reuse its buffer.
+	freeType.CreateBitmap(freetypeParams, textBitmap, nullptr);
+	if (textBitmap.buffer.data() != firstBuffer)
+		throw std::runtime_error("test failed, output buffer was not reused");
+
+	// A released bitmap must be handed out again from the pool.
+	freeType.ReleaseBitmap(textBitmap);
+	if (bufferPool.GetRetainedBytes() == 0)
+		throw std::runtime_error("test failed, released buffer was not pooled");
+
+	freeType.CreateBitmap(freetypeParams, textBitmap, nullptr);
+	freeType.SetBufferPool(nullptr);
+}
+
+// A memory resource that counts the allocations routed through it.
+class CountingMemoryResource : public std::pmr::memory_resource
+{
+public:
+	size_t allocations = 0;
+
+private:
+	void* do_allocate(size_t bytes, size_t alignment) override
+	{
+		allocations++;
+		return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void* p, size_t bytes, size_t alignment) override
+	{
+		std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+	{
+		return this == &other;
+	}
+};
+
+void runMemoryResourceTest(FreeType::TextCreateParams freetypeParams)
+{
+	using namespace FreeType;
+	CountingMemoryResource memoryResource;
+	FreeTypeConnector freeType(&memoryResource);
+	FreeTypeConnector::Bitmap textBitmap;
+	FreeTypeConnector::GlyphMappings glyphMappings(&memoryResource);
+	freeType.CreateBitmap(freetypeParams, textBitmap, nullptr, &glyphMappings);
+
+	if (memoryResource.allocations == 0 || textBitmap.buffer.get_memory_resource() != &memoryResource)
+		throw std::runtime_error("test failed, allocations did not use the given memory resource");
+
+	const FreeTypeMemoryStats freeTypeMemoryStats = freeType.GetFreeTypeMemoryStats();
+	if (freeTypeMemoryStats.bytesInUse == 0 || freeTypeMemoryStats.peakBytesInUse < freeTypeMemoryStats.bytesInUse)
+		throw std::runtime_error("test failed, FreeType allocations were not accounted for");
+}
+
+// The minimal module set renders TrueType fonts exactly like the default modules do.
+void runMinimalModulesTest(FreeType::FreeTypeConnector& defaultModules, FreeType::TextCreateParams freetypeParams)
+{
+	using namespace FreeType;
+	FreeTypeConnector freeType(ConnectorCreateParams{ std::pmr::get_default_resource(), FreeTypeModules::Minimal });
+	FreeTypeConnector::Bitmap textBitmap;
+	FreeTypeConnector::Bitmap expectedBitmap;
+	freeType.CreateBitmap(freetypeParams, textBitmap, nullptr);
+	defaultModules.CreateBitmap(freetypeParams, expectedBitmap, nullptr);
+
+	const size_t bitmapSize = static_cast<size_t>(expectedBitmap.rowPitch) * expectedBitmap.height;
+	if (textBitmap.width != expectedBitmap.width || textBitmap.height != expectedBitmap.height
+		|| std::memcmp(textBitmap.buffer.data(), expectedBitmap.buffer.data(), bitmapSize) != 0)
+		throw std::runtime_error("test failed, minimal modules render differently from the default modules");
+}
+
+// Span rendering must produce exactly what the glyph bitmap path produces, for the color canvases and the fused
+// compositor, with text and outline spans.
+void runDirectSpansTest(FreeType::FreeTypeConnector& freeType, FreeType::TextCreateParams freetypeParams)
+{
+	using namespace FreeType;
+	freetypeParams.text = L"Span text: gjpqy;\nsecond line, 1218.3";
+	freetypeParams.renderMode = RenderMode::Antialiased;
+	for (const std::wstring& fontPath : { freetypeParams.fontPath, fontPathShapes.wstring() })
+	{
+		freetypeParams.fontPath = fontPath;
+		for (const TextCreateFlags blending : { TextCreateFlags::None, TextCreateFlags::LinearBlending })
+		{
+			for (const TextCreateFlags compositing : { TextCreateFlags::None, TextCreateFlags::FusedCompositing })
+			{
+				for (const uint32_t outlineWidth : { 0u, 2u })
+				{
+					freetypeParams.outlineWidth = outlineWidth;
+					freetypeParams.flags = blending | compositing;
+					FreeTypeConnector::Bitmap bitmapPath;
+					FreeTypeConnector::Bitmap spanPath;
+					freeType.CreateBitmap(freetypeParams, bitmapPath, nullptr);
+					freetypeParams.flags = freetypeParams.flags | TextCreateFlags::DirectSpanRendering;
+					freeType.CreateBitmap(freetypeParams, spanPath, nullptr);
+
+					const size_t bitmapSize = static_cast<size_t>(bitmapPath.rowPitch) * bitmapPath.height;
+					if (spanPath.width != bitmapPath.width || spanPath.height != bitmapPath.height
+						|| std::memcmp(spanPath.buffer.data(), bitmapPath.buffer.data(), bitmapSize) != 0)
+						throw std::runtime_error("test failed, span rendering differs from bitmap rendering");
+				}
+			}
+		}
+	}
+}
+
+// The fused compositor quantizes overlapping coverage to 8 bits, it may drift from the color canvases by a few levels.
+void runFusedCompositingTest(FreeType::FreeTypeConnector& freeType, FreeType::TextCreateParams freetypeParams)
+{
+	using namespace FreeType;
+	FreeTypeConnector::Bitmap canvasPath;
+	FreeTypeConnector::Bitmap fusedPath;
+	freeType.CreateBitmap(freetypeParams, canvasPath, nullptr);
+	freetypeParams.flags = freetypeParams.flags | TextCreateFlags::FusedCompositing;
+	freeType.CreateBitmap(freetypeParams, fusedPath, nullptr);
+
+	if (fusedPath.width != canvasPath.width || fusedPath.height != canvasPath.height)
+		throw std::runtime_error("test failed, fused compositing changed the bitmap size");
+
+	constexpr int maxDifference = 4;
+	const size_t bitmapSize = static_cast<size_t>(canvasPath.rowPitch) * canvasPath.height;
+	const auto* expected = reinterpret_cast<const uint8_t*>(canvasPath.buffer.data());
+	const auto* actual = reinterpret_cast<const uint8_t*>(fusedPath.buffer.data());
+	for (size_t i = 0; i < bitmapSize; i++)
+		if (std::abs(static_cast<int>(expected[i]) - static_cast<int>(actual[i])) > maxDifference)
+			throw std::runtime_error("test failed, fused compositing differs from the color canvases");
+}
+
+// Recoloring cached coverage must give the same pixels as rendering the text again with fused compositing.
+void runColorizeTest(FreeType::FreeTypeConnector& freeType, FreeType::TextCreateParams freetypeParams)
+{
+	using namespace FreeType;
+	freetypeParams.flags = freetypeParams.flags | TextCreateFlags::FusedCompositing;
+	FreeTypeConnector::TextCoverage coverage;
+	freeType.CreateCoverage(freetypeParams, coverage);
+
+	const FreeTypeConnector::CoverageColors colorSets[] =
+	{
+		  { freetypeParams.textColor, freetypeParams.outlineColor, freetypeParams.backgroundColor }
+		, { LLUtils::Color(255, 0, 0), LLUtils::Color(0, 0, 255), LLUtils::Color(20, 200, 20, 128) }
+	};
+
+	for (const FreeTypeConnector::CoverageColors& colors : colorSets)
+	{
+		FreeTypeConnector::Bitmap rendered;
+		FreeTypeConnector::Bitmap colorized;
+		freetypeParams.textColor = colors.textColor;
+		freetypeParams.outlineColor = colors.outlineColor;
+		freetypeParams.backgroundColor = colors.backgroundColor;
+		freeType.CreateBitmap(freetypeParams, rendered, nullptr);
+		freeType.Colorize(coverage, colors, colorized);
+
+		if (colorized.width != rendered.width || colorized.height != rendered.height
+			|| memcmp(colorized.buffer.data(), rendered.buffer.data(), static_cast<size_t>(rendered.rowPitch) * rendered.height) != 0)
+			throw std::runtime_error("test failed, colorized coverage differs from rendered text");
+	}
+
+	freeType.ReleaseCoverage(coverage);
+}
+
+// Coverage masks must carry the alpha of the RGBA output, text and outline channels must add up to the combined mask.
+void runCoverageMaskTest(FreeType::FreeTypeConnector& freeType, FreeType::TextCreateParams freetypeParams)
+{
+	using namespace FreeType;
+	freetypeParams.flags = freetypeParams.flags | TextCreateFlags::FusedCompositing;
+	freetypeParams.backgroundColor = LLUtils::Color(0, 0, 0, 0);
+	freetypeParams.textColor = LLUtils::Color(255, 255, 255);
+	freetypeParams.outlineColor = LLUtils::Color(255, 255, 255);
+
+	FreeTypeConnector::Bitmap rgba;
+	FreeTypeConnector::Bitmap alpha;
+	FreeTypeConnector::Bitmap channels;
+	freeType.CreateBitmap(freetypeParams, rgba, nullptr);
+	freetypeParams.bitmapFormat = BitmapFormat::A8;
+	freeType.CreateBitmap(freetypeParams, alpha, nullptr);
+	freetypeParams.bitmapFormat = BitmapFormat::A8x2;
+	freeType.CreateBitmap(freetypeParams, channels, nullptr);
+
+	if (alpha.format != BitmapFormat::A8 || alpha.PixelSize != 1 || channels.PixelSize != 2
+		|| alpha.width != rgba.width || alpha.height != rgba.height || channels.width != rgba.width || channels.height != rgba.height)
+		throw std::runtime_error("test failed, coverage mask has the wrong layout");
+
+	const auto* rgbaBytes = reinterpret_cast<const uint8_t*>(rgba.buffer.data());
+	const auto* alphaBytes = reinterpret_cast<const uint8_t*>(alpha.buffer.data());
+	const auto* channelBytes = reinterpret_cast<const uint8_t*>(channels.buffer.data());
+	bool hasOutline = false;
+	for (size_t i = 0; i < static_cast<size_t>(alpha.width) * alpha.height; i++)
+	{
+		const int fill = channelBytes[i * 2];
+		const int outline = channelBytes[i * 2 + 1];
+		hasOutline |= outline != 0 && fill == 0;
+		if (std::abs(static_cast<int>(rgbaBytes[i * 4 + 3]) - static_cast<int>(alphaBytes[i])) > 1
+			|| alphaBytes[i] != outline + ((255 - outline) * fill + 127) / 255)
+			throw std::runtime_error("test failed, coverage mask differs from the RGBA alpha");
+	}
+
+	if (freetypeParams.outlineWidth > 0 && !hasOutline)
+		throw std::runtime_error("test failed, coverage mask has no outline channel");
+}
+
+// Packed 1 bit output must set exactly the pixels aliased RGBA output draws.
+void runPackedBitsTest(FreeType::FreeTypeConnector& freeType, FreeType::TextCreateParams freetypeParams)
+{
+	using namespace FreeType;
+	freetypeParams.renderMode = RenderMode::Aliased;
+	freetypeParams.backgroundColor = LLUtils::Color(0, 0, 0, 0);
+
+	for (const uint32_t outlineWidth : { 0u, 2u })
+	{
+		freetypeParams.outlineWidth = outlineWidth;
+		FreeTypeConnector::Bitmap rgba;
+		FreeTypeConnector::Bitmap bits;
+		freetypeParams.bitmapFormat = BitmapFormat::RGBA;
+		freeType.CreateBitmap(freetypeParams, rgba, nullptr);
+		freetypeParams.bitmapFormat = BitmapFormat::A1;
+		freeType.CreateBitmap(freetypeParams, bits, nullptr);
+
+		if (bits.format != BitmapFormat::A1 || bits.width != rgba.width || bits.height != rgba.height || bits.rowPitch != (rgba.width + 7) / 8)
+			throw std::runtime_error("test failed, packed bitmap has the wrong layout");
+
+		const auto* rgbaBytes = reinterpret_cast<const uint8_t*>(rgba.buffer.data());
+		const auto* bitBytes = reinterpret_cast<const uint8_t*>(bits.buffer.data());
+		for (uint32_t y = 0; y < bits.height; y++)
+		{
+			for (uint32_t x = 0; x < bits.rowPitch * 8; x++)
+			{
+				const bool bit = (bitBytes[y * bits.rowPitch + x / 8] & (0x80 >> (x % 8))) != 0;
+				const bool drawn = x < rgba.width && rgbaBytes[(static_cast<size_t>(y) * rgba.width + x) * 4 + 3] >= 128;
+				if (bit != drawn)
+					throw std::runtime_error("test failed, packed bitmap differs from aliased RGBA output");
+			}
+		}
+	}
+}
+
+// Aliased glyphs are blended a byte of pixels at a time straight into the canvas. Every pixel must be exactly the
+// background, text or outline color, and match the coverage canvas that expands the same glyphs separately.
+void runAliasedTest(FreeType::FreeTypeConnector& freeType, FreeType::TextCreateParams freetypeParams)
+{
+	using namespace FreeType;
+	freetypeParams.renderMode = RenderMode::Aliased;
+	freetypeParams.flags = TextCreateFlags::None;
+	freetypeParams.backgroundColor = LLUtils::Color(255, 255, 255, 255);
+	freetypeParams.textColor = LLUtils::Color(255, 137, 48, 255);
+	freetypeParams.outlineColor = LLUtils::Color(0, 0, 96, 255);
+
+	for (const uint32_t outlineWidth : { 0u, 2u })
+	{
+		freetypeParams.outlineWidth = outlineWidth;
+		FreeTypeConnector::Bitmap direct;
+		FreeTypeConnector::Bitmap composited;
+		freetypeParams.flags = TextCreateFlags::None;
+		freeType.CreateBitmap(freetypeParams, direct, nullptr);
+		freetypeParams.flags = TextCreateFlags::FusedCompositing;
+		freeType.CreateBitmap(freetypeParams, composited, nullptr);
+
+		const size_t bitmapSize = static_cast<size_t>(direct.rowPitch) * direct.height;
+		if (composited.width != direct.width || composited.height != direct.height
+			|| std::memcmp(composited.buffer.data(), direct.buffer.data(), bitmapSize) != 0)
+			throw std::runtime_error("test failed, aliased glyphs blended into the canvas differ from the coverage canvas");
+
+		size_t textPixels = 0;
+		const auto* pixels = reinterpret_cast<const LLUtils::Color*>(direct.buffer.data());
+		for (size_t i = 0; i < static_cast<size_t>(direct.width) * direct.height; i++)
+		{
+			if (pixels[i] == freetypeParams.textColor)
+				textPixels++;
+			else if (pixels[i] != freetypeParams.backgroundColor && (outlineWidth == 0 || pixels[i] != freetypeParams.outlineColor))
+				throw std::runtime_error("test failed, aliased text has a partially covered pixel");
+		}
+
+		if (textPixels == 0)
+			throw std::runtime_error("test failed, aliased text wasn't drawn");
+	}
+}
+
+// Resampled distance fields won't match hinted glyphs pixel for pixel, but must cover the same shapes at any size.
+void runSignedDistanceFieldTest(FreeType::FreeTypeConnector& freeType, FreeType::TextCreateParams freetypeParams)
+{
+	using namespace FreeType;
+	freetypeParams.backgroundColor = LLUtils::Color(0, 0, 0, 0);
+	freetypeParams.flags = freetypeParams.flags | TextCreateFlags::FusedCompositing;
+
+	for (const uint16_t fontSize : { uint16_t{ 11 }, uint16_t{ 17 }, uint16_t{ 40 } })
+	{
+		for (const uint32_t outlineWidth : { 0u, 2u })
+		{
+			freetypeParams.fontSize = fontSize;
+			freetypeParams.outlineWidth = outlineWidth;
+			FreeTypeConnector::Bitmap antialiased;
+			FreeTypeConnector::Bitmap distanceField;
+			freetypeParams.renderMode = RenderMode::Antialiased;
+			freeType.CreateBitmap(freetypeParams, antialiased, nullptr);
+			freetypeParams.renderMode = RenderMode::SignedDistanceField;
+			freeType.CreateBitmap(freetypeParams, distanceField, nullptr);
+
+			if (distanceField.width < antialiased.width || distanceField.height != antialiased.height
+				|| distanceField.width > antialiased.width + 2 * (outlineWidth + 2))
+				throw std::runtime_error("test failed, distance field text has the wrong size");
+
+			// Compare the total coverage, glyphs are placed at the same pen positions.
+			uint64_t expectedCoverage = 0;
+			uint64_t actualCoverage = 0;
+			for (uint32_t y = 0; y < antialiased.height; y++)
+			{
+				const auto* expectedRow = reinterpret_cast<const uint8_t*>(antialiased.buffer.data()) + static_cast<size_t>(y) * antialiased.rowPitch;
+				const auto* actualRow = reinterpret_cast<const uint8_t*>(distanceField.buffer.data()) + static_cast<size_t>(y) * distanceField.rowPitch;
+				for (uint32_t x = 0; x < antialiased.width; x++)
+					expectedCoverage += expectedRow[x * 4 + 3];
+				for (uint32_t x = 0; x < distanceField.width; x++)
+					actualCoverage += actualRow[x * 4 + 3];
+			}
+
+			if (expectedCoverage == 0 || std::abs(static_cast<double>(actualCoverage) / static_cast<double>(expectedCoverage) - 1.0) > 0.15)
+				throw std::runtime_error("test failed, distance field text coverage differs from antialiased text");
+		}
+	}
+
+	// Fields of a released font are dropped with it, the font is opened again on the next use.
+	FreeTypeConnector::Bitmap beforeRelease;
+	FreeTypeConnector::Bitmap afterRelease;
+	freeType.CreateBitmap(freetypeParams, beforeRelease, nullptr);
+	freeType.ReleaseFont(freetypeParams.fontPath);
+	freeType.CreateBitmap(freetypeParams, afterRelease, nullptr);
+	if (beforeRelease.buffer.size() != afterRelease.buffer.size()
+		|| std::memcmp(beforeRelease.buffer.data(), afterRelease.buffer.data(), beforeRelease.buffer.size()) != 0)
+		throw std::runtime_error("test failed, distance field text changed after its font was released");
+}
+
+// Atlases must not depend on the number of threads, the multi-channel median must agree with the true distance on
+// what is inside a glyph, except close to corners.
+void runMsdfAtlasTest(FreeType::FreeTypeConnector& freeType, FreeType::TextCreateParams freetypeParams)
+{
+	using namespace FreeType;
+	MsdfAtlasParams atlasParams;
+	atlasParams.fontPath = freetypeParams.fontPath;
+	atlasParams.characters = L"AaBbgo&@%0123 A";
+	atlasParams.emSize = 32;
+	atlasParams.pixelRange = 4;
+
+	FreeTypeConnector::MsdfAtlas atlas;
+	FreeTypeConnector::MsdfAtlas threadedAtlas;
+	atlasParams.maxThreads = 1;
+	freeType.CreateMsdfAtlas(atlasParams, atlas);
+	atlasParams.maxThreads = 4;
+	freeType.CreateMsdfAtlas(atlasParams, threadedAtlas);
+
+	const size_t atlasSize = static_cast<size_t>(atlas.bitmap.rowPitch) * atlas.bitmap.height;
+	if (threadedAtlas.bitmap.width != atlas.bitmap.width || threadedAtlas.bitmap.height != atlas.bitmap.height
+		|| std::memcmp(threadedAtlas.bitmap.buffer.data(), atlas.bitmap.buffer.data(), atlasSize) != 0)
+		throw std::runtime_error("test failed, msdf atlas depends on the number of threads");
+
+	if (atlas.glyphs.size() != 14 || atlas.glyphs.front().codepoint != U' ' || atlas.glyphs.front().width != 0 || atlas.glyphs.front().advance <= 0)
+		throw std::runtime_error("test failed, msdf atlas has the wrong glyphs");
+
+	const auto* pixels = reinterpret_cast<const uint8_t*>(atlas.bitmap.buffer.data());
+	for (const FreeTypeConnector::MsdfGlyph& glyph : atlas.glyphs)
+	{
+		if (glyph.width == 0)
+			continue;
+		if (glyph.atlasX + glyph.width > atlas.bitmap.width || glyph.atlasY + glyph.height > atlas.bitmap.height)
+			throw std::runtime_error("test failed, msdf glyph is outside the atlas");
+
+		size_t insidePixels = 0;
+		size_t disagreeingPixels = 0;
+		for (uint32_t y = 0; y < glyph.height; y++)
+		{
+			for (uint32_t x = 0; x < glyph.width; x++)
+			{
+				const uint8_t* pixel = pixels + static_cast<size_t>(glyph.atlasY + y) * atlas.bitmap.rowPitch + (glyph.atlasX + x) * 4;
+				const int median = std::max(std::min(pixel[0], pixel[1]), std::min(std::max(pixel[0], pixel[1]), pixel[2]));
+				insidePixels += median >= 128;
+				disagreeingPixels += (median >= 128) != (pixel[3] >= 128);
+				const bool border = x == 0 || y == 0 || x + 1 == glyph.width || y + 1 == glyph.height;
+				if (border && median >= 128)
+					throw std::runtime_error("test failed, msdf glyph is clipped by its field");
+			}
+		}
+
+		if (insidePixels == 0 || disagreeingPixels * 20 > insidePixels)
+			throw std::runtime_error("test failed, msdf median differs from the true distance");
+	}
+
+	freeType.ReleaseBitmap(atlas.bitmap);
+	freeType.ReleaseBitmap(threadedAtlas.bitmap);
+}
+
+// Draws atlas quads over an opaque background the way a GPU would, with straight alpha blending.
+std::pmr::vector<LLUtils::Color> CompositeQuads(const FreeType::GlyphAtlas& atlas, const std::pmr::vector<FreeType::GlyphQuad>& quads
+	, const FreeType::TextMetrics& metrics, LLUtils::Color backgroundColor)
+{
+	const FreeType::FreeTypeConnector::Bitmap& page = atlas.GetPage();
+	const uint32_t width = static_cast<uint32_t>(metrics.rect.GetWidth());
+	const uint32_t height = static_cast<uint32_t>(metrics.rect.GetHeight());
+	std::pmr::vector<LLUtils::Color> image(static_cast<size_t>(width) * height, backgroundColor);
+
+	for (const FreeType::GlyphQuad& quad : quads)
+	{
+		const uint32_t pageX = static_cast<uint32_t>(quad.u0 * static_cast<float>(page.width) + 0.5f);
+		const uint32_t pageY = static_cast<uint32_t>(quad.v0 * static_cast<float>(page.height) + 0.5f);
+		for (uint32_t y = 0; y < quad.height; y++)
+		{
+			for (uint32_t x = 0; x < quad.width; x++)
+			{
+				const int32_t imageX = quad.left + static_cast<int32_t>(x) - metrics.rect.LeftTop().x;
+				const int32_t imageY = quad.top + static_cast<int32_t>(y) - metrics.rect.LeftTop().y;
+				if (imageX < 0 || imageY < 0 || imageX >= static_cast<int32_t>(width) || imageY >= static_cast<int32_t>(height))
+					continue;
+
+				const uint8_t coverage = reinterpret_cast<const uint8_t*>(page.buffer.data())[static_cast<size_t>(pageY + y) * page.rowPitch + (pageX + x) * page.PixelSize];
+				const float alpha = coverage / 255.0f * quad.color.A() / 255.0f;
+				LLUtils::Color& pixel = image[static_cast<size_t>(imageY) * width + static_cast<size_t>(imageX)];
+				pixel = LLUtils::Color(
+					  static_cast<uint8_t>(pixel.R() + (quad.color.R() - pixel.R()) * alpha + 0.5f)
+					, static_cast<uint8_t>(pixel.G() + (quad.color.G() - pixel.G()) * alpha + 0.5f)
+					, static_cast<uint8_t>(pixel.B() + (quad.color.B() - pixel.B()) * alpha + 0.5f));
+			}
+		}
+	}
+	return image;
+}
+
+// Quads drawn from the atlas must look like the bitmap the connector renders, also after glyphs were evicted.
+void runGlyphAtlasTest(FreeType::FreeTypeConnector& freeType, FreeType::TextCreateParams freetypeParams)
+{
+	using namespace FreeType;
+	freetypeParams.renderMode = RenderMode::Antialiased;
+	freetypeParams.flags = TextCreateFlags::FusedCompositing;
+	freetypeParams.backgroundColor = LLUtils::Color(255, 255, 255);
+	freetypeParams.padding = 0;
+
+	// Room for a few dozen glyphs, the texts below don't fit together.
+	GlyphAtlas atlas(freeType, GlyphAtlasParams{ 128, 96, BitmapFormat::A8, 1 });
+	std::pmr::vector<GlyphQuad> quads;
+	std::pmr::vector<AtlasRect> dirtyRects;
+
+	const std::wstring texts[] = { L"Texel: 1218.3 X 584.6", L"abcdefghijklm", L"nopqrstuvwxyz", L"Texel: 1218.3 X 584.6" };
+	for (const std::wstring& text : texts)
+	{
+		for (const uint32_t outlineWidth : { 0u, 1u })
+		{
+			freetypeParams.text = text;
+			freetypeParams.outlineWidth = outlineWidth;
+			if (atlas.LayoutQuads(freetypeParams, quads) == false)
+				throw std::runtime_error("test failed, text doesn't fit in the glyph atlas");
+
+			FreeTypeConnector::Bitmap rendered;
+			TextMetrics metrics;
+			freeType.MeasureText({ freetypeParams }, metrics);
+			freeType.CreateBitmap(freetypeParams, rendered, &metrics);
+			const std::pmr::vector<LLUtils::Color> composited = CompositeQuads(atlas, quads, metrics, freetypeParams.backgroundColor);
+
+			// Overlapping outlines of neighbouring glyphs are blended twice, the fused canvas merges their coverage first.
+			const int maxDifference = outlineWidth == 0 ? 2 : 48;
+			const auto* expected = reinterpret_cast<const LLUtils::Color*>(rendered.buffer.data());
+			for (size_t i = 0; i < composited.size(); i++)
+			{
+				if (std::abs(composited[i].R() - expected[i].R()) > maxDifference || std::abs(composited[i].B() - expected[i].B()) > maxDifference)
+					throw std::runtime_error("test failed, atlas quads differ from the rendered text");
+			}
+		}
+	}
+
+	if (atlas.GetEvictionCount() == 0)
+		throw std::runtime_error("test failed, glyph atlas didn't evict glyphs");
+
+	// Nothing new to upload for text already in the atlas.
+	atlas.TakeDirtyRects(dirtyRects);
+	atlas.LayoutQuads(freetypeParams, quads);
+	atlas.TakeDirtyRects(dirtyRects);
+	if (dirtyRects.empty() == false)
+		throw std::runtime_error("test failed, glyph atlas reported unchanged glyphs as dirty");
+
+	freetypeParams.text = L"the quick brown fox jumps over the lazy dog, THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG";
+	if (atlas.LayoutQuads(freetypeParams, quads) == true)
+		throw std::runtime_error("test failed, glyph atlas accepted more glyphs than it holds");
+}
+
+// A new connector started from a saved cache file must lay text out from it without rasterizing, damaged files are
+// rejected or their damaged glyphs rasterized again.
+void runGlyphCacheFileTest(FreeType::FreeTypeConnector& freeType, FreeType::TextCreateParams freetypeParams)
+{
+	using namespace FreeType;
+	freetypeParams.renderMode = RenderMode::Antialiased;
+	freetypeParams.text = L"Texel: 1218.3 X 584.6";
+	freetypeParams.outlineWidth = 1;
+	const std::filesystem::path cacheFilePath = std::filesystem::temp_directory_path() / "FreeTypeWrapperGlyphCache.bin";
+	const std::filesystem::path damagedFilePath = std::filesystem::temp_directory_path() / "FreeTypeWrapperGlyphCacheDamaged.bin";
+
+	std::pmr::vector<GlyphQuad> quads;
+	GlyphAtlas atlas(freeType, GlyphAtlasParams{ 256, 256, BitmapFormat::A8, 1 });
+	atlas.LayoutQuads(freetypeParams, quads);
+	atlas.SaveCacheFile(cacheFilePath.wstring());
+
+	const auto readQuadPixels = [](const GlyphAtlas& glyphAtlas, const std::pmr::vector<GlyphQuad>& glyphQuads)
+	{
+		const FreeTypeConnector::Bitmap& page = glyphAtlas.GetPage();
+		std::vector<uint8_t> pixels;
+		for (const GlyphQuad& quad : glyphQuads)
+		{
+			const uint32_t pageX = static_cast<uint32_t>(quad.u0 * static_cast<float>(page.width) + 0.5f);
+			const uint32_t pageY = static_cast<uint32_t>(quad.v0 * static_cast<float>(page.height) + 0.5f);
+			for (uint32_t y = 0; y < quad.height; y++)
+				for (uint32_t x = 0; x < quad.width; x++)
+					pixels.push_back(reinterpret_cast<const uint8_t*>(page.buffer.data())[static_cast<size_t>(pageY + y) * page.rowPitch + pageX + x]);
+		}
+		return pixels;
+	};
+
+	FreeTypeConnector warmConnector;
+	GlyphAtlas warmAtlas(warmConnector, GlyphAtlasParams{ 256, 256, BitmapFormat::A8, 1 });
+	GlyphAtlas rgbaAtlas(warmConnector, GlyphAtlasParams{ 256, 256, BitmapFormat::RGBA, 1 });
+	if (warmAtlas.OpenCacheFile((std::filesystem::temp_directory_path() / "FreeTypeWrapperMissing.bin").wstring()) || rgbaAtlas.OpenCacheFile(cacheFilePath.wstring()))
+		throw std::runtime_error("test failed, a missing cache file or one of another page format was opened");
+	if (warmAtlas.OpenCacheFile(cacheFilePath.wstring()) == false)
+		throw std::runtime_error("test failed, glyph cache file can't be opened");
+
+	std::pmr::vector<GlyphQuad> warmQuads;
+	warmAtlas.LayoutQuads(freetypeParams, warmQuads);
+	if (warmAtlas.GetCacheFileHitCount() != atlas.GetGlyphCount() || warmAtlas.GetGlyphCount() != atlas.GetGlyphCount())
+		throw std::runtime_error("test failed, glyphs were rasterized instead of read from the cache file");
+
+	if (warmQuads.size() != quads.size() || readQuadPixels(warmAtlas, warmQuads) != readQuadPixels(atlas, quads))
+		throw std::runtime_error("test failed, glyphs read from the cache file differ");
+
+	for (size_t i = 0; i < quads.size(); i++)
+		if (warmQuads[i].left != quads[i].left || warmQuads[i].top != quads[i].top || warmQuads[i].color != quads[i].color)
+			throw std::runtime_error("test failed, glyphs read from the cache file are placed differently");
+
+	std::vector<char> content;
+	{
+		std::ifstream file(cacheFilePath, std::ios::binary);
+		content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	const auto writeDamaged = [&](size_t offset)
+	{
+		std::vector<char> damaged = content;
+		damaged[offset] ^= 0x10;
+		std::ofstream file(damagedFilePath, std::ios::binary | std::ios::trunc);
+		file.write(damaged.data(), static_cast<std::streamsize>(damaged.size()));
+	};
+
+	// The index follows the header, a flipped byte in it rejects the file.
+	writeDamaged(64);
+	GlyphAtlas damagedIndexAtlas(warmConnector, GlyphAtlasParams{ 256, 256, BitmapFormat::A8, 1 });
+	if (damagedIndexAtlas.OpenCacheFile(damagedFilePath.wstring()))
+		throw std::runtime_error("test failed, glyph cache file with a damaged index was opened");
+
+	// A flipped pixel only rasterizes its glyph again.
+	writeDamaged(content.size() - 1);
+	GlyphAtlas damagedPixelsAtlas(warmConnector, GlyphAtlasParams{ 256, 256, BitmapFormat::A8, 1 });
+	if (damagedPixelsAtlas.OpenCacheFile(damagedFilePath.wstring()) == false)
+		throw std::runtime_error("test failed, glyph cache file with damaged pixels can't be opened");
+
+	damagedPixelsAtlas.LayoutQuads(freetypeParams, warmQuads);
+	if (damagedPixelsAtlas.GetCacheFileHitCount() + 1 != atlas.GetGlyphCount() || readQuadPixels(damagedPixelsAtlas, warmQuads) != readQuadPixels(atlas, quads))
+		throw std::runtime_error("test failed, damaged glyph was read from the cache file");
+
+	warmAtlas.CloseCacheFile();
+	damagedPixelsAtlas.CloseCacheFile();
+	std::filesystem::remove(cacheFilePath);
+	std::filesystem::remove(damagedFilePath);
+}
+
+#if FREETYPE_WRAPPER_TEST_BAKED_FONT
+// Text drawn from glyphs baked at build time must look like the text the connector renders.
+void runBakedFontTest(FreeType::FreeTypeConnector& freeType, FreeType::TextCreateParams freetypeParams)
+{
+	using namespace FreeType;
+	const BakedFont& bakedFont = BakedCascadiaCode[0];
+	// The font the test target bakes.
+	freetypeParams.fontPath = L"./CascadiaCode.ttf";
+	freetypeParams.fontSize = bakedFont.fontSize;
+	freetypeParams.DPIx = bakedFont.DPIx;
+	freetypeParams.DPIy = bakedFont.DPIy;
+	freetypeParams.renderMode = RenderMode::Antialiased;
+	freetypeParams.flags = TextCreateFlags::None;
+	freetypeParams.outlineWidth = 0;
+	freetypeParams.padding = 0;
+	freetypeParams.backgroundColor = LLUtils::Color(255, 255, 255);
+	freetypeParams.text = L"Texel: 1218.3 X 584.6\nThe quick brown fox {jumps} over the lazy dog!";
+
+	FreeTypeConnector::Bitmap rendered;
+	TextMetrics metrics;
+	freeType.MeasureText({ freetypeParams }, metrics);
+	freeType.CreateBitmap(freetypeParams, rendered, &metrics);
+
+	std::vector<LLUtils::Color> baked(static_cast<size_t>(rendered.width) * rendered.height, freetypeParams.backgroundColor);
+	BakedTextRenderer::Draw(bakedFont, "Texel: 1218.3 X 584.6\nThe quick brown fox {jumps} over the lazy dog!", freetypeParams.textColor
+		, reinterpret_cast<std::byte*>(baked.data()), rendered.width, rendered.height, rendered.width * sizeof(LLUtils::Color)
+		, -metrics.rect.LeftTop().x, -metrics.rect.LeftTop().y);
+
+	const auto* expected = reinterpret_cast<const LLUtils::Color*>(rendered.buffer.data());
+	for (size_t i = 0; i < baked.size(); i++)
+	{
+		if (std::abs(baked[i].R() - expected[i].R()) > 1 || std::abs(baked[i].G() - expected[i].G()) > 1 || std::abs(baked[i].B() - expected[i].B()) > 1)
+			throw std::runtime_error("test failed, baked text differs from the rendered text");
+	}
+
+	uint32_t width = 0;
+	uint32_t height = 0;
+	BakedTextRenderer::Measure(bakedFont, U"Texel\nX", width, height);
+	if (bakedFont.FindGlyph(U'~') == nullptr || bakedFont.FindGlyph(U'\u00E9') != nullptr || height != 2u * bakedFont.lineHeight || width != 5u * bakedFont.FindGlyph(U'T')->advance)
+		throw std::runtime_error("test failed, baked font doesn't hold printable ASCII");
+}
+#endif
+
+// Text rendered band by band must match the text rendered in one piece, and the bands must tile the bitmap.
+void runBandedRenderingTest(FreeType::FreeTypeConnector& freeType, FreeType::TextCreateParams freetypeParams)
+{
+	using namespace FreeType;
+	freetypeParams.text = L"Banded text, line one\nand {a} second, longer line of text\nthird";
+	freetypeParams.outlineWidth = 1;
+	freetypeParams.backgroundColor = LLUtils::Color(0, 0, 0, 0);
+
+	const auto compare = [](const FreeTypeConnector::Bitmap& expected, const FreeTypeConnector::Bitmap& actual)
+	{
+		if (expected.width != actual.width || expected.height != actual.height || expected.rowPitch != actual.rowPitch || expected.format != actual.format)
+			throw std::runtime_error("test failed, banded rendering changed the bitmap layout");
+		if (std::memcmp(expected.buffer.data(), actual.buffer.data(), static_cast<size_t>(expected.rowPitch) * expected.height) != 0)
+			throw std::runtime_error("test failed, banded rendering differs from rendering in one piece");
+	};
+
+	// Aliased text keeps aliased outlines, also when the anti-aliased glyphs would be drawn as spans.
+	struct Variant
+	{
+		BitmapFormat format;
+		RenderMode renderMode;
+	};
+	const Variant variants[] =
+	{
+		  { BitmapFormat::RGBA, RenderMode::Antialiased }
+		, { BitmapFormat::RGBA, RenderMode::Aliased }
+		, { BitmapFormat::A8, RenderMode::Antialiased }
+		, { BitmapFormat::A8, RenderMode::Aliased }
+		, { BitmapFormat::A1, RenderMode::Aliased }
+	};
+
+	const std::wstring fixedFontPath = freetypeParams.fontPath;
+	for (const std::wstring& fontPath : { fixedFontPath, fontPathShapes.wstring() })
+	{
+		for (const TextCreateFlags renderFlags : { TextCreateFlags::None, TextCreateFlags::DirectSpanRendering })
+		{
+			for (const Variant& variant : variants)
+			{
+				freetypeParams.fontPath = fontPath;
+				freetypeParams.bitmapFormat = variant.format;
+				freetypeParams.renderMode = variant.renderMode;
+				freetypeParams.flags = renderFlags | TextCreateFlags::FusedCompositing;
+				freetypeParams.bandHeight = 0;
+				FreeTypeConnector::Bitmap whole;
+				freeType.CreateBitmap(freetypeParams, whole, nullptr);
+
+				for (const uint32_t bandHeight : { 7u, 0u })
+				{
+					freetypeParams.flags = renderFlags | TextCreateFlags::BandedRendering;
+					freetypeParams.bandHeight = bandHeight;
+					FreeTypeConnector::Bitmap banded;
+					freeType.CreateBitmap(freetypeParams, banded, nullptr);
+					compare(whole, banded);
+
+					std::vector<std::byte> reassembled(static_cast<size_t>(whole.rowPitch) * whole.height);
+					uint32_t nextTop = 0;
+					freeType.RenderBands(freetypeParams, [&](const FreeTypeConnector::Bitmap& band, uint32_t top)
+					{
+						if (top != nextTop || band.width != whole.width || band.rowPitch != whole.rowPitch || (bandHeight != 0 && band.height > bandHeight))
+							throw std::runtime_error("test failed, bands don't tile the bitmap");
+						std::memcpy(reassembled.data() + static_cast<size_t>(top) * whole.rowPitch, band.buffer.data(), static_cast<size_t>(band.height) * band.rowPitch);
+						nextTop = top + band.height;
+					});
+
+					if (nextTop != whole.height)
+						throw std::runtime_error("test failed, bands don't cover the bitmap");
+					if (std::memcmp(whole.buffer.data(), reassembled.data(), reassembled.size()) != 0)
+						throw std::runtime_error("test failed, bands differ from the banded bitmap");
+				}
+			}
+		}
+	}
+
+	// Distance fields are looked up once per band and must resolve the same way.
+	freetypeParams.fontPath = fixedFontPath;
+	freetypeParams.bitmapFormat = BitmapFormat::RGBA;
+	freetypeParams.renderMode = RenderMode::SignedDistanceField;
+	freetypeParams.bandHeight = 5;
+	freetypeParams.flags = TextCreateFlags::FusedCompositing;
+	FreeTypeConnector::Bitmap whole;
+	freeType.CreateBitmap(freetypeParams, whole, nullptr);
+	freetypeParams.flags = TextCreateFlags::BandedRendering;
+	FreeTypeConnector::Bitmap banded;
+	freeType.CreateBitmap(freetypeParams, banded, nullptr);
+	compare(whole, banded);
+}
+
+// Saved bitmaps must hold the header and BGRA rows in file order, for both row orders.
+void runSaveToFileTest()
+{
+	using namespace FreeType;
+	const std::filesystem::path filePath = std::filesystem::temp_directory_path() / "FreeTypeWrapperSave.bmp";
+	// 3x2 pixels with a padded row pitch.
+	const std::array<uint8_t, 32> pixels = {
+		  1, 2, 3, 4,   5, 6, 7, 8,   9, 10, 11, 12,   0, 0, 0, 0
+		, 13, 14, 15, 16,   17, 18, 19, 20,   21, 22, 23, 24,   0, 0, 0, 0 };
+	Bitmap bitmap(BitmapBuffer{ reinterpret_cast<const std::byte*>(pixels.data()), 32, 3, 2, 16 });
+
+	for (const bool topDown : { false, true })
+	{
+		bitmap.SaveToFile(filePath.wstring(), topDown ? StreamFormat::BmpTopDown : StreamFormat::Bmp);
+		std::ifstream file(filePath, std::ios::binary);
+		const std::string saved((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		file.close();
+
+		BitmapFileHeader fileHeader;
+		BitmapInfoHeader infoHeader;
+		if (saved.size() != sizeof(fileHeader) + sizeof(infoHeader) + 24)
+			throw std::runtime_error("test failed, saved bitmap has the wrong size");
+		std::memcpy(&fileHeader, saved.data(), sizeof(fileHeader));
+		std::memcpy(&infoHeader, saved.data() + sizeof(fileHeader), sizeof(infoHeader));
+		if (fileHeader.bfType != 0x4D42 || fileHeader.bfSize != saved.size() || fileHeader.bfOffBits != 54 || infoHeader.biWidth != 3
+			|| infoHeader.biHeight != (topDown ? -2 : 2) || infoHeader.biBitCount != 32 || infoHeader.biSizeImage != 24)
+			throw std::runtime_error("test failed, saved bitmap has a wrong header");
+
+		for (uint32_t y = 0; y < 2; y++)
+		{
+			const uint32_t sourceY = topDown ? y : 1 - y;
+			for (uint32_t x = 0; x < 3; x++)
+			{
+				const uint8_t* expected = pixels.data() + sourceY * 16 + x * 4;
+				const auto* actual = reinterpret_cast<const uint8_t*>(saved.data()) + 54 + y * 12 + x * 4;
+				if (actual[0] != expected[2] || actual[1] != expected[1] || actual[2] != expected[0] || actual[3] != expected[3])
+					throw std::runtime_error("test failed, saved bitmap has wrong pixels");
+			}
+		}
+	}
+
+	std::filesystem::remove(filePath);
+}
+
+// Bands streamed to a file must give the same file as saving the whole bitmap, in any order for bottom-up bitmaps.
+void runBitmapStreamTest(FreeType::FreeTypeConnector& freeType, FreeType::TextCreateParams freetypeParams)
+{
+	using namespace FreeType;
+	freetypeParams.text = L"Streamed text, line one\nand a second line\nthird";
+	freetypeParams.outlineWidth = 1;
+	freetypeParams.bandHeight = 6;
+	freetypeParams.flags = TextCreateFlags::BandedRendering;
+
+	const std::filesystem::path wholePath = std::filesystem::temp_directory_path() / "FreeTypeWrapperWhole.bmp";
+	const std::filesystem::path streamPath = std::filesystem::temp_directory_path() / "FreeTypeWrapperStream.bin";
+	const auto readFile = [](const std::filesystem::path& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	};
+
+	FreeTypeConnector::Bitmap whole;
+	freeType.CreateBitmap(freetypeParams, whole, nullptr);
+	SaveToFile(whole, wholePath.wstring());
+	const std::string wholeFile = readFile(wholePath);
+
+	struct Band
+	{
+		std::vector<std::byte> pixels;
+		uint32_t top;
+		uint32_t rows;
+	};
+	std::vector<Band> bands;
+	freeType.RenderBands(freetypeParams, [&](const FreeTypeConnector::Bitmap& band, uint32_t top)
+	{
+		bands.push_back({ std::vector<std::byte>(band.buffer.data(), band.buffer.data() + static_cast<size_t>(band.rowPitch) * band.height), top, band.height });
+	});
+
+	for (const StreamFormat format : { StreamFormat::Bmp, StreamFormat::BmpTopDown, StreamFormat::Pam })
+	{
+		BitmapStreamWriter writer(streamPath.wstring(), whole.width, whole.height, format);
+		if (format == StreamFormat::Bmp)
+			for (auto it = bands.rbegin(); it != bands.rend(); ++it)
+				writer.WriteBand(it->pixels.data(), whole.rowPitch, it->top, it->rows);
+		else
+			for (const Band& band : bands)
+				writer.WriteBand(band.pixels.data(), whole.rowPitch, band.top, band.rows);
+		writer.Finish();
+
+		const std::string streamFile = readFile(streamPath);
+		const size_t imageSize = static_cast<size_t>(whole.rowPitch) * whole.height;
+		if (streamFile.size() < imageSize)
+			throw std::runtime_error("test failed, streamed bitmap is truncated");
+		const char* streamPixels = streamFile.data() + (streamFile.size() - imageSize);
+		const char* wholePixels = wholeFile.data() + (wholeFile.size() - imageSize);
+
+		bool same = true;
+		if (format == StreamFormat::Bmp)
+		{
+			same = streamFile == wholeFile;
+		}
+		else
+		{
+			// Top-down rows, PAM keeps the RGBA channel order.
+			for (uint32_t y = 0; y < whole.height; y++)
+			{
+				const char* streamRow = streamPixels + static_cast<size_t>(y) * whole.rowPitch;
+				const char* wholeRow = wholePixels + static_cast<size_t>(whole.height - 1 - y) * whole.rowPitch;
+				for (uint32_t x = 0; x < whole.width * 4; x += 4)
+					for (uint32_t channel = 0; channel < 4; channel++)
+						same &= streamRow[x + channel] == wholeRow[x + (format == StreamFormat::Pam && channel != 3 ? 2 - channel : channel)];
+			}
+		}
+
+		if (same == false)
+			throw std::runtime_error("test failed, streamed bitmap differs from the saved bitmap");
+	}
+
+	const auto isRejected = [&](StreamFormat format, const auto& write)
+	{
+		try
+		{
+			BitmapStreamWriter writer(streamPath.wstring(), whole.width, whole.height, format);
+			write(writer);
+		}
+		catch (const LLUtils::Exception&)
+		{
+			return true;
+		}
+		return false;
+	};
+
+	const bool outOfOrderRejected = isRejected(StreamFormat::BmpTopDown, [&](BitmapStreamWriter& writer)
+	{
+		writer.WriteBand(bands.back().pixels.data(), whole.rowPitch, bands.back().top, bands.back().rows);
+	});
+	// Bottom-up bands come in any order, but every row exactly once.
+	const bool overlapRejected = isRejected(StreamFormat::Bmp, [&](BitmapStreamWriter& writer)
+	{
+		writer.WriteBand(bands.front().pixels.data(), whole.rowPitch, bands.front().top, bands.front().rows);
+		writer.WriteBand(bands.front().pixels.data(), whole.rowPitch, bands.front().top + 1, bands.front().rows - 1);
+	});
+	const bool gapRejected = isRejected(StreamFormat::Bmp, [&](BitmapStreamWriter& writer)
+	{
+		for (size_t i = 1; i < bands.size(); i++)
+			writer.WriteBand(bands[i].pixels.data(), whole.rowPitch, bands[i].top, bands[i].rows);
+		writer.Finish();
+	});
+
+	std::filesystem::remove(wholePath);
+	std::filesystem::remove(streamPath);
+	if (outOfOrderRejected == false)
+		throw std::runtime_error("test failed, top-down bands were accepted out of order");
+	if (overlapRejected == false)
+		throw std::runtime_error("test failed, overlapping bands were accepted");
+	if (gapRejected == false)
+		throw std::runtime_error("test failed, bitmap stream finished with rows missing");
+}
+
+// QOI images must decode to the encoded pixels, whatever the number of threads they were encoded with.
+void runQoiTest(FreeType::FreeTypeConnector& freeType, FreeType::TextCreateParams freetypeParams)
+{
+	using namespace FreeType;
+	const auto roundTrip = [](const BitmapBuffer& bitmap, uint32_t maxThreads)
+	{
+		const std::pmr::vector<std::byte> encoded = QoiCodec::Encode(bitmap, maxThreads);
+		uint32_t width = 0;
+		uint32_t height = 0;
+		const std::pmr::vector<std::byte> decoded = QoiCodec::Decode(encoded, width, height);
+		if (width != bitmap.width || height != bitmap.height)
+			throw std::runtime_error("test failed, decoded QOI image has the wrong size");
+		for (uint32_t y = 0; y < height; y++)
+			if (std::memcmp(decoded.data() + static_cast<size_t>(y) * width * 4, bitmap.buffer + static_cast<size_t>(y) * bitmap.rowPitch, static_cast<size_t>(width) * 4) != 0)
+				throw std::runtime_error("test failed, decoded QOI image differs from the encoded one");
+		return encoded;
+	};
+
+	// A tightly cropped text capture, a single chunk. Larger captures have more flat background and compress better.
+	freetypeParams.text = L"QOI text capture\nwith an outline";
+	freetypeParams.outlineWidth = 2;
+	freetypeParams.backgroundColor = LLUtils::Color(255, 255, 255, 255);
+	FreeTypeConnector::Bitmap text;
+	freeType.CreateBitmap(freetypeParams, text, nullptr);
+	const BitmapBuffer textBuffer{ text.buffer.data(), 32, text.width, text.height, text.rowPitch };
+	if (roundTrip(textBuffer, 1).size() * 3 > static_cast<size_t>(text.width) * text.height * 4)
+		throw std::runtime_error("test failed, QOI doesn't compress text captures");
+
+	// Flat areas, gradients and noise over several chunks, with a padded row pitch.
+	constexpr uint32_t width = 700;
+	constexpr uint32_t height = 1200;
+	constexpr uint32_t rowPitch = width * 4 + 12;
+	std::vector<uint8_t> pixels(static_cast<size_t>(rowPitch) * height);
+	uint32_t noise = 12345;
+	for (uint32_t y = 0; y < height; y++)
+	{
+		for (uint32_t x = 0; x < width; x++)
+		{
+			uint8_t* pixel = pixels.data() + static_cast<size_t>(y) * rowPitch + x * 4;
+			noise = noise * 1664525u + 1013904223u;
+			const uint32_t area = (x / 100 + y / 150) % 4;
+			pixel[0] = static_cast<uint8_t>(area == 0 ? 255 : area == 1 ? x : area == 2 ? noise >> 24 : x + y);
+			pixel[1] = static_cast<uint8_t>(area == 0 ? 255 : area == 1 ? x + 1 : area == 2 ? noise >> 16 : y);
+			pixel[2] = static_cast<uint8_t>(area == 0 ? 255 : area == 1 ? x + 3 : area == 2 ? noise >> 8 : x * 3);
+			pixel[3] = static_cast<uint8_t>(area == 3 ? (x + y) : 255);
+		}
+	}
+
+	const BitmapBuffer chunkedBuffer{ reinterpret_cast<const std::byte*>(pixels.data()), 32, width, height, rowPitch };
+	const std::pmr::vector<std::byte> singleThread = roundTrip(chunkedBuffer, 1);
+	const std::pmr::vector<std::byte> multiThread = roundTrip(chunkedBuffer, 4);
+	if (singleThread != multiThread)
+		throw std::runtime_error("test failed, QOI encoding depends on the number of threads");
+
+	const std::filesystem::path filePath = std::filesystem::temp_directory_path() / "FreeTypeWrapper.qoi";
+	Bitmap(chunkedBuffer).SaveToQoiFile(filePath.wstring());
+	std::ifstream file(filePath, std::ios::binary);
+	const std::string saved((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	file.close();
+	std::filesystem::remove(filePath);
+	if (saved.size() != singleThread.size() || std::memcmp(saved.data(), singleThread.data(), saved.size()) != 0)
+		throw std::runtime_error("test failed, saved QOI file differs from the encoded image");
+
+	const auto isRejected = [](std::span<const std::byte> data)
+	{
+		try
+		{
+			uint32_t decodedWidth;
+			uint32_t decodedHeight;
+			QoiCodec::Decode(data, decodedWidth, decodedHeight);
+		}
+		catch (const LLUtils::Exception&)
+		{
+			return true;
+		}
+		return false;
+	};
+
+	if (isRejected(std::span(singleThread).first(singleThread.size() / 2)) == false)
+		throw std::runtime_error("test failed, truncated QOI image was decoded");
+
+	std::pmr::vector<std::byte> badEndMarker = singleThread;
+	badEndMarker.back() = std::byte{ 0 };
+	if (isRejected(badEndMarker) == false)
+		throw std::runtime_error("test failed, QOI image without an end marker was decoded");
+}
+
+// Every instruction set level the machine supports must render like the scalar kernels, within one 8 bit level.
+void runCpuDispatchTest(FreeType::FreeTypeConnector& freeType, FreeType::TextCreateParams freetypeParams)
+{
+	using namespace FreeType;
+	CpuLevel parsedLevel;
+	if (!CpuDispatch::ParseLevel("AVX2", parsedLevel) || parsedLevel != CpuLevel::AVX2 || CpuDispatch::ParseLevel("avx3", parsedLevel))
+		throw std::runtime_error("test failed, cpu level names are not parsed correctly");
+
+	const CpuLevel activeLevel = CpuDispatch::GetActiveLevel();
+	const CpuLevel supportedLevel = CpuDispatch::GetSupportedLevel();
+
+	FreeTypeConnector::Bitmap scalarBitmap;
+	CpuDispatch::SetActiveLevel(CpuLevel::Scalar);
+	freeType.CreateBitmap(freetypeParams, scalarBitmap, nullptr);
+
+	for (uint8_t level = 1; level <= static_cast<uint8_t>(supportedLevel); level++)
+	{
+		FreeTypeConnector::Bitmap levelBitmap;
+		CpuDispatch::SetActiveLevel(static_cast<CpuLevel>(level));
+		freeType.CreateBitmap(freetypeParams, levelBitmap, nullptr);
+
+		const size_t bitmapSize = static_cast<size_t>(scalarBitmap.rowPitch) * scalarBitmap.height;
+		const auto* expected = reinterpret_cast<const uint8_t*>(scalarBitmap.buffer.data());
+		const auto* actual = reinterpret_cast<const uint8_t*>(levelBitmap.buffer.data());
+		for (size_t i = 0; i < bitmapSize; i++)
+			if (std::abs(static_cast<int>(expected[i]) - static_cast<int>(actual[i])) > 1)
+				throw std::runtime_error(std::string("test failed, ") + CpuDispatch::GetLevelName(static_cast<CpuLevel>(level)) + " kernels differ from scalar kernels");
+	}
+
+	CpuDispatch::SetActiveLevel(activeLevel);
+}
+
 int runtests()
 {
 	using namespace FreeType;
@@ -273,6 +1294,36 @@ int runtests()
 	testParams.expectedHash = 11320992707252375232u;
 	runTest(freeType, params, testParams);
 
+	//Test blending in linear light
+	params.flags = params.flags | FreeType::TextCreateFlags::LinearBlending;
+	params.outlineWidth = 1;
+	params.renderMode = FreeType::RenderMode::Antialiased;
+	testParams.fileName = (folderToSaveFiles / "test8.bmp").wstring();
+	runTest(freeType, params, testParams);
+
+	runLinearBlendingTest(freeType, params);
+	runBufferReuseTest(freeType, params);
+	runMemoryResourceTest(params);
+	runMinimalModulesTest(freeType, params);
+	runDirectSpansTest(freeType, params);
+	runFusedCompositingTest(freeType, params);
+	runColorizeTest(freeType, params);
+	runCoverageMaskTest(freeType, params);
+	runPackedBitsTest(freeType, params);
+	runAliasedTest(freeType, params);
+	runSignedDistanceFieldTest(freeType, params);
+	runMsdfAtlasTest(freeType, params);
+	runGlyphAtlasTest(freeType, params);
+	runGlyphCacheFileTest(freeType, params);
+#if FREETYPE_WRAPPER_TEST_BAKED_FONT
+	runBakedFontTest(freeType, params);
+#endif
+	runBandedRenderingTest(freeType, params);
+	runSaveToFileTest();
+	runBitmapStreamTest(freeType, params);
+	runQoiTest(freeType, params);
+	runCpuDispatchTest(freeType, params);
+
 
 	return 0;
 }